@@ -0,0 +1,108 @@
+// Compares the byte-at-a-time <cctype> loops the editor used for token and line
+// scanning with the vectorized scanners in Core/CharScan.cpp.
+//
+// Usage: fin_bench_char_scan [source-file ...]
+// Without arguments the bundled thirdparty/json.hpp is used as the corpus.
+
+#include "Core/CharScan.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Identifier runs of 3+ bytes, as CollectLocalCompletions counts them.
+size_t CountTokensScalar(const std::string& text) {
+    size_t tokens = 0;
+    size_t length = 0;
+    for (char ch : text) {
+        const unsigned char uch = static_cast<unsigned char>(ch);
+        if (std::isalnum(uch) || ch == '_') {
+            ++length;
+            continue;
+        }
+        tokens += length >= 3 ? 1 : 0;
+        length = 0;
+    }
+    return tokens + (length >= 3 ? 1 : 0);
+}
+
+size_t CountTokensVector(const std::string& text) {
+    static std::vector<ByteRun> runs;
+    runs.clear();
+    CollectIdentifierRuns(text, 3, runs);
+    return runs.size();
+}
+
+// Lines and tab-expanded width, as the minimap collects them.
+size_t MeasureLinesScalar(const std::string& text) {
+    size_t width = 0;
+    size_t lines = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i != text.size() && text[i] != '\n') {
+            width += text[i] == '\t' ? 4 : 1;
+            continue;
+        }
+        ++lines;
+    }
+    return lines + width;
+}
+
+size_t MeasureLinesVector(const std::string& text) {
+    static std::vector<LineSpan> lines;
+    lines.clear();
+    CollectLines(text, lines);
+    size_t width = 0;
+    for (const LineSpan& line : lines) {
+        width += line.end - line.start + line.tabs * 3;
+    }
+    return lines.size() + width;
+}
+
+template <typename Fn>
+double GigabytesPerSecond(const std::string& text, int runs, Fn&& fn, size_t& result) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        result = fn(text);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(text.size()) * runs / std::chrono::duration<double>(elapsed).count() / 1e9;
+}
+
+void Report(const char* name, const std::string& text, size_t (*scalar)(const std::string&), size_t (*vector)(const std::string&)) {
+    const int runs = 50;
+    size_t scalarResult = 0;
+    size_t vectorResult = 0;
+    const double before = GigabytesPerSecond(text, runs, scalar, scalarResult);
+    const double after = GigabytesPerSecond(text, runs, vector, vectorResult);
+    std::printf("  %-10s %10.2f %10.2f %7.2fx%s\n", name, before, after, after / before,
+                scalarResult == vectorResult ? "" : "  (result mismatch!)");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string corpus;
+    const int fileCount = argc > 1 ? argc - 1 : 1;
+    for (int i = 0; i < fileCount; ++i) {
+        const char* path = argc > 1 ? argv[i + 1] : FIN_BENCH_DEFAULT_CORPUS;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot read %s\n", path);
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        corpus += buffer.str();
+    }
+
+    std::printf("%zu bytes\n  %-10s %10s %10s %8s\n", corpus.size(), "scan", "cctype GB/s", "simd GB/s", "speedup");
+    Report("tokens", corpus, CountTokensScalar, CountTokensVector);
+    Report("lines", corpus, MeasureLinesScalar, MeasureLinesVector);
+    return 0;
+}
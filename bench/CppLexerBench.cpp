@@ -0,0 +1,152 @@
+// Measures identifier classification in the C++ colorizer: the previous
+// substr + unordered_set probes against the perfect-hash ClassifyCppWord, plus
+// the full LexCppLine throughput.
+//
+// Usage: fin_bench_cpp_lexer [source-file ...]
+// Without arguments the bundled thirdparty/json.hpp is used as the corpus.
+
+#include "Core/CppLexer.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+bool IsIdentifierStart(char ch) {
+    return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_';
+}
+
+bool IsIdentifierChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+}
+
+// Calls classify(word) for every identifier-looking run, the way the colorizer walks a line.
+template <typename Classify>
+size_t ClassifyIdentifiers(const std::vector<std::string>& lines, Classify&& classify) {
+    size_t hits = 0;
+    for (const std::string& line : lines) {
+        const size_t length = line.size();
+        size_t i = 0;
+        while (i < length) {
+            if (!IsIdentifierStart(line[i])) {
+                ++i;
+                continue;
+            }
+            size_t end = i + 1;
+            while (end < length && IsIdentifierChar(line[end])) ++end;
+            hits += classify(line, i, end) != 0 ? 1 : 0;
+            i = end;
+        }
+    }
+    return hits;
+}
+
+// Mirrors the lookups colorizeCppLine did before the perfect hash.
+uint8_t ClassifyWithSets(const std::string& line, size_t start, size_t end) {
+    static const std::unordered_set<std::string> kKeywords = {
+        "alignas",     "alignof",      "asm",          "auto",         "break",        "case",
+        "catch",       "class",        "const",        "consteval",    "constexpr",    "constinit",
+        "continue",    "co_await",     "co_return",    "co_yield",     "decltype",     "default",
+        "delete",      "do",           "else",         "enum",         "explicit",     "export",
+        "extern",      "false",        "final",        "for",          "friend",       "goto",
+        "if",          "import",       "inline",       "module",       "mutable",      "namespace",
+        "new",         "noexcept",     "nullptr",      "operator",     "override",     "private",
+        "protected",   "public",       "register",     "requires",     "return",       "sizeof",
+        "static",      "static_assert","struct",       "switch",       "template",     "this",
+        "thread_local","throw",        "true",         "try",          "typedef",      "typename",
+        "union",       "using",        "virtual",      "volatile",     "while"};
+    static const std::unordered_set<std::string> kTypeWords = {
+        "bool",     "char",      "char8_t",   "char16_t", "char32_t", "double",     "float",
+        "int",      "long",      "short",     "signed",   "unsigned", "void",       "wchar_t",
+        "size_t",   "ptrdiff_t", "uint8_t",   "uint16_t", "uint32_t", "uint64_t",   "int8_t",
+        "int16_t",  "int32_t",   "int64_t",   "std",      "string"};
+    static const std::unordered_set<std::string> kTypeIntroducers = {
+        "class", "struct", "typename", "enum", "union", "using"};
+
+    const std::string word = line.substr(start, end - start);
+    if (kTypeWords.count(word) > 0) return kCppWordType;
+    if (kKeywords.count(word) > 0) {
+        return kTypeIntroducers.count(word) > 0 ? kCppWordKeyword | kCppWordTypeIntroducer : kCppWordKeyword;
+    }
+    return 0;
+}
+
+uint8_t ClassifyWithPerfectHash(const std::string& line, size_t start, size_t end) {
+    return ClassifyCppWord(std::string_view(line).substr(start, end - start));
+}
+
+size_t LexAll(const std::vector<std::string>& lines) {
+    CppLexState state;
+    std::vector<CppToken> tokens;
+    size_t count = 0;
+    for (const std::string& line : lines) {
+        tokens.clear();
+        LexCppLine(line, state, tokens);
+        count += tokens.size();
+    }
+    return count;
+}
+
+template <typename Fn>
+double LinesPerSecond(size_t lineCount, int runs, Fn&& fn, size_t& result) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        result = fn();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(lineCount) * runs / std::chrono::duration<double>(elapsed).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) paths.push_back(argv[i]);
+    if (paths.empty()) paths.push_back(FIN_BENCH_DEFAULT_CORPUS);
+
+    std::printf("%-28s %9s %14s %14s %8s %14s\n",
+                "corpus", "lines", "sets lines/s", "phash lines/s", "speedup", "lex lines/s");
+    for (const std::string& path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot read %s\n", path.c_str());
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        const std::vector<std::string> lines = SplitLines(buffer.str());
+
+        const int runs = 20;
+        size_t setHits = 0;
+        size_t hashHits = 0;
+        size_t tokenCount = 0;
+        const double sets = LinesPerSecond(lines.size(), runs, [&] { return ClassifyIdentifiers(lines, ClassifyWithSets); }, setHits);
+        const double hash = LinesPerSecond(lines.size(), runs, [&] { return ClassifyIdentifiers(lines, ClassifyWithPerfectHash); }, hashHits);
+        const double lex = LinesPerSecond(lines.size(), runs, [&] { return LexAll(lines); }, tokenCount);
+
+        const std::string name = path.size() > 28 ? "..." + path.substr(path.size() - 25) : path;
+        std::printf("%-28s %9zu %14.0f %14.0f %7.2fx %14.0f%s\n",
+                    name.c_str(), lines.size(), sets, hash, hash / sets, lex,
+                    setHits == hashHits ? "" : "  (classification mismatch!)");
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Compares straightforward find implementations with FindEngine on a large input:
+// case-insensitive literal search (lowercased copy + find), whole-word search and
+// regex search (std::regex on every line, no prefilter).
+//
+// Usage: fin_bench_find [source-file ...]
+// Without arguments the bundled thirdparty/json.hpp is used. The corpus is repeated
+// until it is at least 20 MB.
+
+#include "Core/FindEngine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMinCorpusBytes = 20u * 1024u * 1024u;
+
+size_t NaiveCaseInsensitive(const std::string& text, std::string query) {
+    std::string lowered(text);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+    std::transform(query.begin(), query.end(), query.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+    size_t count = 0;
+    for (size_t pos = lowered.find(query); pos != std::string::npos; pos = lowered.find(query, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+size_t NaiveWholeWord(const std::string& text, const std::string& query) {
+    const auto isWord = [](char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_'; };
+    size_t count = 0;
+    for (size_t pos = text.find(query); pos != std::string::npos; pos = text.find(query, pos + 1)) {
+        const size_t end = pos + query.size();
+        if ((pos == 0 || !isWord(text[pos - 1])) && (end >= text.size() || !isWord(text[end]))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t NaiveRegex(const std::string& text, const std::string& pattern) {
+    const std::regex re(pattern, std::regex::ECMAScript | std::regex::optimize);
+    size_t count = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        for (std::cregex_iterator it(text.data() + start, text.data() + end, re), done; it != done; ++it) {
+            count += it->length(0) > 0 ? 1 : 0;
+        }
+        start = end + 1;
+    }
+    return count;
+}
+
+template <typename Fn>
+double Milliseconds(Fn&& fn, size_t& result) {
+    const auto start = std::chrono::steady_clock::now();
+    result = fn();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+void Report(const char* name, const TextDocument& document, const std::string& query, const FindOptions& options,
+            size_t (*naive)(const std::string&, const std::string&)) {
+    size_t naiveCount = 0;
+    size_t engineCount = 0;
+    const double before = Milliseconds([&] { return naive(document.Text(), query); }, naiveCount);
+    const double after = Milliseconds([&] {
+        FindEngine engine;
+        return engine.Matches(document, query, options).size();
+    }, engineCount);
+    std::printf("  %-12s %10.1f %10.1f %7.2fx  %zu matches%s\n", name, before, after, before / after, engineCount,
+                naiveCount == engineCount ? "" : "  (count mismatch!)");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string corpus;
+    const int fileCount = argc > 1 ? argc - 1 : 1;
+    for (int i = 0; i < fileCount; ++i) {
+        const char* path = argc > 1 ? argv[i + 1] : FIN_BENCH_DEFAULT_CORPUS;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot read %s\n", path);
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        corpus += buffer.str();
+    }
+    if (corpus.empty()) {
+        std::fprintf(stderr, "empty corpus\n");
+        return 1;
+    }
+    const std::string unit = corpus;
+    while (corpus.size() < kMinCorpusBytes) {
+        corpus += unit;
+    }
+    const TextDocument document(std::move(corpus));
+
+    FindOptions caseInsensitive;
+    caseInsensitive.caseSensitive = false;
+    FindOptions wholeWord;
+    wholeWord.wholeWord = true;
+    FindOptions regex;
+    regex.regex = true;
+
+    std::printf("%zu bytes\n  %-12s %10s %10s %8s\n", document.Size(), "mode", "naive ms", "engine ms", "speedup");
+    Report("nocase", document, "Basic_JSON", caseInsensitive,
+           [](const std::string& text, const std::string& query) { return NaiveCaseInsensitive(text, query); });
+    Report("whole-word", document, "value", wholeWord, NaiveWholeWord);
+    Report("regex", document, "basic_json<[A-Za-z_]+>", regex, NaiveRegex);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Ranks 100k completion candidates with FuzzyMatcher, next to the prefix filter it
+// replaced (rfind(prefix, 0) == 0 on every candidate, no ranking). "fuzzy" ranks the
+// bare list; "present" passes the per-candidate PresentBytes the completion popup
+// computes once per list, which is what each keystroke costs there. The candidates
+// are the identifiers of the corpus, repeated until there are enough, each in its
+// own std::string like the labels of a completion list.
+//
+// Usage: fin_bench_fuzzy [source-file ...]
+// Without arguments the bundled thirdparty/json.hpp is used.
+
+#include "Core/CharScan.h"
+#include "Core/FuzzyMatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCandidateCount = 100000;
+constexpr size_t kRankLimit = 256; // kMaxCompletionRows, what the popup ranks
+constexpr int kRepetitions = 50;
+
+template <typename Fn>
+double Milliseconds(Fn&& fn, size_t& result) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepetitions; ++i) {
+        result = fn();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / kRepetitions;
+}
+
+void Report(
+    const std::vector<std::string_view>& candidates,
+    const std::vector<uint64_t>& present,
+    const std::string& query) {
+    size_t prefixCount = 0;
+    size_t fuzzyCount = 0;
+    const double prefix = Milliseconds([&] {
+        size_t count = 0;
+        for (const std::string_view candidate : candidates) {
+            count += candidate.rfind(query, 0) == 0 ? 1 : 0;
+        }
+        return count;
+    }, prefixCount);
+    std::vector<uint32_t> ranked;
+    const double fuzzy = Milliseconds([&] {
+        ranked.clear();
+        FuzzyMatcher(query).Rank(candidates, kRankLimit, ranked);
+        return ranked.size();
+    }, fuzzyCount);
+    size_t presentCount = 0;
+    const double withPresent = Milliseconds([&] {
+        ranked.clear();
+        FuzzyMatcher(query).Rank(candidates, present, kRankLimit, ranked);
+        return ranked.size();
+    }, presentCount);
+    std::vector<uint32_t> matches;
+    FuzzyMatcher(query).Filter(candidates, matches);
+    std::printf("  %-10s %9.3f %9.3f %10.3f  %6zu prefix  %6zu fuzzy  best: %.*s\n", query.c_str(), prefix, fuzzy,
+                withPresent, prefixCount, matches.size(), ranked.empty() ? 1 : static_cast<int>(candidates[ranked[0]].size()),
+                ranked.empty() ? "-" : candidates[ranked[0]].data());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string corpus;
+    const int fileCount = argc > 1 ? argc - 1 : 1;
+    for (int i = 0; i < fileCount; ++i) {
+        const char* path = argc > 1 ? argv[i + 1] : FIN_BENCH_DEFAULT_CORPUS;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot read %s\n", path);
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        corpus += buffer.str();
+    }
+
+    std::vector<ByteRun> runs;
+    CollectIdentifierRuns(corpus, 3, runs);
+    std::unordered_set<std::string_view> seen;
+    std::vector<std::string> unique;
+    for (const ByteRun& run : runs) {
+        const std::string_view name(corpus.data() + run.start, run.end - run.start);
+        if (seen.insert(name).second) {
+            unique.emplace_back(name);
+        }
+    }
+    if (unique.empty()) {
+        std::fprintf(stderr, "no identifiers in the corpus\n");
+        return 1;
+    }
+    std::vector<std::string> labels;
+    labels.reserve(kCandidateCount);
+    while (labels.size() < kCandidateCount) {
+        labels.push_back(unique[labels.size() % unique.size()]);
+    }
+    const std::vector<std::string_view> candidates(labels.begin(), labels.end());
+    std::vector<uint64_t> present;
+    present.reserve(candidates.size());
+    for (const std::string_view candidate : candidates) {
+        present.push_back(FuzzyMatcher::PresentBytes(candidate));
+    }
+
+    std::printf("%zu candidates (%zu distinct), best %zu ranked\n  %-10s %9s %9s %10s\n", candidates.size(),
+                unique.size(), kRankLimit, "query", "prefix ms", "fuzzy ms", "present ms");
+    for (const char* query : {"x", "get", "bj", "parse", "iter_imp", "JSON_THROW"}) {
+        Report(candidates, present, query);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Runs the fuzzy matcher and the CharScan block loads it uses on strings held in
+// heap buffers of exactly their size, every length from 0 to past 64 bytes, and
+// compares the results with a plain byte loop. Meant for sanitizer builds: any read
+// past a string's end lands in an AddressSanitizer redzone.
+//
+//   cmake -DFIN_BUILD_BENCHMARKS=ON -DCMAKE_CXX_FLAGS="-fsanitize=address,undefined" ...
+//   fin_check_fuzzy_bounds
+//
+// Exits with 1 and prints the case on the first mismatch.
+
+#include "Core/CharScan.h"
+#include "Core/FuzzyMatch.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMaxLength = 80;
+
+char FoldByte(char ch) {
+    return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+bool NaiveIsSubsequence(std::string_view text, std::string_view query) {
+    const size_t size = std::min(text.size(), ShortStringMasks::kMaxBytes);
+    size_t j = 0;
+    for (size_t i = 0; i < size && j < query.size(); ++i) {
+        j += FoldByte(text[i]) == FoldByte(query[j]) ? 1 : 0;
+    }
+    return !query.empty() && j == query.size();
+}
+
+bool Fail(const char* what, std::string_view query, std::string_view text) {
+    std::printf("%s mismatch: query \"%.*s\", text \"%.*s\" (%zu bytes)\n", what, static_cast<int>(query.size()),
+                query.data(), static_cast<int>(text.size()), text.data(), text.size());
+    return false;
+}
+
+bool Check(const std::vector<std::string_view>& texts, const std::string& query) {
+    const FuzzyMatcher matcher(query);
+    std::vector<uint32_t> filtered;
+    matcher.Filter(texts, filtered);
+    std::vector<uint64_t> present;
+    for (const std::string_view text : texts) {
+        present.push_back(FuzzyMatcher::PresentBytes(text));
+    }
+    std::vector<uint32_t> ranked;
+    matcher.Rank(texts, present, texts.size(), ranked);
+    std::sort(ranked.begin(), ranked.end());
+
+    size_t next = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const bool expected = query.empty() || NaiveIsSubsequence(texts[i], query);
+        const bool inFilter = next < filtered.size() && filtered[next] == i;
+        next += inFilter ? 1 : 0;
+        if (inFilter != expected) {
+            return Fail("Filter", query, texts[i]);
+        }
+        if (std::binary_search(ranked.begin(), ranked.end(), static_cast<uint32_t>(i)) != expected) {
+            return Fail("Rank", query, texts[i]);
+        }
+        if (query.empty()) {
+            continue;
+        }
+        if ((matcher.Score(texts[i]) != FuzzyMatcher::kNoMatch) != expected) {
+            return Fail("Score", query, texts[i]);
+        }
+        const uint64_t matched = matcher.MatchedBytes(texts[i]);
+        const size_t matchedCount = std::bitset<64>(matched).count();
+        if (expected ? matchedCount != query.size() : matched != 0) {
+            return Fail("MatchedBytes", query, texts[i]);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const char* const sources[] = {
+        "getValue_or_default_for_this_long_identifier_name_that_keeps_going_past_sixty_four_bytes",
+        "RenderCompletionPopupWithAVeryLongNameThatCrossesEveryBlockBoundaryOfTheScanner_x",
+        "JSON_HEDLEY_UNLIKELY_and_then_some_more_text_to_reach_beyond_the_sixty_four_byte_limit",
+    };
+
+    // Every prefix of every source, each in its own exact-size allocation.
+    std::vector<std::unique_ptr<char[]>> buffers;
+    std::vector<std::string_view> texts;
+    for (const char* source : sources) {
+        const size_t length = std::min(std::strlen(source), kMaxLength);
+        for (size_t size = 0; size <= length; ++size) {
+            buffers.emplace_back(new char[std::max<size_t>(size, 1)]);
+            std::memcpy(buffers.back().get(), source, size);
+            texts.emplace_back(buffers.back().get(), size);
+        }
+    }
+
+    size_t checks = 0;
+    for (const char* query : {"", "g", "x", "gv", "rcp", "json", "getvalue", "BYTES", "zz"}) {
+        if (!Check(texts, query)) {
+            return 1;
+        }
+        ++checks;
+    }
+    std::printf("%zu texts, %zu queries: ok\n", texts.size(), checks);
+    return 0;
+}
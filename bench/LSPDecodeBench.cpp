@@ -0,0 +1,159 @@
+// Compares full DOM parsing (json::parse + field lookups, the old ReadLoop path)
+// with the selective SAX decoder in Core/LSPMessage.cpp.
+//
+// Usage: fin_bench_lsp_decode [payload.json ...]
+// Each file holds one JSON-RPC message body as recorded from clangd. Without
+// arguments, clangd-shaped completion and diagnostics payloads are generated.
+
+#include "Core/LSPMessage.h"
+
+#include <json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Payload {
+    std::string name;
+    std::string body;
+};
+
+std::string MakeCompletionPayload(int itemCount) {
+    json items = json::array();
+    for (int i = 0; i < itemCount; ++i) {
+        const std::string label = "symbol_" + std::to_string(i);
+        items.push_back({
+            {"label", " " + label + "(int value, const std::string &name)"},
+            {"kind", 3},
+            {"detail", "std::vector<std::string>"},
+            {"documentation", {{"kind", "plaintext"}, {"value", "Generated documentation for " + label + "."}}},
+            {"sortText", "3f" + std::to_string(1000000 + i) + label},
+            {"filterText", label},
+            {"insertText", label},
+            {"insertTextFormat", 1},
+            {"textEdit", {
+                {"range", {{"start", {{"line", 120}, {"character", 8}}}, {"end", {{"line", 120}, {"character", 11}}}}},
+                {"newText", label}
+            }},
+            {"score", 0.5 + i * 1e-6},
+            {"additionalTextEdits", json::array()}
+        });
+    }
+    json msg = {
+        {"jsonrpc", "2.0"},
+        {"id", 42},
+        {"result", {{"isIncomplete", true}, {"items", items}}}
+    };
+    return msg.dump();
+}
+
+std::string MakeDiagnosticsPayload(int diagnosticCount) {
+    json diagnostics = json::array();
+    for (int i = 0; i < diagnosticCount; ++i) {
+        diagnostics.push_back({
+            {"range", {{"start", {{"line", i}, {"character", 4}}}, {"end", {{"line", i}, {"character", 17}}}}},
+            {"severity", 1 + (i % 3)},
+            {"code", "undeclared_var_use"},
+            {"source", "clang"},
+            {"message", "Use of undeclared identifier 'value_" + std::to_string(i) + "'"},
+            {"relatedInformation", json::array({{
+                {"location", {{"uri", "file:///C:/work/project/src/main.cpp"},
+                              {"range", {{"start", {{"line", 1}, {"character", 0}}}, {"end", {{"line", 1}, {"character", 5}}}}}}},
+                {"message", "declared here"}
+            }})}
+        });
+    }
+    json msg = {
+        {"jsonrpc", "2.0"},
+        {"method", "textDocument/publishDiagnostics"},
+        {"params", {{"uri", "file:///C:/work/project/src/main.cpp"}, {"version", 7}, {"diagnostics", diagnostics}}}
+    };
+    return msg.dump();
+}
+
+// Mirrors the extraction the client did before the SAX decoder existed.
+size_t DecodeWithDom(const std::string& body) {
+    const json msg = json::parse(body);
+    size_t count = 0;
+    if (msg.contains("method") && msg["method"] == "textDocument/publishDiagnostics") {
+        auto params = msg["params"];
+        for (auto& d : params["diagnostics"]) {
+            LSPDiagnostic ld;
+            ld.line = d["range"]["start"]["line"];
+            ld.range_start = d["range"]["start"]["character"];
+            ld.range_end = d["range"]["end"]["character"];
+            ld.message = d.value("message", "");
+            ld.severity = d.value("severity", 1);
+            count += ld.message.empty() ? 0 : 1;
+        }
+    } else if (msg.contains("result")) {
+        const json& result = msg["result"];
+        json list = result.is_array() ? result : result.value("items", json::array());
+        for (auto& i : list) {
+            LSPCompletionItem item;
+            item.label = i.value("label", "???");
+            item.detail = i.value("detail", "");
+            item.insertText = i.value("insertText", item.label);
+            count += item.label.empty() ? 0 : 1;
+        }
+    }
+    return count;
+}
+
+size_t DecodeSelective(const std::string& body) {
+    LSPMessage msg;
+    if (!DecodeLSPMessage(body, msg)) return 0;
+    return msg.diagnostics.size() + msg.completionItems.size();
+}
+
+template <typename Fn>
+double MillisecondsPerRun(const std::string& body, int runs, Fn&& decode, size_t& count) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        count = decode(body);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / runs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<Payload> payloads;
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream in(argv[i], std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot read %s\n", argv[i]);
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        payloads.push_back({argv[i], buffer.str()});
+    }
+    if (payloads.empty()) {
+        payloads.push_back({"completion x100", MakeCompletionPayload(100)});
+        payloads.push_back({"completion x5000", MakeCompletionPayload(5000)});
+        payloads.push_back({"diagnostics x20", MakeDiagnosticsPayload(20)});
+        payloads.push_back({"diagnostics x1000", MakeDiagnosticsPayload(1000)});
+    }
+
+    std::printf("%-22s %10s %12s %12s %8s\n", "payload", "bytes", "dom ms", "sax ms", "speedup");
+    for (const Payload& payload : payloads) {
+        const int runs = payload.body.size() > 1000000 ? 20 : 200;
+        size_t domCount = 0;
+        size_t saxCount = 0;
+        const double dom = MillisecondsPerRun(payload.body, runs, DecodeWithDom, domCount);
+        const double sax = MillisecondsPerRun(payload.body, runs, DecodeSelective, saxCount);
+        std::printf("%-22s %10zu %12.3f %12.3f %7.2fx%s\n",
+                    payload.name.c_str(), payload.body.size(), dom, sax, dom / sax,
+                    domCount == saxCount ? "" : "  (item count mismatch!)");
+    }
+    return 0;
+}
@@ -1,9 +1,24 @@
 set(FIN_CORE_SOURCES
+    src/Core/BackgroundLexer.cpp
+    src/Core/CharScan.cpp
     src/Core/Compiler.cpp
     src/Core/ConfigManager.cpp
+    src/Core/CppLexer.cpp
+    src/Core/FileContents.cpp
     src/Core/FileManager.cpp
+    src/Core/FindEngine.cpp
+    src/Core/FuzzyMatch.cpp
+    src/Core/IdentifierIndex.cpp
+    src/Core/LinearRegex.cpp
     src/Core/LSPClient.cpp
+    src/Core/LSPFramer.cpp
+    src/Core/LSPMessage.cpp
+    src/Core/LSPTransport.cpp
+    src/Core/SymbolIndex.cpp
     src/Core/Terminal.cpp
+    src/Core/TextDocument.cpp
+    src/Core/TrigramIndex.cpp
+    src/Core/WorkspaceSearch.cpp
 )
 
 set(FIN_APP_SOURCES
@@ -11,15 +26,19 @@ set(FIN_APP_SOURCES
     src/App/FinCompletionLocal.cpp
     src/App/FinCompletionUi.cpp
     src/App/FinDockingUi.cpp
+    src/App/FinDocument.cpp
     src/App/FinEditorAssists.cpp
     src/App/FinStatusBar.cpp
     src/App/FinI18n.cpp
     src/App/FinHelpers.cpp
+    src/App/FinHighlight.cpp
+    src/App/FinMinimap.cpp
     src/App/Panels/ConsolePanel.cpp
     src/App/Panels/EditorPanel.cpp
     src/App/Panels/ExplorerPanel.cpp
     src/App/Panels/LspDiagnosticsPanel.cpp
     src/App/Panels/PersonalizationPanel.cpp
+    src/App/Panels/SearchResultsPanel.cpp
     src/App/Panels/SettingsPanel.cpp
     src/App/Panels/TerminalPanel.cpp
 )
@@ -8,6 +8,7 @@
 #include "App/FinCompletionLocal.h"
 #include "App/FinCompletionUi.h"
 #include "App/FinDockingUi.h"
+#include "App/FinDocument.h"
 #include "App/FinEditorAssists.h"
 #include "App/FinHelpers.h"
 #include "App/FinI18n.h"
@@ -18,15 +19,21 @@
 #include "App/Panels/ExplorerPanel.h"
 #include "App/Panels/LspDiagnosticsPanel.h"
 #include "App/Panels/PersonalizationPanel.h"
+#include "App/Panels/SearchResultsPanel.h"
 #include "App/Panels/SettingsPanel.h"
 #include "App/Panels/TerminalPanel.h"
 
 #include "Core/AppConfig.h"
+#include "Core/BackgroundLexer.h"
 #include "Core/Compiler.h"
 #include "Core/ConfigManager.h"
 #include "Core/FileManager.h"
+#include "Core/FuzzyMatch.h"
 #include "Core/LSPClient.h"
+#include "Core/SymbolIndex.h"
 #include "Core/Terminal.h"
+#include "Core/TrigramIndex.h"
+#include "Core/WorkspaceSearch.h"
 
 #include <algorithm>
 #include <chrono>
@@ -41,7 +48,6 @@
 #include <sstream>
 #include <string>
 #include <system_error>
-#include <unordered_set>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -73,12 +79,28 @@ int RunFinApp() {
 
     LSPClient lsp;
     bool lspActive = false;
-    std::mutex lspMutex;
-    std::map<std::string, std::vector<LSPDiagnostic>> pendingDiagnostics;
-    std::vector<LSPCompletionItem> pendingCompletions;
-    bool pendingCompletionReady = false;
     int completionRequestToken = 0;
 
+    BackgroundLexer backgroundLexer;
+    WorkspaceSearch workspaceSearch;
+    SearchResultsState searchResults;
+    // Kept next to fin.ini; deleted whenever the index is off in the settings, so a
+    // disabled index leaves nothing stale behind.
+    constexpr const char* kWorkspaceIndexFile = "fin.trigrams";
+    std::unique_ptr<TrigramIndex> workspaceIndex;
+    constexpr const char* kSymbolIndexFile = "fin.symbols";
+    std::unique_ptr<SymbolIndex> symbolIndex;
+    const auto removeIndexFile = [](const char* file) {
+        std::error_code ec;
+        fs::remove(fs::u8path(file), ec);
+    };
+    if (!config.workspaceIndexEnabled) {
+        removeIndexFile(kWorkspaceIndexFile);
+    }
+    if (!config.symbolIndexEnabled) {
+        removeIndexFile(kSymbolIndexFile);
+    }
+
     std::vector<std::unique_ptr<DocumentTab>> docs;
     int activeTab = -1;
     int tabCounter = 1;
@@ -101,6 +123,7 @@ int RunFinApp() {
     bool showConsoleTab = true;
     bool showLspDiagnosticsTab = true;
     bool showTerminalTab = true;
+    bool showSearchResultsTab = true;
     bool showPersonalizationTab = false;
 
     std::string terminalInput;
@@ -115,7 +138,6 @@ int RunFinApp() {
     CompletionUiState completionState;
     bool& completionVisible = completionState.visible;
     bool& completionLoading = completionState.loading;
-    std::vector<LSPCompletionItem>& completionItems = completionState.items;
     int& completionOwnerTab = completionState.ownerTab;
     std::string& completionOwnerDocumentPath = completionState.ownerDocumentPath;
 
@@ -183,28 +205,24 @@ int RunFinApp() {
         const std::string& lspDocumentPath = ensureLspDocumentPath(tab);
         if (lspDocumentPath.empty()) {
             tab.lspOpened = false;
-            tab.lspTextSnapshot.clear();
             tab.lspDiagnostics.clear();
             return;
         }
 
-        const std::string text = tab.editor.getText();
-        lsp.DidOpen(lspDocumentPath, text);
+        lsp.DidOpen(lspDocumentPath, tab.document.Text());
         tab.lspOpened = true;
-        tab.lspTextSnapshot = text;
     };
 
     auto closeCompletionPopup = [&]() {
         ++completionRequestToken;
+        lsp.CancelRequests("textDocument/completion");
         completionVisible = false;
         completionLoading = false;
-        completionItems.clear();
+        SetCompletionItems(completionState, {});
+        completionState.rows.clear();
         ResetCompletionInteractionState(completionState);
         completionOwnerTab = -1;
         completionOwnerDocumentPath.clear();
-        std::lock_guard<std::mutex> lock(lspMutex);
-        pendingCompletions.clear();
-        pendingCompletionReady = false;
     };
 
     auto stopLsp = [&]() {
@@ -218,14 +236,8 @@ int RunFinApp() {
 
         for (auto& tab : docs) {
             tab->lspOpened = false;
-            tab->lspTextSnapshot.clear();
             tab->lspDiagnostics.clear();
         }
-
-        std::lock_guard<std::mutex> lock(lspMutex);
-        pendingDiagnostics.clear();
-        pendingCompletions.clear();
-        pendingCompletionReady = false;
     };
 
     auto startLsp = [&]() -> bool {
@@ -233,6 +245,7 @@ int RunFinApp() {
             return true;
         }
 
+        lsp.SetChangeCoalesceWindow(std::chrono::milliseconds(config.lspChangeDelayMs));
         if (!lsp.Start()) {
             statusText = fst::i18n("status.lsp_start_failed");
             return false;
@@ -243,8 +256,11 @@ int RunFinApp() {
             if (!isLspCppPath(path)) {
                 return;
             }
-            std::lock_guard<std::mutex> lock(lspMutex);
-            pendingDiagnostics[path] = diags;
+            for (auto& tab : docs) {
+                if (ensureLspDocumentPath(*tab) == path) {
+                    tab->lspDiagnostics = diags;
+                }
+            }
         });
 
         lsp.Initialize(fs::current_path().string());
@@ -278,10 +294,10 @@ int RunFinApp() {
         tab->name = name;
         tab->path = path.empty() ? std::string() : normalizePath(path);
         tab->lspDocumentPath = tab->path;
-        tab->editor.setText(text);
-        applyCppSyntaxHighlighting(tab->editor, tab->path.empty() ? tab->name : tab->path, ctx.theme());
+        ResetDocumentText(*tab, text);
+        applyCppSyntaxHighlighting(*tab, ctx.theme());
         (void)ensureLspDocumentPath(*tab);
-        tab->savedText = text;
+        MarkDocumentSaved(*tab);
         docs.push_back(std::move(tab));
         activeTab = static_cast<int>(docs.size()) - 1;
         sendDidOpenIfPossible(*docs.back());
@@ -329,16 +345,7 @@ int RunFinApp() {
             return false;
         }
 
-        auto toLowerAscii = [](std::string value) {
-            std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) {
-                return static_cast<char>(std::tolower(ch));
-            });
-            return value;
-        };
-        static const std::unordered_set<std::string> kBlockedBinaryExtensions = {
-            ".exe", ".dll", ".lib", ".a", ".obj", ".o", ".so", ".dylib", ".pdb", ".ilk", ".class"};
-        const std::string ext = toLowerAscii(fs::path(normalizedPath).extension().string());
-        if (kBlockedBinaryExtensions.count(ext) > 0) {
+        if (HasBinaryExtension(fs::path(normalizedPath))) {
             statusText = fst::i18n("status.unsupported_file_type", {normalizedPath});
             return false;
         }
@@ -373,25 +380,32 @@ int RunFinApp() {
         tab.path = normalizedPath;
         tab.name = fs::path(normalizedPath).filename().string();
         const std::string& lspDocumentPath = ensureLspDocumentPath(tab);
-        applyCppSyntaxHighlighting(tab.editor, tab.path, ctx.theme());
+        applyCppSyntaxHighlighting(tab, ctx.theme());
 
-        std::string text = tab.editor.getText();
+        SyncDocumentFromEditor(ctx, tab, true);
+        const std::string& text = tab.document.Text();
         SaveFile(tab.path, text);
-        tab.savedText = text;
-        tab.dirty = false;
+        MarkDocumentSaved(tab);
+        if (workspaceIndex) {
+            workspaceIndex->OnFileChanged(tab.path);
+        }
+        if (symbolIndex) {
+            symbolIndex->OnFileChanged(tab.path);
+        }
 
         if (lspDocumentPath.empty()) {
             tab.lspOpened = false;
-            tab.lspTextSnapshot.clear();
             tab.lspDiagnostics.clear();
         } else if (lspActive) {
             if (!tab.lspOpened || previousLspPath != lspDocumentPath) {
                 lsp.DidOpen(lspDocumentPath, text);
                 tab.lspOpened = true;
-            } else {
+            } else if (lsp.SupportsIncrementalSync()) {
+                lsp.DidChange(lspDocumentPath, tab.pendingChanges);
+            } else if (!tab.pendingChanges.empty()) {
                 lsp.DidChange(lspDocumentPath, text);
             }
-            tab.lspTextSnapshot = text;
+            tab.pendingChanges.clear();
         }
 
         currentPath = fs::path(normalizedPath).parent_path();
@@ -431,10 +445,16 @@ int RunFinApp() {
             return;
         }
 
-        std::string text = tab.editor.getText();
+        SyncDocumentFromEditor(ctx, tab, true);
+        const std::string& text = tab.document.Text();
         SaveFile(tab.path, text);
-        tab.savedText = text;
-        tab.dirty = false;
+        MarkDocumentSaved(tab);
+        if (workspaceIndex) {
+            workspaceIndex->OnFileChanged(tab.path);
+        }
+        if (symbolIndex) {
+            symbolIndex->OnFileChanged(tab.path);
+        }
 
         const std::string preferredCompiler = config.clangBuildEnabled ? "clang++" : "g++";
         const std::string fallbackCompiler = config.clangBuildEnabled ? "g++" : "clang++";
@@ -487,7 +507,19 @@ int RunFinApp() {
         const std::string& lspDocumentPath = ensureLspDocumentPath(tab);
         const std::string ownerPath = lspDocumentPath.empty() ? tab.id : lspDocumentPath;
         fst::TextPosition cursor = tab.editor.cursor();
-        std::vector<LSPCompletionItem> localFallback = CollectLocalCompletions(tab, cursor);
+        const size_t cursorOffset = offsetFromPosition(tab.document, cursor);
+        const std::string typedWord = CompletionWordBefore(tab.document, cursorOffset);
+        const size_t wordStart = cursorOffset - typedWord.size();
+
+        // The open list still covers this word: narrow it instead of asking again.
+        const bool sameOwner = completionVisible && completionOwnerTab == activeTab;
+        if (sameOwner && CompletionSessionCovers(completionState, wordStart, typedWord)) {
+            FilterCompletionItems(completionState, typedWord);
+            return;
+        }
+
+        const std::shared_ptr<const SymbolTable> workspaceSymbols = symbolIndex ? symbolIndex->Table() : nullptr;
+        std::vector<LSPCompletionItem> localFallback = CollectLocalCompletions(tab, cursor, workspaceSymbols.get());
 
         bool canUseLsp = false;
         if (config.autocompleteEnabled && !lspDocumentPath.empty()) {
@@ -503,25 +535,49 @@ int RunFinApp() {
                 if (manualRequest) {
                     statusText = fst::i18n("status.no_suggestions");
                 }
+                if (sameOwner) {
+                    closeCompletionPopup();
+                }
                 return;
             }
-            ShowCompletionPopup(completionState, activeTab, std::move(localFallback), false, ownerPath);
+            ShowCompletionPopup(
+                completionState, activeTab, std::move(localFallback), typedWord, wordStart, false, ownerPath);
             return;
         }
-        ShowCompletionPopup(completionState, activeTab, localFallback, localFallback.empty(), ownerPath);
+        if (sameOwner && completionState.serverItems) {
+            // Re-asking within a session (incomplete list, or a new word): the server
+            // items stay on screen, narrowed, until the fresh ones arrive.
+            completionState.sessionWord = typedWord;
+            completionState.sessionWordStart = wordStart;
+            FilterCompletionItems(completionState, typedWord);
+        } else {
+            ShowCompletionPopup(
+                completionState, activeTab, localFallback, typedWord, wordStart, localFallback.empty(), ownerPath);
+        }
 
         const int requestToken = ++completionRequestToken;
         lsp.RequestCompletion(
             lspDocumentPath,
             cursor.line,
-            cursor.column,
-            [&, requestToken, localFallback](const std::vector<LSPCompletionItem>& items) {
-            std::lock_guard<std::mutex> lock(lspMutex);
+            lspCharacterFromPosition(tab.document, cursor),
+            [&, requestToken, localFallback](const LSPCompletionList& list) {
             if (requestToken != completionRequestToken) {
                 return;
             }
-            pendingCompletions = items.empty() ? localFallback : items;
-            pendingCompletionReady = true;
+            completionLoading = false;
+            completionState.serverItems = !list.items.empty();
+            completionState.incomplete = list.isIncomplete;
+            // Ranked against what has been typed since the request went out.
+            SetCompletionItems(completionState, list.items.empty() ? localFallback : list.items);
+            FilterCompletionItems(completionState, completionState.filter);
+        },
+            [&, requestToken]() {
+            // Error or timeout (e.g. clangd still building the preamble): keep what is
+            // shown, the local items or the narrowed previous list, and stop waiting.
+            if (requestToken != completionRequestToken) {
+                return;
+            }
+            completionLoading = false;
         });
     };
 
@@ -534,51 +590,54 @@ int RunFinApp() {
         DocumentTab& tab = *docs[activeTab];
         fst::TextPosition cursor = tab.editor.cursor();
         std::string insertion = item.insertText.empty() ? item.label : item.insertText;
-        std::string currentText = tab.editor.getText();
-        size_t cursorOffset = offsetFromPosition(currentText, cursor);
-        if (cursorOffset > currentText.size()) {
-            cursorOffset = currentText.size();
-        }
-
-        size_t prefixStart = cursorOffset;
-        while (prefixStart > 0) {
-            const char ch = currentText[prefixStart - 1];
-            const unsigned char uch = static_cast<unsigned char>(ch);
-            if (std::isalnum(uch) || ch == '_') {
-                --prefixStart;
-                continue;
-            }
-            break;
-        }
+        const size_t cursorOffset = offsetFromPosition(tab.document, cursor);
 
-        const std::string typedPrefix = currentText.substr(prefixStart, cursorOffset - prefixStart);
+        // The typed word is replaced when the item was matched by it, which also
+        // covers fuzzy matches such as "gd" for "getData".
+        const std::string typedWord = CompletionWordBefore(tab.document, cursorOffset);
         size_t insertionOffset = cursorOffset;
-        if (!typedPrefix.empty() && insertion.rfind(typedPrefix, 0) == 0) {
-            insertionOffset = prefixStart;
-            currentText.erase(prefixStart, cursorOffset - prefixStart);
+        if (!typedWord.empty() &&
+            FuzzyMatcher(typedWord).Score(CompletionFilterText(item)) != FuzzyMatcher::kNoMatch) {
+            insertionOffset = cursorOffset - typedWord.size();
         }
 
-        currentText.insert(insertionOffset, insertion);
-        std::string newText = std::move(currentText);
-
-        fst::TextPosition newCursor = positionFromOffset(newText, insertionOffset + insertion.size());
+        EditDocument(tab, insertionOffset, cursorOffset - insertionOffset, insertion);
+        PushDocumentToEditor(tab, positionFromOffset(tab.document, insertionOffset + insertion.size()));
 
-        tab.editor.setText(newText);
-        tab.editor.setCursor(newCursor);
-        tab.dirty = (newText != tab.savedText);
+        closeCompletionPopup();
+    };
 
-        const std::string& lspDocumentPath = ensureLspDocumentPath(tab);
-        if (lspActive && !lspDocumentPath.empty()) {
-            if (!tab.lspOpened) {
-                lsp.DidOpen(lspDocumentPath, newText);
-                tab.lspOpened = true;
-            } else {
-                lsp.DidChange(lspDocumentPath, newText);
-            }
-            tab.lspTextSnapshot = newText;
+    // Typing while the popup is open narrows the session's list client-side; leaving
+    // the word closes it.
+    auto refilterCompletionForActive = [&]() {
+        clampActiveTab();
+        if (!completionVisible || activeTab < 0 || completionOwnerTab != activeTab) {
+            return;
+        }
+        DocumentTab& tab = *docs[activeTab];
+        if (!tab.editorChange) {
+            return;
+        }
+        const size_t cursorOffset = offsetFromPosition(tab.document, tab.editor.cursor());
+        std::string typedWord = CompletionWordBefore(tab.document, cursorOffset);
+        if (typedWord == completionState.filter) {
+            return;
+        }
+        if (typedWord.empty()) {
+            closeCompletionPopup();
+            return;
+        }
+        // Back to clangd only when the cached list cannot answer: it was incomplete,
+        // the word now starts elsewhere or got shorter than what was asked for.
+        const size_t wordStart = cursorOffset - typedWord.size();
+        if (!CompletionSessionCovers(completionState, wordStart, typedWord) && config.autocompleteEnabled) {
+            requestCompletionForActive(false);
+            return;
+        }
+        FilterCompletionItems(completionState, std::move(typedWord));
+        if (completionState.matches.empty() && !completionLoading) {
+            closeCompletionPopup();
         }
-
-        closeCompletionPopup();
     };
 
     const std::function<void(const LSPCompletionItem&)> applyCompletionFromUi = [&](const LSPCompletionItem& item) {
@@ -587,7 +646,7 @@ int RunFinApp() {
 
     const auto refreshEditorsAfterThemeChange = [&]() {
         for (auto& tab : docs) {
-            applyCppSyntaxHighlighting(tab->editor, tab->path.empty() ? tab->name : tab->path, ctx.theme());
+            applyCppSyntaxHighlighting(*tab, ctx.theme());
         }
     };
 
@@ -611,6 +670,7 @@ int RunFinApp() {
     bool pendingMenuCloseTab = false;
     bool pendingMenuBuild = false;
     bool pendingMenuFind = false;
+    bool pendingMenuFindInFiles = false;
     bool pendingMenuAutocomplete = false;
     bool pendingThemeChange = false;
     int pendingDockTabFocus = -1;
@@ -620,6 +680,7 @@ int RunFinApp() {
         showConsoleTab,
         showLspDiagnosticsTab,
         showTerminalTab,
+        showSearchResultsTab,
         showSettingsWindow,
         showPersonalizationTab);
     std::unordered_map<int, fst::DockNode::Id> lastDockNodeByWindow;
@@ -638,6 +699,7 @@ int RunFinApp() {
 
         std::vector<fst::MenuItem> editItems;
         editItems.emplace_back("find", fst::i18n("menu.edit.find"), [&]() { pendingMenuFind = true; }).withShortcut("Ctrl+F");
+        editItems.emplace_back("find_in_files", fst::i18n("menu.edit.find_in_files"), [&]() { pendingMenuFindInFiles = true; }).withShortcut("Ctrl+Shift+F");
         editItems.emplace_back("autocomplete", fst::i18n("menu.edit.autocomplete"), [&]() { pendingMenuAutocomplete = true; }).withShortcut("Ctrl+Space");
         menuBar.addMenu(fst::i18n("menu.edit"), editItems);
 
@@ -651,6 +713,7 @@ int RunFinApp() {
         viewItems.emplace_back("view_console", fst::i18n("menu.view.console"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::Console, &showConsoleTab); });
         viewItems.emplace_back("view_lsp_diagnostics", fst::i18n("menu.view.lsp_diagnostics"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::LspDiagnostics, &showLspDiagnosticsTab); });
         viewItems.emplace_back("view_terminal", fst::i18n("menu.view.terminal"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::Terminal, &showTerminalTab); });
+        viewItems.emplace_back("view_search_results", fst::i18n("menu.view.search_results"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::SearchResults, &showSearchResultsTab); });
         viewItems.emplace_back("view_settings", fst::i18n("menu.view.settings"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::Settings, &showSettingsWindow); });
         viewItems.emplace_back("view_personalization", fst::i18n("menu.view.personalization"), [&]() { RequestDockTab(pendingDockTabFocus, DockWindowId::Personalization, &showPersonalizationTab); });
         viewItems.emplace_back(fst::MenuItem::checkbox("view_minimap", fst::i18n("menu.view.minimap"), &config.minimapEnabled));
@@ -712,28 +775,8 @@ int RunFinApp() {
         }
         trimBuffer(terminalHistory, 200000);
 
-        {
-            std::lock_guard<std::mutex> lock(lspMutex);
-            for (const auto& [path, diags] : pendingDiagnostics) {
-                for (auto& tab : docs) {
-                    if (ensureLspDocumentPath(*tab) == path) {
-                        tab->lspDiagnostics = diags;
-                    }
-                }
-            }
-            pendingDiagnostics.clear();
-
-            if (pendingCompletionReady) {
-                completionItems = pendingCompletions;
-                completionLoading = false;
-                completionState.selected =
-                    completionItems.empty()
-                        ? 0
-                        : std::min(completionState.selected, static_cast<int>(completionItems.size()) - 1);
-                ResetCompletionNavigationState(completionState);
-                pendingCompletionReady = false;
-            }
-        }
+        // LSP responses and diagnostics are applied here, on the UI thread.
+        lsp.DispatchPending();
 
         if (std::abs(textScale - appliedTextScale) > 0.001f) {
             loadUiFontForScale(textScale);
@@ -755,6 +798,7 @@ int RunFinApp() {
         bool actionCloseTab = pendingMenuCloseTab;
         bool actionBuild = pendingMenuBuild;
         bool actionFind = pendingMenuFind;
+        bool actionFindInFiles = pendingMenuFindInFiles;
         bool actionAutocomplete = pendingMenuAutocomplete;
         bool themeChanged = pendingThemeChange;
 
@@ -764,6 +808,7 @@ int RunFinApp() {
         pendingMenuCloseTab = false;
         pendingMenuBuild = false;
         pendingMenuFind = false;
+        pendingMenuFindInFiles = false;
         pendingMenuAutocomplete = false;
         pendingThemeChange = false;
 
@@ -781,7 +826,8 @@ int RunFinApp() {
         if (input.modifiers().ctrl && input.isKeyPressed(fst::Key::O)) actionOpen = true;
         if (input.modifiers().ctrl && input.isKeyPressed(fst::Key::S)) actionSave = true;
         if (input.modifiers().ctrl && input.isKeyPressed(fst::Key::W)) actionCloseTab = true;
-        if (input.modifiers().ctrl && input.isKeyPressed(fst::Key::F)) actionFind = true;
+        if (input.modifiers().ctrl && !input.modifiers().shift && input.isKeyPressed(fst::Key::F)) actionFind = true;
+        if (input.modifiers().ctrl && input.modifiers().shift && input.isKeyPressed(fst::Key::F)) actionFindInFiles = true;
         if (input.modifiers().ctrl && input.isKeyPressed(fst::Key::Space)) actionAutocomplete = true;
         if (input.isKeyPressed(fst::Key::F5)) actionBuild = true;
         if (completionVisible && input.isKeyPressed(fst::Key::Escape)) {
@@ -820,6 +866,10 @@ int RunFinApp() {
                 docs[activeTab]->findFocusPending = true;
             }
         }
+        if (actionFindInFiles) {
+            RequestDockTab(pendingDockTabFocus, DockWindowId::SearchResults, &showSearchResultsTab);
+            searchResults.focusPending = true;
+        }
         if (actionAutocomplete) {
             requestCompletionForActive(true);
         }
@@ -839,6 +889,7 @@ int RunFinApp() {
             fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::Console), bottomNode);
             fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::LspDiagnostics), bottomNode);
             fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::Terminal), bottomNode);
+            fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::SearchResults), bottomNode);
             fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::Settings), centerNode);
             fst::DockBuilder::DockWindow(ctx, DockWindowTitle(DockWindowId::Personalization), centerNode);
 
@@ -940,18 +991,6 @@ int RunFinApp() {
             RenderExplorerPanel(ctx, currentPath, openDocument);
         }
 
-        int assistPreTab = -1;
-        bool assistHasPreState = false;
-        std::string assistPreText;
-        fst::TextPosition assistPreCursor{};
-        clampActiveTab();
-        if (activeTab >= 0 && activeTab < static_cast<int>(docs.size())) {
-            assistPreTab = activeTab;
-            assistHasPreState = true;
-            assistPreText = docs[activeTab]->editor.getText();
-            assistPreCursor = docs[activeTab]->editor.cursor();
-        }
-
         if (showEditorTab) {
             RenderEditorPanel(
                 ctx,
@@ -965,6 +1004,7 @@ int RunFinApp() {
                 completionOwnerDocumentPath,
                 lspActive,
                 lsp,
+                backgroundLexer,
                 clampActiveTab,
                 closeTab,
                 closeCompletionPopup);
@@ -976,14 +1016,11 @@ int RunFinApp() {
                 input,
                 docs,
                 activeTab,
-                assistHasPreState,
-                assistPreTab,
-                assistPreText,
-                assistPreCursor,
                 completionVisible,
                 clampActiveTab,
                 closeCompletionPopup);
         }
+        refilterCompletionForActive();
         HandleCompletionKeyboardNavigation(ctx, input, completionState, applyCompletionFromUi);
         const CompletionWindowRenderResult completionWindowResult =
             RenderCompletionPopup(ctx, input, completionState, applyCompletionFromUi);
@@ -996,6 +1033,36 @@ int RunFinApp() {
         if (showTerminalTab) {
             RenderTerminalPanel(ctx, terminal, terminalHistory, terminalInput);
         }
+        if (config.workspaceIndexEnabled && !workspaceIndex) {
+            // Like the symbol index, rooted at the folder it was opened for; Find in
+            // Files from its subfolders filters through it without re-rooting.
+            workspaceIndex = std::make_unique<TrigramIndex>(kWorkspaceIndexFile);
+            workspaceIndex->Open(currentPath);
+        } else if (!config.workspaceIndexEnabled && workspaceIndex) {
+            // Joins the index worker, so nothing writes the file after this.
+            workspaceIndex.reset();
+            removeIndexFile(kWorkspaceIndexFile);
+        }
+        if (config.symbolIndexEnabled && !symbolIndex) {
+            // Stays on the folder it was opened for; saving files elsewhere must not re-root it.
+            symbolIndex = std::make_unique<SymbolIndex>(kSymbolIndexFile);
+            symbolIndex->Open(currentPath);
+        } else if (!config.symbolIndexEnabled && symbolIndex) {
+            symbolIndex.reset();
+            removeIndexFile(kSymbolIndexFile);
+        }
+        if (showSearchResultsTab) {
+            RenderSearchResultsPanel(
+                ctx,
+                workspaceSearch,
+                workspaceIndex.get(),
+                searchResults,
+                currentPath,
+                docs,
+                activeTab,
+                openDocument,
+                clampActiveTab);
+        }
 
         RenderSettingsPanel(
             ctx,
@@ -1,30 +1,43 @@
 #include "App/FinCompletionLocal.h"
 
 #include "App/FinHelpers.h"
+#include "Core/CharScan.h"
+#include "Core/FuzzyMatch.h"
+#include "Core/IdentifierIndex.h"
 
-#include <cctype>
+#include <algorithm>
+#include <cstddef>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace fin {
 
-std::vector<LSPCompletionItem> CollectLocalCompletions(
-    const DocumentTab& tab,
-    const fst::TextPosition& cursor) {
-    std::vector<LSPCompletionItem> out;
+namespace {
 
-    const std::string fullText = tab.editor.getText();
-    size_t offset = offsetFromPosition(fullText, cursor);
-    if (offset > fullText.size()) {
-        offset = fullText.size();
-    }
+constexpr size_t kMaxLocalCompletions = 40;
 
-    size_t lineStart = offset;
-    while (lineStart > 0 && fullText[lineStart - 1] != '\n') {
-        --lineStart;
+} // namespace
+
+std::string CompletionWordBefore(const TextDocument& document, size_t offset) {
+    const size_t lineStart = document.LineStart(document.LineFromOffset(offset));
+    size_t start = offset;
+    while (start > lineStart && IsIdentifierByte(document.CharAt(start - 1))) {
+        --start;
     }
-    const std::string beforeCursor = fullText.substr(lineStart, offset - lineStart);
+    return document.Substr(start, offset - start);
+}
+
+std::vector<LSPCompletionItem> CollectLocalCompletions(
+    DocumentTab& tab,
+    const fst::TextPosition& cursor,
+    const SymbolTable* workspaceSymbols) {
+    std::vector<LSPCompletionItem> out;
+
+    const size_t offset = offsetFromPosition(tab.document, cursor);
+    const size_t lineStart = tab.document.LineStart(tab.document.LineFromOffset(offset));
+    const std::string beforeCursor = tab.document.Substr(lineStart, offset - lineStart);
 
     bool inStdScope = false;
     std::string typedPrefix;
@@ -34,9 +47,7 @@ std::vector<LSPCompletionItem> CollectLocalCompletions(
         size_t idEnd = scopePos;
         size_t idStart = idEnd;
         while (idStart > 0) {
-            const char ch = beforeCursor[idStart - 1];
-            const unsigned char uch = static_cast<unsigned char>(ch);
-            if (std::isalnum(uch) || ch == '_') {
+            if (IsIdentifierByte(beforeCursor[idStart - 1])) {
                 --idStart;
                 continue;
             }
@@ -53,9 +64,7 @@ std::vector<LSPCompletionItem> CollectLocalCompletions(
     if (!inStdScope) {
         size_t idStart = beforeCursor.size();
         while (idStart > 0) {
-            const char ch = beforeCursor[idStart - 1];
-            const unsigned char uch = static_cast<unsigned char>(ch);
-            if (std::isalnum(uch) || ch == '_') {
+            if (IsIdentifierByte(beforeCursor[idStart - 1])) {
                 --idStart;
                 continue;
             }
@@ -83,63 +92,56 @@ std::vector<LSPCompletionItem> CollectLocalCompletions(
         "set", "shared_ptr", "sort", "span", "stack", "string", "string_view", "swap", "tuple",
         "unordered_map", "unordered_set", "unique_ptr", "vector"};
 
-    std::unordered_set<std::string> seen;
-    std::vector<std::string> candidates;
-    candidates.reserve(256);
-
-    auto pushCandidate = [&](const std::string& value) {
-        if (value.empty() || seen.count(value) > 0) {
-            return;
-        }
-        seen.insert(value);
-        candidates.push_back(value);
-    };
-
-    if (inStdScope) {
-        for (const auto& s : kStdSymbols) {
-            pushCandidate(s);
-        }
-    } else {
-        for (const auto& s : kCppKeywords) {
-            pushCandidate(s);
+    // Each source ranks its own fuzzy matches (the document and workspace ones from
+    // their indexes, no scan of the text); the merged list is ordered by score, sources
+    // in this order on ties.
+    const FuzzyMatcher matcher(typedPrefix);
+    const std::vector<std::string>& fixedNames = inStdScope ? kStdSymbols : kCppKeywords;
+    std::vector<std::string_view> fixedViews(fixedNames.begin(), fixedNames.end());
+    std::vector<uint32_t> fixedOrder;
+    matcher.Rank(fixedViews, kMaxLocalCompletions, fixedOrder);
+
+    std::vector<std::pair<std::string, const char*>> candidates;
+    for (const uint32_t index : fixedOrder) {
+        if (fixedNames[index] != typedPrefix) {
+            candidates.emplace_back(fixedNames[index], "local");
         }
     }
-
-    std::string token;
-    token.reserve(32);
-    for (char ch : fullText) {
-        const unsigned char uch = static_cast<unsigned char>(ch);
-        if (std::isalnum(uch) || ch == '_') {
-            token.push_back(ch);
-        } else {
-            if (token.size() >= 3) {
-                pushCandidate(token);
-            }
-            token.clear();
-        }
+    std::vector<std::string> identifiers;
+    tab.identifiers.Complete(tab.document, matcher, kMaxLocalCompletions, identifiers);
+    for (std::string& name : identifiers) {
+        candidates.emplace_back(std::move(name), "local");
     }
-    if (token.size() >= 3) {
-        pushCandidate(token);
+    if (workspaceSymbols != nullptr) {
+        std::vector<WorkspaceSymbol> symbols;
+        workspaceSymbols->Complete(matcher, kMaxLocalCompletions, symbols);
+        for (const WorkspaceSymbol& symbol : symbols) {
+            candidates.emplace_back(std::string(symbol.name), "workspace");
+        }
     }
 
-    for (const std::string& candidate : candidates) {
-        if (!typedPrefix.empty() && candidate.rfind(typedPrefix, 0) != 0) {
-            continue;
-        }
-        if (!typedPrefix.empty() && candidate == typedPrefix) {
+    std::vector<std::pair<int, size_t>> ranked;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        ranked.emplace_back(matcher.Score(candidates[i].first), i);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& entry : ranked) {
+        const std::pair<std::string, const char*>& candidate = candidates[entry.second];
+        const bool listed = std::any_of(out.begin(), out.end(), [&](const LSPCompletionItem& item) {
+            return item.label == candidate.first;
+        });
+        if (listed) {
             continue;
         }
 
         LSPCompletionItem item;
-        item.label = candidate;
-        item.detail = "local";
-        item.insertText = typedPrefix.empty() ? candidate : candidate.substr(typedPrefix.size());
-        if (item.insertText.empty()) {
-            item.insertText = candidate;
-        }
-
-        out.push_back(item);
-        if (out.size() >= 40) {
+        item.label = candidate.first;
+        item.detail = candidate.second;
+        // The whole name: applying it replaces the typed word, which need not be a prefix.
+        item.insertText = candidate.first;
+        out.push_back(std::move(item));
+        if (out.size() >= kMaxLocalCompletions) {
             break;
         }
     }
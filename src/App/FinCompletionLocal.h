@@ -5,13 +5,24 @@
 #endif
 
 #include "App/FinTypes.h"
+#include "Core/SymbolIndex.h"
 
+#include <cstddef>
+#include <string>
 #include <vector>
 
 namespace fin {
 
+// Identifier bytes directly before `offset` (possibly none): the word completion
+// items are filtered by and that applying one replaces.
+std::string CompletionWordBefore(const TextDocument& document, size_t offset);
+
+// Keywords, identifiers of the tab and, when `workspaceSymbols` is given, symbols of
+// the other workspace sources that fuzzy-match the word before the cursor, best
+// match first.
 std::vector<LSPCompletionItem> CollectLocalCompletions(
-    const DocumentTab& tab,
-    const fst::TextPosition& cursor);
+    DocumentTab& tab,
+    const fst::TextPosition& cursor,
+    const SymbolTable* workspaceSymbols);
 
 } // namespace fin
@@ -1,10 +1,14 @@
 #include "App/FinCompletionUi.h"
 
 #include "App/FinHelpers.h"
+#include "App/FinHighlight.h"
+#include "Core/CharScan.h"
+#include "Core/FuzzyMatch.h"
 
 #include <algorithm>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace fin {
@@ -21,12 +25,12 @@ float completionItemHeight(fst::Context& ctx) {
 }
 
 void keepCompletionSelectionVisible(CompletionUiState& state, float itemHeight, float viewHeight) {
-    if (state.items.empty()) {
+    if (state.matches.empty()) {
         state.scrollOffset = 0.0f;
         return;
     }
 
-    const float totalHeight = itemHeight * static_cast<float>(state.items.size());
+    const float totalHeight = itemHeight * static_cast<float>(state.matches.size());
     const float maxScroll = std::max(0.0f, totalHeight - viewHeight);
     state.scrollOffset = std::clamp(state.scrollOffset, 0.0f, maxScroll);
 
@@ -41,6 +45,72 @@ void keepCompletionSelectionVisible(CompletionUiState& state, float itemHeight,
     state.scrollOffset = std::clamp(state.scrollOffset, 0.0f, maxScroll);
 }
 
+bool sameColor(const fst::Color& lhs, const fst::Color& rhs) {
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b && lhs.a == rhs.a;
+}
+
+// Drops the built rows when the list was replaced or the font or theme changed.
+void syncCompletionRows(CompletionUiState& state, const fst::Font* font, const fst::Theme& theme) {
+    const bool sameStyle = state.rowFont == font &&
+                           sameColor(state.rowTextColor, theme.colors.text) &&
+                           sameColor(state.rowMatchColor, theme.colors.primary) &&
+                           sameColor(state.rowBackground, theme.colors.windowBackground);
+    if (sameStyle && state.rows.size() == state.matches.size()) {
+        return;
+    }
+    state.rows.assign(state.matches.size(), CompletionRowLayout());
+    state.rowFont = font;
+    state.rowTextColor = theme.colors.text;
+    state.rowMatchColor = theme.colors.primary;
+    state.rowBackground = theme.colors.windowBackground;
+}
+
+void buildCompletionRow(
+    CompletionRowLayout& row,
+    const LSPCompletionItem& item,
+    const FuzzyMatcher& matcher,
+    fst::Font& font,
+    const fst::Theme& theme) {
+    const std::string rowText = item.detail.empty() ? item.label : (item.label + " :: " + item.detail);
+    // The filter is highlighted in the identifier the label starts with.
+    const size_t nameStart = SkipNonIdentifierBytes(item.label, 0);
+    const size_t nameEnd = SkipIdentifierBytes(item.label, nameStart);
+    const uint64_t matched = matcher.MatchedBytes(std::string_view(item.label).substr(nameStart, nameEnd - nameStart));
+    const auto isMatched = [&](size_t pos) {
+        return pos >= nameStart && pos - nameStart < 64 && ((matched >> (pos - nameStart)) & 1) != 0;
+    };
+
+    float x = 0.0f;
+    const auto addRuns = [&](size_t start, size_t end, const fst::Color& color) {
+        while (start < end) {
+            const bool hit = isMatched(start);
+            size_t split = start + 1;
+            while (split < end && isMatched(split) == hit) {
+                ++split;
+            }
+            CompletionRowLayout::Run run;
+            run.text = rowText.substr(start, split - start);
+            run.x = x;
+            run.color = hit ? theme.colors.primary : color;
+            x += font.measureText(run.text).x;
+            row.runs.push_back(std::move(run));
+            start = split;
+        }
+    };
+
+    int cursor = 0;
+    const int rowTextLen = static_cast<int>(rowText.size());
+    for (const fst::TextSegment& seg : colorizeCppSnippet(rowText, theme)) {
+        const int start = std::clamp(seg.startColumn, cursor, rowTextLen);
+        const int end = std::clamp(seg.endColumn, start, rowTextLen);
+        addRuns(static_cast<size_t>(cursor), static_cast<size_t>(start), theme.colors.text);
+        addRuns(static_cast<size_t>(start), static_cast<size_t>(end), seg.color);
+        cursor = end;
+    }
+    addRuns(static_cast<size_t>(cursor), rowText.size(), theme.colors.text);
+    row.built = true;
+}
+
 bool shouldRepeatCompletionNav(fst::Context& ctx, fst::InputState& input, CompletionUiState& state, fst::Key key) {
     if (input.isKeyPressed(key)) {
         state.repeatKey = key;
@@ -82,28 +152,70 @@ void ShowCompletionPopup(
     CompletionUiState& state,
     int activeTab,
     std::vector<LSPCompletionItem> items,
+    std::string filter,
+    size_t wordStart,
     bool loading,
     std::string ownerPath) {
     state.visible = true;
     state.loading = loading;
-    state.items = std::move(items);
-    ResetCompletionInteractionState(state);
+    SetCompletionItems(state, std::move(items));
+    state.sessionWord = filter;
+    state.sessionWordStart = wordStart;
+    state.serverItems = false;
+    state.incomplete = false;
+    FilterCompletionItems(state, std::move(filter));
     state.ownerTab = activeTab;
     state.ownerDocumentPath = std::move(ownerPath);
 }
 
+bool CompletionSessionCovers(const CompletionUiState& state, size_t wordStart, std::string_view word) {
+    if (!state.visible || wordStart != state.sessionWordStart || (state.serverItems && state.incomplete)) {
+        return false;
+    }
+    return word.size() >= state.sessionWord.size() && word.compare(0, state.sessionWord.size(), state.sessionWord) == 0;
+}
+
+std::string_view CompletionFilterText(const LSPCompletionItem& item) {
+    const std::string_view text = item.insertText.empty() ? item.label : item.insertText;
+    const size_t start = SkipNonIdentifierBytes(text, 0);
+    return text.substr(start, SkipIdentifierBytes(text, start) - start);
+}
+
+void SetCompletionItems(CompletionUiState& state, std::vector<LSPCompletionItem> items) {
+    state.allItems = std::move(items);
+    state.matches.clear();
+    state.filterTexts.clear();
+    state.filterPresent.clear();
+    state.filterTexts.reserve(state.allItems.size());
+    state.filterPresent.reserve(state.allItems.size());
+    for (const LSPCompletionItem& item : state.allItems) {
+        state.filterTexts.push_back(CompletionFilterText(item));
+        state.filterPresent.push_back(FuzzyMatcher::PresentBytes(state.filterTexts.back()));
+    }
+}
+
+void FilterCompletionItems(CompletionUiState& state, std::string filter) {
+    // Only the rows anyone scrolls to are ranked, as indices: a keystroke costs the
+    // filter pass plus scoring the matches, not sorting and copying every item.
+    state.matches.clear();
+    FuzzyMatcher(filter).Rank(state.filterTexts, state.filterPresent, kMaxCompletionRows, state.matches);
+    state.rows.assign(state.matches.size(), CompletionRowLayout());
+    state.filter = std::move(filter);
+    ResetCompletionInteractionState(state);
+}
+
 void HandleCompletionKeyboardNavigation(
     fst::Context& ctx,
     fst::InputState& input,
     CompletionUiState& state,
     const std::function<void(const LSPCompletionItem&)>& applyCompletionItem) {
-    if (state.visible && !state.loading && !state.items.empty()) {
-        state.selected = std::clamp(state.selected, 0, static_cast<int>(state.items.size()) - 1);
+    if (state.visible && !state.loading && !state.matches.empty()) {
+        state.selected = std::clamp(state.selected, 0, static_cast<int>(state.matches.size()) - 1);
         const float itemHeight = completionItemHeight(ctx);
         bool selectionMovedByKeyboard = false;
 
         if (shouldRepeatCompletionNav(ctx, input, state, fst::Key::Down)) {
-            state.selected = std::min(state.selected + 1, static_cast<int>(state.items.size()) - 1);
+            state.selected = std::min(state.selected + 1, static_cast<int>(state.matches.size()) - 1);
             selectionMovedByKeyboard = true;
         }
         if (shouldRepeatCompletionNav(ctx, input, state, fst::Key::Up)) {
@@ -114,7 +226,7 @@ void HandleCompletionKeyboardNavigation(
             keepCompletionSelectionVisible(state, itemHeight, kCompletionListHeight);
         }
         if (input.isKeyPressed(fst::Key::Enter) || input.isKeyPressed(fst::Key::KPEnter)) {
-            applyCompletionItem(state.items[state.selected]);
+            applyCompletionItem(state.allItems[state.matches[state.selected]]);
         }
     } else if (!state.visible) {
         state.repeatKey = fst::Key::Unknown;
@@ -149,10 +261,10 @@ CompletionWindowRenderResult RenderCompletionPopup(
 
     if (state.loading) {
         fst::Label(ctx, fst::i18n("completion.fetching"));
-    } else if (state.items.empty()) {
+    } else if (state.matches.empty()) {
         fst::Label(ctx, fst::i18n("completion.none"));
     } else {
-        state.selected = std::clamp(state.selected, 0, static_cast<int>(state.items.size()) - 1);
+        state.selected = std::clamp(state.selected, 0, static_cast<int>(state.matches.size()) - 1);
         const fst::Theme& theme = ctx.theme();
         fst::Font* font = ctx.font();
         fst::DrawList& dl = ctx.drawList();
@@ -161,7 +273,7 @@ CompletionWindowRenderResult RenderCompletionPopup(
         const float listWidth = std::max(260.0f, bounds.width() - 20.0f);
         const fst::Rect listRect = fst::Allocate(ctx, listWidth, kCompletionListHeight);
 
-        const float totalHeight = itemHeight * static_cast<float>(state.items.size());
+        const float totalHeight = itemHeight * static_cast<float>(state.matches.size());
         const bool needsScrollbar = totalHeight > listRect.height();
         const float scrollbarWidth = needsScrollbar ? std::max(10.0f, theme.metrics.scrollbarWidth) : 0.0f;
         fst::Rect contentRect(listRect.x(), listRect.y(), listRect.width() - scrollbarWidth, listRect.height());
@@ -177,65 +289,45 @@ CompletionWindowRenderResult RenderCompletionPopup(
         const fst::Color listFillColor = theme.colors.inputBackground.darker(0.06f);
         dl.addRectFilled(listRect, listFillColor, listRadius);
 
+        // Only the rows in view are visited, so a frame costs the same for ten items
+        // or ten thousand; each is laid out once, when it first scrolls into view.
         int hoveredIndex = -1;
-        dl.pushClipRect(contentRect);
-        for (int i = 0; i < static_cast<int>(state.items.size()); ++i) {
-            const float rowY = contentRect.y() + i * itemHeight - state.scrollOffset;
-            if (rowY + itemHeight < contentRect.y() || rowY > contentRect.bottom()) {
-                continue;
-            }
+        if (contentRect.contains(input.mousePos()) && !ctx.isOccluded(input.mousePos())) {
+            const float hoverY = input.mousePos().y - contentRect.y() + state.scrollOffset;
+            const size_t row = static_cast<size_t>(hoverY / itemHeight);
+            hoveredIndex = row < state.matches.size() ? static_cast<int>(row) : -1;
+        }
+        const size_t firstRow = static_cast<size_t>(state.scrollOffset / itemHeight);
+        const size_t endRow = std::min(
+            state.matches.size(), static_cast<size_t>((state.scrollOffset + contentRect.height()) / itemHeight) + 1);
+        if (font) {
+            syncCompletionRows(state, font, theme);
+        }
+        const FuzzyMatcher matcher(state.filter);
 
+        dl.pushClipRect(contentRect);
+        for (size_t i = firstRow; i < endRow; ++i) {
+            const float rowY = contentRect.y() + static_cast<float>(i) * itemHeight - state.scrollOffset;
             const fst::Rect rowRect(contentRect.x(), rowY, contentRect.width(), itemHeight);
-            const bool selected = (i == state.selected);
-            const bool hovered = rowRect.contains(input.mousePos()) &&
-                                 contentRect.contains(input.mousePos()) &&
-                                 !ctx.isOccluded(input.mousePos());
-            if (hovered) {
-                hoveredIndex = i;
-            }
-
+            const bool selected = (static_cast<int>(i) == state.selected);
             if (selected) {
                 dl.addRectFilled(rowRect, theme.colors.selection);
-            } else if (hovered) {
+            } else if (static_cast<int>(i) == hoveredIndex) {
                 dl.addRectFilled(rowRect, theme.colors.selection.withAlpha(static_cast<uint8_t>(90)));
             }
+            if (!font) {
+                continue;
+            }
 
-            if (font) {
-                const LSPCompletionItem& item = state.items[i];
-                const float textY = rowRect.y() + (itemHeight - font->lineHeight()) * 0.5f;
-                float textX = rowRect.x() + theme.metrics.paddingSmall;
-                const std::string rowText = item.detail.empty() ? item.label : (item.label + " :: " + item.detail);
-                const std::vector<fst::TextSegment> syntax = colorizeCppSnippet(rowText, theme);
-
-                auto toRowColor = [&](const fst::Color& base) -> fst::Color {
-                    if (selected) {
-                        return fst::Color::lerp(base, theme.colors.selectionText, 0.55f);
-                    }
-                    return base;
-                };
-
-                int cursor = 0;
-                const int rowTextLen = static_cast<int>(rowText.size());
-                for (const auto& seg : syntax) {
-                    const int start = std::clamp(seg.startColumn, 0, rowTextLen);
-                    const int end = std::clamp(seg.endColumn, start, rowTextLen);
-                    if (start > cursor) {
-                        const std::string plain = rowText.substr(static_cast<size_t>(cursor), static_cast<size_t>(start - cursor));
-                        dl.addText(font, fst::Vec2(textX, textY), plain, toRowColor(theme.colors.text));
-                        textX += font->measureText(plain).x;
-                    }
-                    if (end > start) {
-                        const std::string token = rowText.substr(static_cast<size_t>(start), static_cast<size_t>(end - start));
-                        dl.addText(font, fst::Vec2(textX, textY), token, toRowColor(seg.color));
-                        textX += font->measureText(token).x;
-                    }
-                    cursor = end;
-                }
-
-                if (cursor < static_cast<int>(rowText.size())) {
-                    const std::string plain = rowText.substr(static_cast<size_t>(cursor));
-                    dl.addText(font, fst::Vec2(textX, textY), plain, toRowColor(theme.colors.text));
-                }
+            CompletionRowLayout& row = state.rows[i];
+            if (!row.built) {
+                buildCompletionRow(row, state.allItems[state.matches[i]], matcher, *font, theme);
+            }
+            const float textY = rowRect.y() + (itemHeight - font->lineHeight()) * 0.5f;
+            const float textX = rowRect.x() + theme.metrics.paddingSmall;
+            for (const CompletionRowLayout::Run& run : row.runs) {
+                const fst::Color color = selected ? fst::Color::lerp(run.color, theme.colors.selectionText, 0.55f) : run.color;
+                dl.addText(font, fst::Vec2(textX + run.x, textY), run.text, color);
             }
         }
         dl.popClipRect();
@@ -298,16 +390,20 @@ CompletionWindowRenderResult RenderCompletionPopup(
 
         if (hoveredIndex >= 0 && input.isMousePressedRaw(fst::MouseButton::Left)) {
             state.selected = hoveredIndex;
-            applyCompletionItem(state.items[state.selected]);
+            applyCompletionItem(state.allItems[state.matches[state.selected]]);
         }
 
-        if (state.selected >= 0 && state.selected < static_cast<int>(state.items.size())) {
-            const LSPCompletionItem& selectedItem = state.items[state.selected];
-            const bool localItem = selectedItem.detail == "local";
+        if (state.selected >= 0 && state.selected < static_cast<int>(state.matches.size())) {
+            const LSPCompletionItem& selectedItem = state.allItems[state.matches[state.selected]];
+            const bool workspaceItem = selectedItem.detail == "workspace";
+            const bool localItem = workspaceItem || selectedItem.detail == "local";
 
             fst::LabelOptions sourceOptions;
             sourceOptions.color = localItem ? ctx.theme().colors.textSecondary : ctx.theme().colors.primary;
-            fst::Label(ctx, localItem ? fst::i18n("completion.source.local") : fst::i18n("completion.source.lsp"), sourceOptions);
+            const char* sourceKey = workspaceItem ? "completion.source.workspace"
+                                    : localItem   ? "completion.source.local"
+                                                  : "completion.source.lsp";
+            fst::Label(ctx, fst::i18n(sourceKey), sourceOptions);
             if (!selectedItem.detail.empty() && !localItem) {
                 fst::LabelSecondary(ctx, fst::i18n("completion.details", {selectedItem.detail}));
             }
@@ -7,12 +7,32 @@
 #include "Core/LSPClient.h"
 #include "fastener/fastener.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace fin {
 
+// One popup row as drawn: the syntax-coloured runs of "label :: detail" at their
+// measured offsets, split where the filter's matched bytes start and end. Built the
+// first time the row scrolls into view and kept until the list or style changes.
+struct CompletionRowLayout {
+    struct Run {
+        std::string text;
+        float x = 0.0f;
+        fst::Color color;
+    };
+    bool built = false;
+    std::vector<Run> runs;
+};
+
+// Rows the popup ranks and shows at most; nobody scrolls further than this, and the
+// rest only cost ranking time on every keystroke.
+constexpr size_t kMaxCompletionRows = 256;
+
 struct CompletionUiState {
     bool visible = false;
     bool loading = false;
@@ -22,7 +42,24 @@ struct CompletionUiState {
     float scrollbarDragOffset = 0.0f;
     fst::Key repeatKey = fst::Key::Unknown;
     float repeatTimer = 0.0f;
-    std::vector<LSPCompletionItem> items;
+    std::vector<uint32_t> matches; // indices into allItems matching `filter`, best first
+    std::vector<LSPCompletionItem> allItems;
+    // Per item of allItems, set with it by SetCompletionItems: what it is matched by
+    // and its FuzzyMatcher::PresentBytes.
+    std::vector<std::string_view> filterTexts;
+    std::vector<uint64_t> filterPresent;
+    std::string filter; // word typed before the cursor
+    std::vector<CompletionRowLayout> rows; // parallel to matches
+    const fst::Font* rowFont = nullptr;    // what the built rows were measured and coloured with
+    fst::Color rowTextColor;
+    fst::Color rowMatchColor;
+    fst::Color rowBackground;
+    // The session: allItems were computed for `sessionWord`, typed from document
+    // offset `sessionWordStart`, and are only re-filtered while typing extends it.
+    std::string sessionWord;
+    size_t sessionWordStart = 0;
+    bool serverItems = false; // allItems came from clangd
+    bool incomplete = false;  // and clangd may add items as more is typed
     int ownerTab = -1;
     std::string ownerDocumentPath;
 };
@@ -34,12 +71,28 @@ struct CompletionWindowRenderResult {
 
 void ResetCompletionNavigationState(CompletionUiState& state);
 void ResetCompletionInteractionState(CompletionUiState& state);
+// Starts a session with local `items` for the word `filter` beginning at `wordStart`.
 void ShowCompletionPopup(
     CompletionUiState& state,
     int activeTab,
     std::vector<LSPCompletionItem> items,
+    std::string filter,
+    size_t wordStart,
     bool loading,
     std::string ownerPath);
+// Whether the open session's list still holds every item for `word` (starting at
+// `wordStart`), so filtering replaces a new request: same word start, `word` extends
+// the session word and the server did not mark the list incomplete.
+bool CompletionSessionCovers(const CompletionUiState& state, size_t wordStart, std::string_view word);
+
+// The identifier an item's insert text (or label) starts with; what it is matched by.
+std::string_view CompletionFilterText(const LSPCompletionItem& item);
+// Replaces allItems and precomputes what filtering reads of each item; call
+// FilterCompletionItems afterwards.
+void SetCompletionItems(CompletionUiState& state, std::vector<LSPCompletionItem> items);
+// Fuzzy-ranks allItems against `filter` into matches (the best kMaxCompletionRows),
+// client-side, so typing narrows the list without another server round trip.
+void FilterCompletionItems(CompletionUiState& state, std::string filter);
 
 void HandleCompletionKeyboardNavigation(
     fst::Context& ctx,
@@ -52,6 +52,8 @@ std::string DockWindowTitle(DockWindowId id) {
             return fst::i18n("window.settings");
         case DockWindowId::Personalization:
             return fst::i18n("window.personalization");
+        case DockWindowId::SearchResults:
+            return fst::i18n("window.search_results");
     }
     return std::string();
 }
@@ -66,6 +68,7 @@ ManagedDockWindows CreateManagedDockWindows(
     bool& showConsoleTab,
     bool& showLspDiagnosticsTab,
     bool& showTerminalTab,
+    bool& showSearchResultsTab,
     bool& showSettingsWindow,
     bool& showPersonalizationTab) {
     return {{
@@ -74,6 +77,7 @@ ManagedDockWindows CreateManagedDockWindows(
         {DockWindowId::Console, &showConsoleTab, DockWindowId::Editor, fst::DockDirection::Bottom},
         {DockWindowId::LspDiagnostics, &showLspDiagnosticsTab, DockWindowId::Editor, fst::DockDirection::Bottom},
         {DockWindowId::Terminal, &showTerminalTab, DockWindowId::Editor, fst::DockDirection::Bottom},
+        {DockWindowId::SearchResults, &showSearchResultsTab, DockWindowId::Editor, fst::DockDirection::Bottom},
         {DockWindowId::Settings, &showSettingsWindow, DockWindowId::Editor, fst::DockDirection::Center},
         {DockWindowId::Personalization, &showPersonalizationTab, DockWindowId::Settings, fst::DockDirection::Center},
     }};
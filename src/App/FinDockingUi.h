@@ -20,6 +20,7 @@ enum class DockWindowId {
     Terminal = 4,
     Settings = 5,
     Personalization = 6,
+    SearchResults = 7,
 };
 
 struct ManagedDockWindow {
@@ -29,7 +30,7 @@ struct ManagedDockWindow {
     fst::DockDirection fallbackDirection;
 };
 
-using ManagedDockWindows = std::array<ManagedDockWindow, 7>;
+using ManagedDockWindows = std::array<ManagedDockWindow, 8>;
 
 std::string DockWindowTitle(DockWindowId id);
 int DockWindowKey(DockWindowId id);
@@ -40,6 +41,7 @@ ManagedDockWindows CreateManagedDockWindows(
     bool& showConsoleTab,
     bool& showLspDiagnosticsTab,
     bool& showTerminalTab,
+    bool& showSearchResultsTab,
     bool& showSettingsWindow,
     bool& showPersonalizationTab);
 
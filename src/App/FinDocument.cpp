@@ -0,0 +1,143 @@
+#include "App/FinDocument.h"
+
+#include "App/FinHelpers.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+namespace fin {
+
+namespace {
+
+// Must be called before `change` is applied: the range refers to the old text.
+LSPContentChange MakeContentChange(const TextDocument& document, const TextChange& change) {
+    const size_t endOffset = change.offset + change.removedText.size();
+    LSPContentChange out;
+    out.startLine = static_cast<int>(document.LineFromOffset(change.offset));
+    out.startCharacter = static_cast<int>(document.Utf16ColumnFromOffset(change.offset));
+    out.endLine = static_cast<int>(document.LineFromOffset(endOffset));
+    out.endCharacter = static_cast<int>(document.Utf16ColumnFromOffset(endOffset));
+    out.text = change.insertedText;
+    return out;
+}
+
+// Every document edit goes through here so the per-line caches can shift their lines.
+void ApplyChange(DocumentTab& tab, const TextChange& change) {
+    const auto countLines = [](const std::string& text) {
+        return static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+    };
+    const size_t firstLine = tab.document.LineFromOffset(change.offset);
+    const size_t removedLines = countLines(change.removedText);
+    const size_t insertedLines = countLines(change.insertedText);
+    tab.highlight.OnEdit(firstLine, removedLines, insertedLines);
+    tab.minimap.OnEdit(firstLine, removedLines, insertedLines);
+    tab.find.OnEdit(change.offset, change.removedText.size(), change.insertedText.size());
+    tab.identifiers.BeginEdit(tab.document, change.offset, change.removedText.size());
+    tab.document.Apply(change);
+    tab.identifiers.EndEdit(tab.document, change.offset, change.insertedText.size());
+}
+
+// Whether this frame's input can have changed the editor text: typing, the editing
+// keys (held ones repeat) and the clipboard and undo shortcuts. Other frames skip the
+// full-text snapshot and diff; anything they changed is still caught by the next one.
+bool EditorInputMayEdit(fst::InputState& input) {
+    if (!input.textInput().empty()) {
+        return true;
+    }
+    for (const fst::Key key : {fst::Key::Backspace, fst::Key::Delete, fst::Key::Enter, fst::Key::KPEnter, fst::Key::Tab}) {
+        if (input.isKeyDown(key)) {
+            return true;
+        }
+    }
+    if (input.modifiers().ctrl) {
+        for (const fst::Key key : {fst::Key::V, fst::Key::X, fst::Key::Z, fst::Key::Y}) {
+            if (input.isKeyDown(key)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::string EditorWidgetKey(const fst::TextEditor& editor) {
+    return "text_editor_" + std::to_string(reinterpret_cast<std::uintptr_t>(&editor));
+}
+
+void ResetDocumentText(DocumentTab& tab, std::string text) {
+    tab.editor.setText(text);
+    tab.document.SetText(std::move(text));
+    tab.highlight.Reset();
+    tab.minimap.Reset();
+    tab.find.Reset();
+    tab.identifiers.Reset();
+    tab.pendingChanges.clear();
+    tab.editorChange.reset();
+}
+
+void MarkDocumentSaved(DocumentTab& tab) {
+    tab.savedVersion = tab.document.Version();
+    tab.savedSize = tab.document.Size();
+    tab.savedHash = tab.document.ContentHash();
+    tab.dirtyCheckedVersion = tab.savedVersion;
+    tab.dirty = false;
+}
+
+void UpdateDirtyState(DocumentTab& tab) {
+    const TextDocument& document = tab.document;
+    if (document.Version() == tab.dirtyCheckedVersion) {
+        return;
+    }
+    tab.dirtyCheckedVersion = document.Version();
+    tab.dirty = document.Version() != tab.savedVersion &&
+                (document.Size() != tab.savedSize || document.ContentHash() != tab.savedHash);
+}
+
+bool SyncDocumentFromEditor(fst::Context& ctx, DocumentTab& tab, bool force) {
+    tab.editorChange.reset();
+    if (!force && (!fst::getWidgetState(ctx, ctx.makeId(EditorWidgetKey(tab.editor))).focused ||
+                   !EditorInputMayEdit(ctx.input()))) {
+        return false;
+    }
+
+    const std::string text = tab.editor.getText();
+    TextChange change = tab.document.DiffAgainst(text, text.size());
+    if (change.removedText.empty() && change.insertedText.empty()) {
+        return false;
+    }
+
+    // Apply first so the caret can be resolved through the updated line index; if the
+    // diff landed past the caret, undo it and re-attribute the edit to the caret.
+    LSPContentChange contentChange = MakeContentChange(tab.document, change);
+    ApplyChange(tab, change);
+    const size_t caretOffset = offsetFromPosition(tab.document, tab.editor.cursor());
+    if (change.offset > caretOffset) {
+        ApplyChange(tab, TextChange{change.offset, change.insertedText, change.removedText});
+        change = tab.document.DiffAgainst(text, caretOffset);
+        contentChange = MakeContentChange(tab.document, change);
+        ApplyChange(tab, change);
+    }
+
+    tab.pendingChanges.push_back(std::move(contentChange));
+    tab.editorChange = std::move(change);
+    return true;
+}
+
+void EditDocument(DocumentTab& tab, size_t offset, size_t length, std::string_view text) {
+    TextChange change;
+    change.offset = offset;
+    change.removedText = tab.document.Substr(offset, length);
+    change.insertedText.assign(text.data(), text.size());
+    tab.pendingChanges.push_back(MakeContentChange(tab.document, change));
+    ApplyChange(tab, change);
+}
+
+void PushDocumentToEditor(DocumentTab& tab, const fst::TextPosition& cursor) {
+    tab.editor.setText(tab.document.Text());
+    tab.editor.setCursor(cursor);
+}
+
+} // namespace fin
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "App/FinTypes.h"
+#include "fastener/fastener.h"
+
+#include <string>
+#include <string_view>
+
+namespace fin {
+
+std::string EditorWidgetKey(const fst::TextEditor& editor);
+
+// Replaces the whole document (new tab, reload) without recording a change.
+void ResetDocumentText(DocumentTab& tab, std::string text);
+
+// Folds edits made inside fst::TextEditor into tab.document as one TextChange.
+// fst::TextEditor only exposes whole-buffer access, so the snapshot is taken only
+// while the editor is focused and on frames with editing input (or when `force` is
+// set, e.g. before saving); idle frames cost nothing.
+bool SyncDocumentFromEditor(fst::Context& ctx, DocumentTab& tab, bool force = false);
+
+// Records the current document as what is on disk.
+void MarkDocumentSaved(DocumentTab& tab);
+
+// Recomputes tab.dirty once per document version; hashes only when the size matches
+// the saved one (e.g. an undo back to the saved text).
+void UpdateDirtyState(DocumentTab& tab);
+
+// Edits tab.document and queues the change for dirty tracking / LSP.
+void EditDocument(DocumentTab& tab, size_t offset, size_t length, std::string_view text);
+
+// Mirrors the document back into the editor after EditDocument calls.
+void PushDocumentToEditor(DocumentTab& tab, const fst::TextPosition& cursor);
+
+} // namespace fin
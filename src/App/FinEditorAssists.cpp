@@ -1,9 +1,11 @@
 #include "App/FinEditorAssists.h"
 
+#include "App/FinDocument.h"
 #include "App/FinHelpers.h"
 
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace fin {
@@ -38,10 +40,6 @@ void ApplyEditorAssists(
     fst::InputState& input,
     std::vector<std::unique_ptr<DocumentTab>>& docs,
     int& activeTab,
-    bool assistHasPreState,
-    int assistPreTab,
-    const std::string& assistPreText,
-    const fst::TextPosition& assistPreCursor,
     bool completionVisible,
     const std::function<void()>& clampActiveTab,
     const std::function<void()>& closeCompletionPopup) {
@@ -57,40 +55,29 @@ void ApplyEditorAssists(
     }
 
     DocumentTab& tab = *docs[activeTab];
-    std::string text = tab.editor.getText();
-    size_t cursorOffset = offsetFromPosition(text, tab.editor.cursor());
-    if (cursorOffset > text.size()) {
-        cursorOffset = text.size();
+    if (!tab.editorChange) {
+        return;
+    }
+
+    const TextDocument& document = tab.document;
+    size_t cursorOffset = offsetFromPosition(document, tab.editor.cursor());
+    if (cursorOffset > document.Size()) {
+        cursorOffset = document.Size();
     }
 
     bool changed = false;
     const std::string& typed = input.textInput();
 
-    if (config.autoClosingBrackets &&
-        input.isKeyPressed(fst::Key::Backspace) &&
-        assistHasPreState &&
-        assistPreTab == activeTab) {
-        size_t oldCursorOffset = offsetFromPosition(assistPreText, assistPreCursor);
-        if (oldCursorOffset > assistPreText.size()) {
-            oldCursorOffset = assistPreText.size();
-        }
-
-        if (oldCursorOffset > 0 &&
-            oldCursorOffset < assistPreText.size() &&
-            text.size() + 1 == assistPreText.size() &&
-            cursorOffset + 1 == oldCursorOffset) {
-            const char oldLeft = assistPreText[oldCursorOffset - 1];
-            const char oldRight = assistPreText[oldCursorOffset];
-            const char expectedRight = matchingClosing(oldLeft);
-            if (expectedRight != '\0' && expectedRight == oldRight) {
-                std::string expectedText = assistPreText;
-                expectedText.erase(oldCursorOffset - 1, 1);
-                if (expectedText == text &&
-                    cursorOffset < text.size() &&
-                    text[cursorOffset] == oldRight) {
-                    text.erase(cursorOffset, 1);
-                    changed = true;
-                }
+    if (config.autoClosingBrackets && input.isKeyPressed(fst::Key::Backspace)) {
+        const TextChange& erased = *tab.editorChange;
+        if (erased.insertedText.empty() &&
+            erased.removedText.size() == 1 &&
+            erased.offset == cursorOffset &&
+            cursorOffset < document.Size()) {
+            const char expectedRight = matchingClosing(erased.removedText[0]);
+            if (expectedRight != '\0' && document.CharAt(cursorOffset) == expectedRight) {
+                EditDocument(tab, cursorOffset, 1, std::string_view());
+                changed = true;
             }
         }
     }
@@ -99,19 +86,19 @@ void ApplyEditorAssists(
         const char typedChar = typed[0];
 
         if (isClosingChar(typedChar) &&
-            cursorOffset < text.size() &&
-            text[cursorOffset - 1] == typedChar &&
-            text[cursorOffset] == typedChar) {
-            text.erase(cursorOffset - 1, 1);
+            cursorOffset < document.Size() &&
+            document.CharAt(cursorOffset - 1) == typedChar &&
+            document.CharAt(cursorOffset) == typedChar) {
+            EditDocument(tab, cursorOffset - 1, 1, std::string_view());
             changed = true;
         } else {
             const char closing = matchingClosing(typedChar);
-            if (closing != '\0' && text[cursorOffset - 1] == typedChar) {
-                const char next = (cursorOffset < text.size()) ? text[cursorOffset] : '\0';
+            if (closing != '\0' && document.CharAt(cursorOffset - 1) == typedChar) {
+                const char next = document.CharAt(cursorOffset);
                 bool shouldInsertClosing = true;
 
                 if (typedChar == '"' || typedChar == '\'') {
-                    const char prev = (cursorOffset >= 2) ? text[cursorOffset - 2] : '\0';
+                    const char prev = (cursorOffset >= 2) ? document.CharAt(cursorOffset - 2) : '\0';
                     const unsigned char nextUch = static_cast<unsigned char>(next);
                     if (prev == '\\' || next == typedChar || std::isalnum(nextUch) || next == '_') {
                         shouldInsertClosing = false;
@@ -124,7 +111,7 @@ void ApplyEditorAssists(
                 }
 
                 if (shouldInsertClosing) {
-                    text.insert(cursorOffset, 1, closing);
+                    EditDocument(tab, cursorOffset, 0, std::string_view(&closing, 1));
                     changed = true;
                 }
             }
@@ -132,26 +119,26 @@ void ApplyEditorAssists(
     }
 
     if (config.smartIndentEnabled && input.isKeyPressed(fst::Key::Enter)) {
-        if (cursorOffset >= 2 && cursorOffset <= text.size() &&
-            text[cursorOffset - 1] == '\n' &&
-            text[cursorOffset - 2] == '{' &&
-            cursorOffset < text.size() &&
-            text[cursorOffset] == '}') {
+        if (cursorOffset >= 2 && cursorOffset < document.Size() &&
+            document.CharAt(cursorOffset - 1) == '\n' &&
+            document.CharAt(cursorOffset - 2) == '{' &&
+            document.CharAt(cursorOffset) == '}') {
             size_t lineStart = cursorOffset;
-            while (lineStart > 0 && text[lineStart - 1] != '\n') {
+            while (lineStart > 0 && document.CharAt(lineStart - 1) != '\n') {
                 --lineStart;
             }
 
             size_t indentEnd = lineStart;
-            while (indentEnd < text.size() && (text[indentEnd] == ' ' || text[indentEnd] == '\t')) {
+            while (indentEnd < document.Size() &&
+                   (document.CharAt(indentEnd) == ' ' || document.CharAt(indentEnd) == '\t')) {
                 ++indentEnd;
             }
 
-            const std::string baseIndent = text.substr(lineStart, indentEnd - lineStart);
+            const std::string baseIndent = document.Substr(lineStart, indentEnd - lineStart);
             const std::string indentUnit = (baseIndent.find('\t') != std::string::npos) ? "\t" : "    ";
             const std::string insertion = baseIndent + indentUnit + "\n";
 
-            text.insert(cursorOffset, insertion);
+            EditDocument(tab, cursorOffset, 0, insertion);
             cursorOffset += baseIndent.size() + indentUnit.size();
             changed = true;
         }
@@ -161,9 +148,7 @@ void ApplyEditorAssists(
         return;
     }
 
-    tab.editor.setText(text);
-    tab.editor.setCursor(positionFromOffset(text, cursorOffset));
-    tab.dirty = (text != tab.savedText);
+    PushDocumentToEditor(tab, positionFromOffset(document, cursorOffset));
     if (completionVisible) {
         closeCompletionPopup();
     }
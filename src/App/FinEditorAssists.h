@@ -20,10 +20,6 @@ void ApplyEditorAssists(
     fst::InputState& input,
     std::vector<std::unique_ptr<DocumentTab>>& docs,
     int& activeTab,
-    bool assistHasPreState,
-    int assistPreTab,
-    const std::string& assistPreText,
-    const fst::TextPosition& assistPreCursor,
     bool completionVisible,
     const std::function<void()>& clampActiveTab,
     const std::function<void()>& closeCompletionPopup);
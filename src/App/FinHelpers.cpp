@@ -12,17 +12,6 @@ namespace fin {
 
 namespace {
 
-struct CppSyntaxPalette {
-    fst::Color keyword;
-    fst::Color type;
-    fst::Color number;
-    fst::Color stringLiteral;
-    fst::Color comment;
-    fst::Color preprocessor;
-    fst::Color function;
-    fst::Color punctuation;
-};
-
 struct ScrollablePanelState {
     float scrollOffsetY = 0.0f;
     float contentHeight = 0.0f;
@@ -179,16 +168,6 @@ void endScrollablePanelContent(fst::Context& ctx, std::string_view id, const fst
 
 namespace {
 
-bool isIdentifierStart(char ch) {
-    const unsigned char c = static_cast<unsigned char>(ch);
-    return std::isalpha(c) || ch == '_';
-}
-
-bool isIdentifierChar(char ch) {
-    const unsigned char c = static_cast<unsigned char>(ch);
-    return std::isalnum(c) || ch == '_';
-}
-
 std::string toLowerAscii(std::string value) {
     std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
         return static_cast<char>(std::tolower(c));
@@ -204,221 +183,6 @@ bool isCppLikePathInternal(const std::string& pathOrName) {
     return kExtensions.count(ext) > 0;
 }
 
-float luminance(const fst::Color& color) {
-    return 0.2126f * static_cast<float>(color.r) +
-           0.7152f * static_cast<float>(color.g) +
-           0.0722f * static_cast<float>(color.b);
-}
-
-CppSyntaxPalette buildPalette(const fst::Theme& theme) {
-    const bool darkBackground = luminance(theme.colors.windowBackground) < 128.0f;
-    if (darkBackground) {
-        return {
-            fst::Color::fromHex(0x82aaff), // keyword
-            fst::Color::fromHex(0x4ec9b0), // type
-            fst::Color::fromHex(0xb5cea8), // number
-            fst::Color::fromHex(0xce9178), // string
-            fst::Color::fromHex(0x6a9955), // comment
-            fst::Color::fromHex(0xc586c0), // preprocessor
-            fst::Color::fromHex(0xdcdcaa), // function
-            fst::Color::fromHex(0xd4d4d4)  // punctuation
-        };
-    }
-
-    return {
-        fst::Color::fromHex(0x1d4ed8), // keyword
-        fst::Color::fromHex(0x0f766e), // type
-        fst::Color::fromHex(0x9a3412), // number
-        fst::Color::fromHex(0xb45309), // string
-        fst::Color::fromHex(0x15803d), // comment
-        fst::Color::fromHex(0x7e22ce), // preprocessor
-        fst::Color::fromHex(0x92400e), // function
-        fst::Color::fromHex(0x4b5563)  // punctuation
-    };
-}
-
-std::vector<fst::TextSegment> colorizeCppLine(const std::string& text, const CppSyntaxPalette& palette) {
-    static const std::unordered_set<std::string> kKeywords = {
-        "alignas",     "alignof",      "asm",          "auto",         "break",        "case",
-        "catch",       "class",        "const",        "consteval",    "constexpr",    "constinit",
-        "continue",    "co_await",     "co_return",    "co_yield",     "decltype",     "default",
-        "delete",      "do",           "else",         "enum",         "explicit",     "export",
-        "extern",      "false",        "final",        "for",          "friend",       "goto",
-        "if",          "import",       "inline",       "module",       "mutable",      "namespace",
-        "new",         "noexcept",     "nullptr",      "operator",     "override",     "private",
-        "protected",   "public",       "register",     "requires",     "return",       "sizeof",
-        "static",      "static_assert","struct",       "switch",       "template",     "this",
-        "thread_local","throw",        "true",         "try",          "typedef",      "typename",
-        "union",       "using",        "virtual",      "volatile",     "while"};
-
-    static const std::unordered_set<std::string> kTypeWords = {
-        "bool",     "char",      "char8_t",   "char16_t", "char32_t", "double",     "float",
-        "int",      "long",      "short",     "signed",   "unsigned", "void",       "wchar_t",
-        "size_t",   "ptrdiff_t", "uint8_t",   "uint16_t", "uint32_t", "uint64_t",   "int8_t",
-        "int16_t",  "int32_t",   "int64_t",   "std",      "string"};
-
-    static const std::unordered_set<std::string> kControlWords = {
-        "if", "for", "while", "switch", "catch", "return", "sizeof", "decltype"};
-    static const std::unordered_set<std::string> kTypeIntroducers = {
-        "class", "struct", "typename", "enum", "union", "using"};
-
-    std::vector<fst::TextSegment> segments;
-    const int lineLength = static_cast<int>(text.size());
-    if (lineLength == 0) {
-        return segments;
-    }
-
-    const size_t firstCode = text.find_first_not_of(" \t");
-    if (firstCode != std::string::npos && text[firstCode] == '#') {
-        segments.push_back({static_cast<int>(firstCode), lineLength, palette.preprocessor});
-        return segments;
-    }
-
-    int i = 0;
-    bool expectTypeName = false;
-    while (i < lineLength) {
-        const char ch = text[i];
-
-        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '/') {
-            segments.push_back({i, lineLength, palette.comment});
-            break;
-        }
-
-        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '*') {
-            int end = lineLength;
-            const size_t close = text.find("*/", static_cast<size_t>(i + 2));
-            if (close != std::string::npos) {
-                end = static_cast<int>(close + 2);
-            }
-            segments.push_back({i, end, palette.comment});
-            i = end;
-            continue;
-        }
-
-        if (ch == '"' || ch == '\'') {
-            const char quote = ch;
-            int end = i + 1;
-            while (end < lineLength) {
-                if (text[end] == '\\' && end + 1 < lineLength) {
-                    end += 2;
-                    continue;
-                }
-                if (text[end] == quote) {
-                    ++end;
-                    break;
-                }
-                ++end;
-            }
-            segments.push_back({i, std::min(end, lineLength), palette.stringLiteral});
-            i = end;
-            continue;
-        }
-
-        const unsigned char uch = static_cast<unsigned char>(ch);
-        if (std::isdigit(uch) || (ch == '.' && i + 1 < lineLength && std::isdigit(static_cast<unsigned char>(text[i + 1])))) {
-            int end = i;
-            if (ch == '0' && i + 1 < lineLength && (text[i + 1] == 'x' || text[i + 1] == 'X')) {
-                end += 2;
-                while (end < lineLength && std::isxdigit(static_cast<unsigned char>(text[end]))) {
-                    ++end;
-                }
-            } else {
-                bool seenDot = (ch == '.');
-                while (end < lineLength) {
-                    const char n = text[end];
-                    const unsigned char un = static_cast<unsigned char>(n);
-                    if (std::isdigit(un)) {
-                        ++end;
-                        continue;
-                    }
-                    if (n == '.' && !seenDot) {
-                        seenDot = true;
-                        ++end;
-                        continue;
-                    }
-                    if ((n == 'e' || n == 'E') && end + 1 < lineLength) {
-                        int expPos = end + 1;
-                        if (text[expPos] == '+' || text[expPos] == '-') {
-                            ++expPos;
-                        }
-                        if (expPos < lineLength && std::isdigit(static_cast<unsigned char>(text[expPos]))) {
-                            end = expPos + 1;
-                            while (end < lineLength && std::isdigit(static_cast<unsigned char>(text[end]))) {
-                                ++end;
-                            }
-                            continue;
-                        }
-                    }
-                    break;
-                }
-            }
-            while (end < lineLength && std::isalpha(static_cast<unsigned char>(text[end]))) {
-                ++end;
-            }
-            segments.push_back({i, end, palette.number});
-            i = end;
-            continue;
-        }
-
-        if (isIdentifierStart(ch)) {
-            int end = i + 1;
-            while (end < lineLength && isIdentifierChar(text[end])) {
-                ++end;
-            }
-
-            const std::string word = text.substr(static_cast<size_t>(i), static_cast<size_t>(end - i));
-            if (kTypeWords.count(word) > 0) {
-                segments.push_back({i, end, palette.type});
-                expectTypeName = false;
-            } else if (kKeywords.count(word) > 0) {
-                segments.push_back({i, end, palette.keyword});
-                expectTypeName = kTypeIntroducers.count(word) > 0;
-            } else {
-                if (expectTypeName || std::isupper(static_cast<unsigned char>(word[0])) != 0) {
-                    segments.push_back({i, end, palette.type});
-                    expectTypeName = false;
-                } else {
-                    int probe = end;
-                    while (probe < lineLength && (text[probe] == ' ' || text[probe] == '\t')) {
-                        ++probe;
-                    }
-                    if (probe < lineLength && text[probe] == '(' && kControlWords.count(word) == 0) {
-                        segments.push_back({i, end, palette.function});
-                    } else if (probe < lineLength && text[probe] == '<') {
-                        segments.push_back({i, end, palette.function});
-                    }
-                }
-            }
-            i = end;
-            continue;
-        }
-
-        if (ch == ':' && i + 1 < lineLength && text[i + 1] == ':') {
-            segments.push_back({i, i + 2, palette.punctuation});
-            i += 2;
-            continue;
-        }
-
-        if (ch == '-' && i + 1 < lineLength && text[i + 1] == '>') {
-            segments.push_back({i, i + 2, palette.punctuation});
-            i += 2;
-            continue;
-        }
-
-        if (ch == '<' || ch == '>' || ch == '(' || ch == ')' ||
-            ch == '[' || ch == ']' || ch == '{' || ch == '}' ||
-            ch == ',' || ch == '*' || ch == '&' || ch == '=') {
-            segments.push_back({i, i + 1, palette.punctuation});
-            ++i;
-            continue;
-        }
-
-        ++i;
-    }
-
-    return segments;
-}
-
 } // namespace
 
 void trimBuffer(std::string& text, size_t maxBytes) {
@@ -514,29 +278,15 @@ bool isCppLikePath(const std::string& pathOrName) {
     return isCppLikePathInternal(pathOrName);
 }
 
-void applyCppSyntaxHighlighting(fst::TextEditor& editor, const std::string& pathOrName, const fst::Theme& theme) {
-    if (!isCppLikePath(pathOrName)) {
-        editor.setStyleProvider({});
-        return;
-    }
-
-    const CppSyntaxPalette palette = buildPalette(theme);
-    editor.setStyleProvider([palette](int, const std::string& lineText) {
-        return colorizeCppLine(lineText, palette);
-    });
-}
-
-std::vector<fst::TextSegment> colorizeCppSnippet(const std::string& text, const fst::Theme& theme) {
-    return colorizeCppLine(text, buildPalette(theme));
-}
-
 std::string normalizePath(const std::string& path) {
     if (path.empty()) {
         return path;
     }
 
     std::string normalized = fs::path(path).lexically_normal().string();
+#ifdef _WIN32
     std::replace(normalized.begin(), normalized.end(), '/', '\\');
+#endif
     return normalized;
 }
 
@@ -578,9 +328,7 @@ std::string decodeUriEscapes(const std::string& value) {
 
 std::string uriToPath(const std::string& uri) {
     std::string path = uri;
-    if (path.rfind("file:///", 0) == 0) {
-        path = path.substr(8);
-    } else if (path.rfind("file://", 0) == 0) {
+    if (path.rfind("file://", 0) == 0) {
         path = path.substr(7);
     }
 
@@ -590,9 +338,9 @@ std::string uriToPath(const std::string& uri) {
     if (path.size() > 2 && path[0] == '/' && path[2] == ':') {
         path.erase(path.begin());
     }
+    std::replace(path.begin(), path.end(), '/', '\\');
 #endif
 
-    std::replace(path.begin(), path.end(), '/', '\\');
     return normalizePath(path);
 }
 
@@ -658,6 +406,29 @@ fst::TextPosition positionFromOffset(const std::string& text, size_t offset) {
     return pos;
 }
 
+size_t offsetFromPosition(const TextDocument& document, const fst::TextPosition& pos) {
+    return document.OffsetFromLineColumn(
+        static_cast<size_t>(std::max(0, pos.line)),
+        static_cast<size_t>(std::max(0, pos.column)));
+}
+
+fst::TextPosition positionFromOffset(const TextDocument& document, size_t offset) {
+    offset = std::min(offset, document.Size());
+    const size_t line = document.LineFromOffset(offset);
+    return fst::TextPosition{static_cast<int>(line), static_cast<int>(offset - document.LineStart(line))};
+}
+
+int lspCharacterFromPosition(const TextDocument& document, const fst::TextPosition& pos) {
+    return static_cast<int>(document.Utf16ColumnFromOffset(offsetFromPosition(document, pos)));
+}
+
+fst::TextPosition positionFromLspCharacter(const TextDocument& document, int line, int character) {
+    const size_t offset = document.OffsetFromUtf16Column(
+        static_cast<size_t>(std::max(0, line)),
+        static_cast<size_t>(std::max(0, character)));
+    return positionFromOffset(document, offset);
+}
+
 std::string insertAtPosition(
     const std::string& text,
     const fst::TextPosition& pos,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Core/TextDocument.h"
 #include "fastener/fastener.h"
 
 #include <filesystem>
@@ -19,8 +20,6 @@ void trimBuffer(std::string& text, size_t maxBytes);
 
 void applyTheme(fst::Context& ctx, int themeId);
 bool isCppLikePath(const std::string& pathOrName);
-void applyCppSyntaxHighlighting(fst::TextEditor& editor, const std::string& pathOrName, const fst::Theme& theme);
-std::vector<fst::TextSegment> colorizeCppSnippet(const std::string& text, const fst::Theme& theme);
 
 std::string normalizePath(const std::string& path);
 std::string uriToPath(const std::string& uri);
@@ -32,6 +31,14 @@ void endScrollablePanelContent(fst::Context& ctx, std::string_view id, const fst
 
 size_t offsetFromPosition(const std::string& text, const fst::TextPosition& pos);
 fst::TextPosition positionFromOffset(const std::string& text, size_t offset);
+// Index-backed conversions; prefer these over the text scans above for open documents.
+size_t offsetFromPosition(const TextDocument& document, const fst::TextPosition& pos);
+fst::TextPosition positionFromOffset(const TextDocument& document, size_t offset);
+
+// LSP positions count UTF-16 code units, the editor counts bytes.
+int lspCharacterFromPosition(const TextDocument& document, const fst::TextPosition& pos);
+fst::TextPosition positionFromLspCharacter(const TextDocument& document, int line, int character);
+
 std::string insertAtPosition(
     const std::string& text,
     const fst::TextPosition& pos,
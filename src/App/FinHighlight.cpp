@@ -0,0 +1,255 @@
+#include "App/FinHighlight.h"
+
+#include "App/FinHelpers.h"
+#include "App/FinTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace fin {
+
+namespace {
+
+float luminance(const fst::Color& color) {
+    return 0.2126f * static_cast<float>(color.r) +
+           0.7152f * static_cast<float>(color.g) +
+           0.0722f * static_cast<float>(color.b);
+}
+
+bool sameColor(const fst::Color& lhs, const fst::Color& rhs) {
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b && lhs.a == rhs.a;
+}
+
+bool samePalette(const CppSyntaxPalette& lhs, const CppSyntaxPalette& rhs) {
+    return sameColor(lhs.keyword, rhs.keyword) &&
+           sameColor(lhs.type, rhs.type) &&
+           sameColor(lhs.number, rhs.number) &&
+           sameColor(lhs.stringLiteral, rhs.stringLiteral) &&
+           sameColor(lhs.comment, rhs.comment) &&
+           sameColor(lhs.preprocessor, rhs.preprocessor) &&
+           sameColor(lhs.function, rhs.function) &&
+           sameColor(lhs.punctuation, rhs.punctuation);
+}
+
+} // namespace
+
+CppSyntaxPalette cppSyntaxPalette(const fst::Theme& theme) {
+    const bool darkBackground = luminance(theme.colors.windowBackground) < 128.0f;
+    if (darkBackground) {
+        return {
+            fst::Color::fromHex(0x82aaff), // keyword
+            fst::Color::fromHex(0x4ec9b0), // type
+            fst::Color::fromHex(0xb5cea8), // number
+            fst::Color::fromHex(0xce9178), // string
+            fst::Color::fromHex(0x6a9955), // comment
+            fst::Color::fromHex(0xc586c0), // preprocessor
+            fst::Color::fromHex(0xdcdcaa), // function
+            fst::Color::fromHex(0xd4d4d4)  // punctuation
+        };
+    }
+
+    return {
+        fst::Color::fromHex(0x1d4ed8), // keyword
+        fst::Color::fromHex(0x0f766e), // type
+        fst::Color::fromHex(0x9a3412), // number
+        fst::Color::fromHex(0xb45309), // string
+        fst::Color::fromHex(0x15803d), // comment
+        fst::Color::fromHex(0x7e22ce), // preprocessor
+        fst::Color::fromHex(0x92400e), // function
+        fst::Color::fromHex(0x4b5563)  // punctuation
+    };
+}
+
+const fst::Color& cppTokenColor(const CppSyntaxPalette& palette, CppTokenKind kind) {
+    switch (kind) {
+    case CppTokenKind::Keyword: return palette.keyword;
+    case CppTokenKind::Type: return palette.type;
+    case CppTokenKind::Number: return palette.number;
+    case CppTokenKind::String: return palette.stringLiteral;
+    case CppTokenKind::Comment: return palette.comment;
+    case CppTokenKind::Preprocessor: return palette.preprocessor;
+    case CppTokenKind::Function: return palette.function;
+    case CppTokenKind::Punctuation: break;
+    }
+    return palette.punctuation;
+}
+
+namespace {
+
+void appendSegments(const std::vector<CppToken>& tokens, const CppSyntaxPalette& palette, std::vector<fst::TextSegment>& out) {
+    out.reserve(out.size() + tokens.size());
+    for (const CppToken& token : tokens) {
+        out.push_back({token.start, token.end, cppTokenColor(palette, token.kind)});
+    }
+}
+
+std::string_view trimCarriageReturn(std::string_view text) {
+    if (!text.empty() && text.back() == '\r') {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+uint64_t hashLine(std::string_view text) {
+    return static_cast<uint64_t>(std::hash<std::string_view>{}(text));
+}
+
+// Background submits wait for this long without edits, but never longer than
+// kMaxSubmitDelay while edits keep coming.
+constexpr std::chrono::milliseconds kSubmitQuietTime(100);
+constexpr std::chrono::milliseconds kMaxSubmitDelay(1000);
+
+} // namespace
+
+SyntaxHighlightCache::SyntaxHighlightCache()
+    : m_background(std::make_shared<LexedTextSlot>()) {}
+
+void SyntaxHighlightCache::Reset() {
+    m_lines.clear();
+    m_consistentLines = 0;
+}
+
+void SyntaxHighlightCache::OnEdit(size_t firstLine, size_t removedLines, size_t insertedLines) {
+    m_consistentLines = std::min(m_consistentLines, firstLine);
+    if (firstLine >= m_lines.size()) {
+        return;
+    }
+
+    // Lines below the edit keep their entries, shifted to their new index, so they
+    // are only re-lexed if the edit changed the state they start in.
+    const auto tail = m_lines.begin() + static_cast<std::ptrdiff_t>(firstLine + 1);
+    const size_t removable = std::min(removedLines, static_cast<size_t>(m_lines.end() - tail));
+    m_lines.erase(tail, tail + static_cast<std::ptrdiff_t>(removable));
+    m_lines.insert(m_lines.begin() + static_cast<std::ptrdiff_t>(firstLine + 1), insertedLines, CachedLine());
+    m_lines[firstLine].valid = false;
+}
+
+void SyntaxHighlightCache::SetPalette(const CppSyntaxPalette& palette) {
+    if (m_hasPalette && samePalette(m_palette, palette)) {
+        return;
+    }
+    m_palette = palette;
+    m_hasPalette = true;
+    Reset();
+}
+
+const std::vector<fst::TextSegment>& SyntaxHighlightCache::Line(
+    const TextDocument& document,
+    size_t line,
+    std::string_view lineText) {
+    if (m_lines.size() <= line) {
+        m_lines.resize(std::max(line + 1, document.LineCount()));
+    }
+
+    // Far below the consistent prefix, a background result for this exact version
+    // already knows the start state; otherwise walk down from the last consistent
+    // line, skipping lines whose cached start state still matches.
+    std::shared_ptr<const LexedText> lexed;
+    if (line > m_consistentLines) {
+        lexed = m_background->Latest();
+        if (!lexed || lexed->version != document.Version() || line > lexed->LineCount()) {
+            lexed.reset();
+        }
+    }
+    std::string scratch;
+    for (size_t i = m_consistentLines; i < line && !lexed; ++i) {
+        const CppLexState& startState = i == 0 ? CppLexState() : m_lines[i - 1].endState;
+        CachedLine& entry = m_lines[i];
+        if (entry.valid && entry.startState == startState) {
+            continue;
+        }
+        const size_t start = document.LineStart(i);
+        scratch = document.Substr(start, document.LineEnd(i) - start);
+        const std::string_view text = trimCarriageReturn(scratch);
+        Lex(entry, CppLexState(startState), text, hashLine(text));
+    }
+    if (!lexed) {
+        m_consistentLines = std::max(m_consistentLines, line);
+    }
+
+    const CppLexState startState = line == 0   ? CppLexState()
+                                   : lexed     ? lexed->lineEndStates[line - 1]
+                                               : m_lines[line - 1].endState;
+    CachedLine& entry = m_lines[line];
+    const std::string_view text = trimCarriageReturn(lineText);
+    const uint64_t textHash = hashLine(text);
+    if (!entry.valid || entry.textHash != textHash || entry.startState != startState) {
+        const CppLexState previousEnd = entry.endState;
+        const bool wasValid = entry.valid;
+        Lex(entry, startState, text, textHash);
+        if (!wasValid || entry.endState != previousEnd) {
+            // Lines below were lexed from the old end state and must be re-checked.
+            m_consistentLines = std::min(m_consistentLines, line + 1);
+        }
+    }
+    if (m_consistentLines == line) {
+        m_consistentLines = line + 1;
+    }
+    return entry.segments;
+}
+
+void SyntaxHighlightCache::Schedule(BackgroundLexer& lexer, const TextDocument& document) {
+    const uint64_t version = document.Version();
+    if (m_scheduledVersion == version) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (m_seenVersion != version) {
+        if (m_seenVersion == m_scheduledVersion) {
+            m_firstPending = now;
+        }
+        m_seenVersion = version;
+        m_lastEdit = now;
+    }
+    // The first version goes out at once so a freshly opened file gets its minimap.
+    if (m_scheduledVersion != UINT64_MAX && now - m_lastEdit < kSubmitQuietTime &&
+        now - m_firstPending < kMaxSubmitDelay) {
+        return;
+    }
+    m_scheduledVersion = version;
+    lexer.Submit(m_background, version, std::make_shared<const std::string>(document.Text()));
+}
+
+std::shared_ptr<const LexedText> SyntaxHighlightCache::Lexed() const {
+    return m_background->Latest();
+}
+
+void SyntaxHighlightCache::Lex(CachedLine& entry, const CppLexState& startState, std::string_view text, uint64_t textHash) {
+    m_tokens.clear();
+    CppLexState state = startState;
+    LexCppLine(text, state, m_tokens);
+
+    entry.valid = true;
+    entry.textHash = textHash;
+    entry.startState = startState;
+    entry.endState = std::move(state);
+    entry.segments.clear();
+    appendSegments(m_tokens, m_palette, entry.segments);
+}
+
+void applyCppSyntaxHighlighting(DocumentTab& tab, const fst::Theme& theme) {
+    const std::string& pathOrName = tab.path.empty() ? tab.name : tab.path;
+    if (!isCppLikePath(pathOrName)) {
+        tab.editor.setStyleProvider({});
+        return;
+    }
+
+    tab.highlight.SetPalette(cppSyntaxPalette(theme));
+    DocumentTab* target = &tab;
+    tab.editor.setStyleProvider([target](int line, const std::string& lineText) {
+        return target->highlight.Line(target->document, static_cast<size_t>(std::max(0, line)), lineText);
+    });
+}
+
+std::vector<fst::TextSegment> colorizeCppSnippet(const std::string& text, const fst::Theme& theme) {
+    std::vector<CppToken> tokens;
+    CppLexState state;
+    LexCppLine(text, state, tokens);
+
+    std::vector<fst::TextSegment> segments;
+    appendSegments(tokens, cppSyntaxPalette(theme), segments);
+    return segments;
+}
+
+} // namespace fin
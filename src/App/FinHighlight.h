@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Core/BackgroundLexer.h"
+#include "Core/CppLexer.h"
+#include "Core/TextDocument.h"
+#include "fastener/fastener.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fin {
+
+struct DocumentTab;
+
+struct CppSyntaxPalette {
+    fst::Color keyword;
+    fst::Color type;
+    fst::Color number;
+    fst::Color stringLiteral;
+    fst::Color comment;
+    fst::Color preprocessor;
+    fst::Color function;
+    fst::Color punctuation;
+};
+
+// Per-document C++ highlighting. Every line keeps the lexer state it started and
+// ended in plus its coloured segments; an edit only invalidates the lines it touched
+// and re-lexing walks forward until a line's start state matches what it had before.
+// Whole-document tokens come from a BackgroundLexer; once they match the current
+// document version, lines far below the last lexed one take their start state from
+// there instead of walking.
+class SyntaxHighlightCache {
+public:
+    SyntaxHighlightCache();
+
+    // Drops everything, e.g. after the whole text was replaced.
+    void Reset();
+
+    // Called for each edit before it is applied: `firstLine` is where it starts,
+    // `removedLines`/`insertedLines` count the '\n' it removes and inserts.
+    void OnEdit(size_t firstLine, size_t removedLines, size_t insertedLines);
+
+    // Palette changes (light/dark theme) drop the cached segments.
+    void SetPalette(const CppSyntaxPalette& palette);
+
+    // Segments for `line`, whose current text is `lineText`. Earlier lines whose
+    // state is not known yet are lexed from `document`.
+    const std::vector<fst::TextSegment>& Line(const TextDocument& document, size_t line, std::string_view lineText);
+
+    // Queues the document on `lexer` if it changed since the last submit. Call every
+    // frame: after the first submit, edits are batched until typing pauses, so a
+    // burst of keystrokes copies the text once rather than once per key.
+    void Schedule(BackgroundLexer& lexer, const TextDocument& document);
+    // Latest whole-document tokens, possibly a few edits old; null until the first run.
+    std::shared_ptr<const LexedText> Lexed() const;
+
+private:
+    struct CachedLine {
+        bool valid = false;
+        uint64_t textHash = 0;
+        CppLexState startState;
+        CppLexState endState;
+        std::vector<fst::TextSegment> segments;
+    };
+
+    void Lex(CachedLine& entry, const CppLexState& startState, std::string_view text, uint64_t textHash);
+
+    std::vector<CachedLine> m_lines;
+    size_t m_consistentLines = 0; // lines [0, m_consistentLines) chain from the top without gaps
+    CppSyntaxPalette m_palette{};
+    bool m_hasPalette = false;
+    std::vector<CppToken> m_tokens;
+
+    uint64_t m_scheduledVersion = UINT64_MAX;
+    uint64_t m_seenVersion = UINT64_MAX;
+    std::chrono::steady_clock::time_point m_lastEdit;     // when m_seenVersion was first seen
+    std::chrono::steady_clock::time_point m_firstPending; // first edit not yet submitted
+    std::shared_ptr<LexedTextSlot> m_background;
+};
+
+CppSyntaxPalette cppSyntaxPalette(const fst::Theme& theme);
+const fst::Color& cppTokenColor(const CppSyntaxPalette& palette, CppTokenKind kind);
+
+// Installs the cached highlighter as the tab's style provider (or clears it for non-C++ files).
+void applyCppSyntaxHighlighting(DocumentTab& tab, const fst::Theme& theme);
+// Stateless single-line colouring for snippets outside a document (completion rows, minimap).
+std::vector<fst::TextSegment> colorizeCppSnippet(const std::string& text, const fst::Theme& theme);
+
+} // namespace fin
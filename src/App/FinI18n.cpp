@@ -25,6 +25,7 @@ constexpr TranslationEntry kTranslations[] = {
     {"window.console", "Konsola", "Console"},
     {"window.lsp_diagnostics", "Diagnostyka LSP", "LSP Diagnostics"},
     {"window.terminal", "Terminal", "Terminal"},
+    {"window.search_results", "Wyniki wyszukiwania", "Search Results"},
     {"window.settings", "Ustawienia", "Settings"},
     {"window.personalization", "Personalizacja", "Personalization"},
     {"window.completion", "Autouzupelnianie", "Autocomplete"},
@@ -39,6 +40,7 @@ constexpr TranslationEntry kTranslations[] = {
     {"menu.file.close_tab", "Zamknij karte", "Close tab"},
     {"menu.file.exit", "Zakoncz", "Exit"},
     {"menu.edit.find", "Szukaj", "Find"},
+    {"menu.edit.find_in_files", "Szukaj w plikach", "Find in Files"},
     {"menu.edit.autocomplete", "Autouzupelnianie", "Autocomplete"},
     {"menu.build.run", "Kompiluj i uruchom", "Build and run"},
     {"menu.view.explorer", "Eksplorator", "Explorer"},
@@ -46,6 +48,7 @@ constexpr TranslationEntry kTranslations[] = {
     {"menu.view.console", "Konsola", "Console"},
     {"menu.view.lsp_diagnostics", "Diagnostyka LSP", "LSP Diagnostics"},
     {"menu.view.terminal", "Terminal", "Terminal"},
+    {"menu.view.search_results", "Wyniki wyszukiwania", "Search Results"},
     {"menu.view.settings", "Ustawienia", "Settings"},
     {"menu.view.personalization", "Personalizacja", "Personalization"},
     {"menu.view.minimap", "Minimapa", "Minimap"},
@@ -64,6 +67,8 @@ constexpr TranslationEntry kTranslations[] = {
     {"settings.auto_brackets", "Auto-domykanie nawiasow", "Auto-close brackets"},
     {"settings.smart_indent", "Smart indent", "Smart indent"},
     {"settings.minimap", "Minimapa edytora", "Editor minimap"},
+    {"settings.workspace_index", "Indeks plikow dla Znajdz w plikach", "File index for Find in Files"},
+    {"settings.symbol_index", "Indeks symboli projektu dla podpowiedzi", "Workspace symbols in completion"},
     {"settings.theme", "Motyw", "Theme"},
     {"settings.zoom", "Zoom", "Zoom"},
     {"settings.language", "Jezyk", "Language"},
@@ -97,11 +102,30 @@ constexpr TranslationEntry kTranslations[] = {
     {"completion.none", "Brak podpowiedzi.", "No suggestions."},
     {"completion.source.local", "Zrodlo: lokalne", "Source: local"},
     {"completion.source.lsp", "Zrodlo: LSP", "Source: LSP"},
+    {"completion.source.workspace", "Zrodlo: symbole projektu", "Source: workspace symbols"},
     {"completion.details", "Szczegoly: {0}", "Details: {0}"},
     {"completion.hint", "Strzalki = wybor, Enter = wstaw, Esc = zamknij", "Arrows = select, Enter = insert, Esc = close"},
 
     {"find.next", "Dalej", "Next"},
     {"find.previous", "Wstecz", "Previous"},
+    {"find.invalid_regex", "Błędny regex", "Invalid regex"},
+    {"find.replace", "Zamień", "Replace"},
+    {"find.replace_all", "Zamień wszystko", "Replace all"},
+
+    {"search.start", "Szukaj", "Search"},
+    {"search.cancel", "Anuluj", "Cancel"},
+    {"search.match_case", "Wielkosc liter", "Match case"},
+    {"search.whole_word", "Cale slowa", "Whole word"},
+    {"search.regex", "Regex", "Regex"},
+    {"search.folder", "Folder: {0}", "Folder: {0}"},
+    {"search.running", "Szukanie... plikow: {0}, wynikow: {1}", "Searching... {0} files, {1} results"},
+    {"search.summary", "Wynikow: {0} w plikach: {1}", "{0} results in {1} files"},
+    {"search.truncated", "Zatrzymano po {0} wynikach w plikach: {1}", "Stopped after {0} results in {1} files"},
+    {"search.no_results", "Brak wynikow.", "No results."},
+    {"search.more_hidden", "Nie pokazano kolejnych wynikow: {0}", "{0} more results not shown"},
+    {"search.long_lines_skipped", "Regex pominal linie dluzsze niz {1} KB: {0}", "{0} lines longer than {1} KB not searched in regex mode"},
+    {"search.index_skipped", "Pominieto dzieki indeksowi plikow: {0}", "{0} files ruled out by the index"},
+    {"search.index_building", "Budowanie indeksu plikow...", "Building file index..."},
 
     {"explorer.path", "Sciezka: {0}", "Path: {0}"},
     {"explorer.up", ".. (w gore)", ".. (up)"},
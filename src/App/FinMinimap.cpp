@@ -0,0 +1,247 @@
+#include "App/FinMinimap.h"
+
+#include "Core/CharScan.h"
+
+#include <algorithm>
+
+namespace fin {
+
+namespace {
+
+constexpr int kMinimapTabWidth = 4;
+// Widest the minimap ever gets (see visibleColumns); runs past it are never drawn.
+constexpr int kMinimapMaxColumns = 240;
+// Without background tokens, C++ colouring lexes each sampled line on the spot,
+// which is only worth it for smaller files.
+constexpr int kMinimapSnippetLineLimit = 1800;
+
+constexpr uint64_t kPlainColorKey = 1;
+constexpr uint64_t kSnippetColorKey = 2;
+
+int MinimapColumnAdvance(char ch) {
+    return ch == '\t' ? kMinimapTabWidth : 1;
+}
+
+bool ColorsEqual(const fst::Color& lhs, const fst::Color& rhs) {
+    return lhs.r == rhs.r &&
+           lhs.g == rhs.g &&
+           lhs.b == rhs.b &&
+           lhs.a == rhs.a;
+}
+
+bool PalettesEqual(const CppSyntaxPalette& lhs, const CppSyntaxPalette& rhs) {
+    return ColorsEqual(lhs.keyword, rhs.keyword) &&
+           ColorsEqual(lhs.type, rhs.type) &&
+           ColorsEqual(lhs.number, rhs.number) &&
+           ColorsEqual(lhs.stringLiteral, rhs.stringLiteral) &&
+           ColorsEqual(lhs.comment, rhs.comment) &&
+           ColorsEqual(lhs.preprocessor, rhs.preprocessor) &&
+           ColorsEqual(lhs.function, rhs.function) &&
+           ColorsEqual(lhs.punctuation, rhs.punctuation);
+}
+
+} // namespace
+
+void MinimapCache::Reset() {
+    m_lines.clear();
+}
+
+void MinimapCache::OnEdit(size_t firstLine, size_t removedLines, size_t insertedLines) {
+    if (firstLine >= m_lines.size()) {
+        return;
+    }
+
+    const auto tail = m_lines.begin() + static_cast<std::ptrdiff_t>(firstLine + 1);
+    const size_t removable = std::min(removedLines, static_cast<size_t>(m_lines.end() - tail));
+    m_lines.erase(tail, tail + static_cast<std::ptrdiff_t>(removable));
+    m_lines.insert(m_lines.begin() + static_cast<std::ptrdiff_t>(firstLine + 1), insertedLines, CachedLine());
+    m_lines[firstLine].valid = false;
+}
+
+const std::vector<MinimapRect>& MinimapCache::Update(
+    const TextDocument& document,
+    bool cppLike,
+    const LexedText* lexed,
+    const fst::Theme& theme,
+    float width,
+    float height) {
+    if (!cppLike) {
+        lexed = nullptr;
+    }
+
+    const CppSyntaxPalette palette = cppSyntaxPalette(theme);
+    if (!m_hasTheme || !PalettesEqual(m_palette, palette) || !ColorsEqual(m_plainColor, theme.colors.textSecondary)) {
+        m_palette = palette;
+        m_plainColor = theme.colors.textSecondary;
+        m_hasTheme = true;
+        m_lines.clear();
+        m_rectsDirty = true;
+    }
+
+    const std::string& text = document.Text();
+    const bool rangesChanged = m_rangesVersion != document.Version();
+    if (rangesChanged) {
+        CollectRanges(text);
+        m_rangesVersion = document.Version();
+        m_rectsDirty = true;
+    }
+    m_lines.resize(m_ranges.size());
+
+    if (width != m_width || height != m_height) {
+        m_width = width;
+        m_height = height;
+        m_rectsDirty = true;
+    }
+
+    // A new background result may recolour any line (an opened comment spills down),
+    // so sampled lines compare their token key instead of trusting their edit state.
+    const uint64_t lexedVersion = lexed != nullptr ? lexed->version : 0;
+    const bool recheckColors = rangesChanged || lexedVersion != m_lexedVersion;
+    m_lexedVersion = lexedVersion;
+
+    const int drawDensity = std::max(1, static_cast<int>(height * 1.8f));
+    const int lineStep = std::max(1, m_totalLines / drawDensity);
+    for (int line = 0; line < m_totalLines; line += lineStep) {
+        const int lineLimit = std::min(m_totalLines, line + lineStep);
+        const size_t sampleLine = static_cast<size_t>(line + (lineLimit - line) / 2);
+        CachedLine& entry = m_lines[sampleLine];
+        if (entry.valid && !recheckColors) {
+            continue;
+        }
+        if (entry.valid && entry.colorKey == ColorKey(sampleLine, cppLike, lexed)) {
+            continue;
+        }
+        const LineRange& range = m_ranges[sampleLine];
+        Raster(entry, std::string_view(text.data() + range.start, range.end - range.start), sampleLine, cppLike, lexed, theme);
+        m_rectsDirty = true;
+    }
+
+    if (!m_rectsDirty) {
+        return m_rects;
+    }
+    m_rectsDirty = false;
+    m_rects.clear();
+
+    const int visibleColumns = std::clamp(m_maxLineLength + 4, 64, kMinimapMaxColumns);
+    const float columnWidth = width / static_cast<float>(visibleColumns);
+    for (int line = 0; line < m_totalLines; line += lineStep) {
+        const int lineLimit = std::min(m_totalLines, line + lineStep);
+        const int sampleLine = line + (lineLimit - line) / 2;
+        const float lineTop = (static_cast<float>(line) / static_cast<float>(m_totalLines)) * height;
+        const float lineBottom = (static_cast<float>(lineLimit) / static_cast<float>(m_totalLines)) * height;
+        const float lineHeight = std::max(1.0f, lineBottom - lineTop - 0.15f);
+
+        for (const Run& run : m_lines[static_cast<size_t>(sampleLine)].runs) {
+            if (run.column >= visibleColumns) {
+                break;
+            }
+            const float x = static_cast<float>(run.column) * columnWidth;
+            if (x >= width) {
+                break;
+            }
+            float runWidth = std::max(1.0f, static_cast<float>(run.width) * columnWidth);
+            runWidth = std::min(runWidth, std::max(1.0f, width - x));
+            m_rects.push_back({fst::Rect(x, lineTop, runWidth, lineHeight), run.color});
+        }
+    }
+    return m_rects;
+}
+
+uint64_t MinimapCache::ColorKey(size_t line, bool cppLike, const LexedText* lexed) const {
+    if (lexed != nullptr && line < lexed->LineCount()) {
+        // FNV-1a over the line's tokens; the top bit keeps it apart from the fixed keys.
+        uint64_t hash = 1469598103934665603ull;
+        const auto mix = [&hash](uint64_t value) {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+        for (uint32_t t = lexed->lineFirstToken[line]; t < lexed->lineFirstToken[line + 1]; ++t) {
+            const CppToken& token = lexed->tokens[t];
+            mix(static_cast<uint64_t>(token.start));
+            mix(static_cast<uint64_t>(token.end));
+            mix(static_cast<uint64_t>(token.kind));
+        }
+        return hash | (uint64_t(1) << 63);
+    }
+    if (cppLike && m_totalLines <= kMinimapSnippetLineLimit) {
+        return kSnippetColorKey;
+    }
+    return kPlainColorKey;
+}
+
+void MinimapCache::Raster(
+    CachedLine& entry,
+    std::string_view text,
+    size_t line,
+    bool cppLike,
+    const LexedText* lexed,
+    const fst::Theme& theme) {
+    entry.valid = true;
+    entry.colorKey = ColorKey(line, cppLike, lexed);
+    entry.runs.clear();
+    if (text.empty()) {
+        return;
+    }
+
+    std::vector<fst::Color> charColors(text.size(), m_plainColor);
+    const auto paint = [&](int start, int end, const fst::Color& color) {
+        const int from = std::clamp(start, 0, static_cast<int>(text.size()));
+        const int to = std::clamp(end, 0, static_cast<int>(text.size()));
+        for (int i = from; i < to; ++i) {
+            charColors[static_cast<size_t>(i)] = color;
+        }
+    };
+    if (entry.colorKey == kSnippetColorKey) {
+        for (const fst::TextSegment& segment : colorizeCppSnippet(std::string(text), theme)) {
+            paint(segment.startColumn, segment.endColumn, segment.color);
+        }
+    } else if (entry.colorKey != kPlainColorKey) {
+        for (uint32_t t = lexed->lineFirstToken[line]; t < lexed->lineFirstToken[line + 1]; ++t) {
+            const CppToken& token = lexed->tokens[t];
+            paint(token.start, token.end, cppTokenColor(m_palette, token.kind));
+        }
+    }
+
+    int visualColumn = 0;
+    bool runActive = false;
+    for (size_t i = 0; i < text.size() && visualColumn < kMinimapMaxColumns; ++i) {
+        const char ch = text[i];
+        const int advance = MinimapColumnAdvance(ch);
+        if (IsBlankByte(ch)) {
+            runActive = false;
+            visualColumn += advance;
+            continue;
+        }
+
+        const fst::Color& baseColor = charColors[i];
+        const fst::Color pixelColor(baseColor.r, baseColor.g, baseColor.b, 120);
+        if (runActive && ColorsEqual(entry.runs.back().color, pixelColor)) {
+            entry.runs.back().width += advance;
+        } else {
+            entry.runs.push_back({visualColumn, advance, pixelColor});
+            runActive = true;
+        }
+        visualColumn += advance;
+    }
+}
+
+void MinimapCache::CollectRanges(const std::string& text) {
+    std::vector<LineSpan> spans;
+    spans.reserve(m_ranges.size() + 1);
+    CollectLines(text, spans);
+
+    m_ranges.clear();
+    m_ranges.reserve(spans.size());
+    m_maxLineLength = 0;
+    for (const LineSpan& span : spans) {
+        LineRange range;
+        range.start = span.start;
+        range.end = span.end;
+        range.visualLength = static_cast<int>(span.end - span.start + span.tabs * (kMinimapTabWidth - 1));
+        m_maxLineLength = std::max(m_maxLineLength, range.visualLength);
+        m_ranges.push_back(range);
+    }
+    m_totalLines = std::max(1, static_cast<int>(m_ranges.size()));
+}
+
+} // namespace fin
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "App/FinHighlight.h"
+#include "Core/BackgroundLexer.h"
+#include "Core/TextDocument.h"
+#include "fastener/fastener.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fin {
+
+// One filled rect of the minimap, relative to the top-left of its inner area.
+struct MinimapRect {
+    fst::Rect rect;
+    fst::Color color;
+};
+
+// Per-document minimap raster. Each sampled line keeps its coloured column runs; an
+// edit only invalidates the lines it touched, and the final rect list is rebuilt only
+// when a line, the line count or the minimap size changed, so idle frames just replay it.
+class MinimapCache {
+public:
+    // Drops everything, e.g. after the whole text was replaced.
+    void Reset();
+
+    // Called for each edit before it is applied, with the same arguments as
+    // SyntaxHighlightCache::OnEdit.
+    void OnEdit(size_t firstLine, size_t removedLines, size_t insertedLines);
+
+    // Brings the raster up to date for `document` drawn into a `width` x `height` area.
+    // `lexed` (may be null or a few edits old) colours C++ lines at any file size.
+    const std::vector<MinimapRect>& Update(
+        const TextDocument& document,
+        bool cppLike,
+        const LexedText* lexed,
+        const fst::Theme& theme,
+        float width,
+        float height);
+
+    int TotalLines() const { return m_totalLines; }
+
+private:
+    struct LineRange {
+        size_t start = 0;
+        size_t end = 0;
+        int visualLength = 0;
+    };
+
+    struct Run {
+        int column = 0;
+        int width = 0;
+        fst::Color color;
+    };
+
+    struct CachedLine {
+        bool valid = false;
+        uint64_t colorKey = 0; // what the colours came from; see ColorKey
+        std::vector<Run> runs;
+    };
+
+    uint64_t ColorKey(size_t line, bool cppLike, const LexedText* lexed) const;
+    void Raster(CachedLine& entry, std::string_view text, size_t line, bool cppLike, const LexedText* lexed, const fst::Theme& theme);
+    void CollectRanges(const std::string& text);
+
+    std::vector<LineRange> m_ranges;
+    uint64_t m_rangesVersion = UINT64_MAX;
+    int m_totalLines = 1;
+    int m_maxLineLength = 0;
+
+    std::vector<CachedLine> m_lines;
+    uint64_t m_lexedVersion = 0;
+    CppSyntaxPalette m_palette{};
+    fst::Color m_plainColor;
+    bool m_hasTheme = false;
+
+    std::vector<MinimapRect> m_rects;
+    bool m_rectsDirty = true;
+    float m_width = 0.0f;
+    float m_height = 0.0f;
+};
+
+} // namespace fin
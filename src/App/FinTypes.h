@@ -4,9 +4,15 @@
 #define NOMINMAX
 #endif
 
+#include "App/FinHighlight.h"
+#include "App/FinMinimap.h"
+#include "Core/FindEngine.h"
+#include "Core/IdentifierIndex.h"
 #include "Core/LSPClient.h"
+#include "Core/TextDocument.h"
 #include "fastener/fastener.h"
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -18,17 +24,30 @@ struct DocumentTab {
     std::string path;
     std::string lspDocumentPath;
     fst::TextEditor editor;
-    std::string savedText;
+    TextDocument document;
+    SyntaxHighlightCache highlight;
+    MinimapCache minimap;
+    std::vector<LSPContentChange> pendingChanges; // not yet seen by dirty tracking / LSP
+    std::optional<TextChange> editorChange; // typed into the editor this frame
+    // Saved state as version + size + hash, so dirty checks never compare whole texts.
+    uint64_t savedVersion = 0;
+    size_t savedSize = 0;
+    uint64_t savedHash = 0;
+    uint64_t dirtyCheckedVersion = 0;
     bool dirty = false;
 
     bool lspOpened = false;
-    std::string lspTextSnapshot;
     std::vector<LSPDiagnostic> lspDiagnostics;
 
     bool findVisible = false;
     bool findFocusPending = false;
     std::string findQuery;
+    std::string replaceText;
     int findMatchIndex = -1;
+    FindOptions findOptions;
+    FindEngine find;
+
+    IdentifierIndex identifiers; // local completion candidates
 };
 
 } // namespace fin
@@ -1,6 +1,9 @@
 #include "App/Panels/EditorPanel.h"
 
+#include "App/FinDocument.h"
 #include "App/FinHelpers.h"
+#include "App/FinHighlight.h"
+#include "App/FinMinimap.h"
 #include "fastener/fastener.h"
 
 #include <algorithm>
@@ -20,24 +23,10 @@ bool ColorsEqual(const fst::Color& lhs, const fst::Color& rhs) {
            lhs.a == rhs.a;
 }
 
-std::vector<size_t> FindAllMatches(const std::string& text, const std::string& query) {
-    std::vector<size_t> offsets;
-    if (query.empty() || text.empty()) {
-        return offsets;
-    }
-
-    size_t pos = text.find(query);
-    while (pos != std::string::npos) {
-        offsets.push_back(pos);
-        pos = text.find(query, pos + 1);
-    }
-    return offsets;
-}
-
 std::vector<fst::TextSegment> BuildSearchStyledSegments(
     const std::string& lineText,
     const std::vector<fst::TextSegment>& baseSegments,
-    const std::string& query,
+    const std::vector<FindMatch>& matches,
     const fst::Color& defaultTextColor,
     const fst::Color& matchBackground) {
     std::vector<fst::TextSegment> result;
@@ -69,14 +58,8 @@ std::vector<fst::TextSegment> BuildSearchStyledSegments(
         paintColorRange(segment.startColumn, segment.endColumn, segment.color);
     }
 
-    if (!query.empty()) {
-        size_t pos = lineText.find(query);
-        while (pos != std::string::npos) {
-            const int start = static_cast<int>(pos);
-            const int end = start + static_cast<int>(query.size());
-            paintBackgroundRange(start, end, matchBackground);
-            pos = lineText.find(query, pos + 1);
-        }
+    for (const FindMatch& match : matches) {
+        paintBackgroundRange(static_cast<int>(match.start), static_cast<int>(match.end), matchBackground);
     }
 
     int i = 0;
@@ -131,45 +114,6 @@ EditorLayout BuildEditorLayout(const fst::Rect& editorArea, bool minimapEnabled)
     return layout;
 }
 
-struct MinimapLineRange {
-    size_t start = 0;
-    size_t end = 0;
-    int visualLength = 0;
-};
-
-int MinimapColumnAdvance(char ch) {
-    return ch == '\t' ? 4 : 1;
-}
-
-std::vector<MinimapLineRange> CollectMinimapLineRanges(const std::string& text) {
-    std::vector<MinimapLineRange> lines;
-    lines.reserve(256);
-
-    const auto pushLine = [&](size_t start, size_t end) {
-        MinimapLineRange line;
-        line.start = start;
-        line.end = end;
-        for (size_t i = start; i < end; ++i) {
-            line.visualLength += MinimapColumnAdvance(text[i]);
-        }
-        lines.push_back(line);
-    };
-
-    size_t lineStart = 0;
-    for (size_t i = 0; i <= text.size(); ++i) {
-        if (i != text.size() && text[i] != '\n') {
-            continue;
-        }
-        pushLine(lineStart, i);
-        lineStart = i + 1;
-    }
-
-    if (lines.empty()) {
-        lines.push_back({});
-    }
-    return lines;
-}
-
 struct MinimapRenderInfo {
     fst::Rect innerBounds;
     int totalLines = 1;
@@ -178,8 +122,10 @@ struct MinimapRenderInfo {
 MinimapRenderInfo RenderEditorMinimap(
     fst::Context& ctx,
     const fst::Rect& minimapArea,
-    const std::string& text,
+    MinimapCache& cache,
+    const TextDocument& document,
     bool cppLike,
+    const LexedText* lexed,
     int firstVisibleLine,
     int visibleLineCount,
     int cursorLine,
@@ -202,107 +148,15 @@ MinimapRenderInfo RenderEditorMinimap(
         return info;
     }
 
-    const std::vector<MinimapLineRange> lineRanges = CollectMinimapLineRanges(text);
-    const int totalLines = std::max(1, static_cast<int>(lineRanges.size()));
+    const std::vector<MinimapRect>& rects = cache.Update(document, cppLike, lexed, theme, inner.width(), inner.height());
+    const int totalLines = cache.TotalLines();
     info.totalLines = totalLines;
-    const auto maxLineIt = std::max_element(
-        lineRanges.begin(),
-        lineRanges.end(),
-        [](const MinimapLineRange& lhs, const MinimapLineRange& rhs) {
-            return lhs.visualLength < rhs.visualLength;
-        });
-    const int maxLineLength = (maxLineIt == lineRanges.end()) ? 0 : maxLineIt->visualLength;
-    const int visibleColumns = std::clamp(maxLineLength + 4, 64, 240);
-    const float columnWidth = inner.width() / static_cast<float>(visibleColumns);
-    const bool useSyntaxColor = cppLike && totalLines <= 1800;
-
-    const int drawDensity = std::max(1, static_cast<int>(inner.height() * 1.8f));
-    const int lineStep = std::max(1, totalLines / drawDensity);
 
     dl.pushClipRect(inner);
-    for (int line = 0; line < totalLines; line += lineStep) {
-        const int lineLimit = std::min(totalLines, line + lineStep);
-        const int sampleLine = line + (lineLimit - line) / 2;
-        const MinimapLineRange& sample = lineRanges[static_cast<size_t>(sampleLine)];
-        const std::string_view lineView(text.data() + sample.start, sample.end - sample.start);
-
-        const float lineTop = inner.y() + (static_cast<float>(line) / static_cast<float>(totalLines)) * inner.height();
-        const float lineBottom =
-            inner.y() + (static_cast<float>(lineLimit) / static_cast<float>(totalLines)) * inner.height();
-        const float lineHeight = std::max(1.0f, lineBottom - lineTop - 0.15f);
-
-        if (lineView.empty()) {
-            continue;
-        }
-
-        std::vector<fst::Color> charColors(lineView.size(), theme.colors.textSecondary);
-        if (useSyntaxColor) {
-            const std::string lineOwned(lineView);
-            const std::vector<fst::TextSegment> segments = colorizeCppSnippet(lineOwned, theme);
-            for (const fst::TextSegment& segment : segments) {
-                const int from = std::clamp(segment.startColumn, 0, static_cast<int>(lineView.size()));
-                const int to = std::clamp(segment.endColumn, 0, static_cast<int>(lineView.size()));
-                for (int i = from; i < to; ++i) {
-                    charColors[static_cast<size_t>(i)] = segment.color;
-                }
-            }
-        }
-
-        bool runActive = false;
-        int runStartColumn = 0;
-        int runWidthColumns = 0;
-        fst::Color runColor = theme.colors.textSecondary;
-        int visualColumn = 0;
-
-        const auto flushRun = [&]() {
-            if (!runActive || runWidthColumns <= 0) {
-                return;
-            }
-            const float x = inner.x() + static_cast<float>(runStartColumn) * columnWidth;
-            if (x >= inner.right()) {
-                runActive = false;
-                runWidthColumns = 0;
-                return;
-            }
-            float width = std::max(1.0f, static_cast<float>(runWidthColumns) * columnWidth);
-            width = std::min(width, std::max(1.0f, inner.right() - x));
-            dl.addRectFilled(fst::Rect(x, lineTop, width, lineHeight), runColor);
-            runActive = false;
-            runWidthColumns = 0;
-        };
-
-        for (size_t i = 0; i < lineView.size() && visualColumn < visibleColumns; ++i) {
-            const char ch = lineView[i];
-            const int advance = MinimapColumnAdvance(ch);
-            const bool whitespace = (ch == ' ' || ch == '\t');
-
-            if (whitespace) {
-                flushRun();
-                visualColumn += advance;
-                continue;
-            }
-
-            fst::Color baseColor = charColors[i];
-            fst::Color pixelColor(baseColor.r, baseColor.g, baseColor.b, 120);
-
-            if (!runActive) {
-                runActive = true;
-                runStartColumn = visualColumn;
-                runWidthColumns = advance;
-                runColor = pixelColor;
-            } else if (!ColorsEqual(runColor, pixelColor)) {
-                flushRun();
-                runActive = true;
-                runStartColumn = visualColumn;
-                runWidthColumns = advance;
-                runColor = pixelColor;
-            } else {
-                runWidthColumns += advance;
-            }
-
-            visualColumn += advance;
-        }
-        flushRun();
+    for (const MinimapRect& rect : rects) {
+        dl.addRectFilled(
+            fst::Rect(inner.x() + rect.rect.x(), inner.y() + rect.rect.y(), rect.rect.width(), rect.rect.height()),
+            rect.color);
     }
     dl.popClipRect();
 
@@ -399,31 +253,34 @@ void HandleMinimapNavigation(
         return;
     }
 
-    const std::string editorWidgetKey =
-        "text_editor_" + std::to_string(reinterpret_cast<std::uintptr_t>(&editor));
-    ctx.setFocusedWidget(ctx.makeId(editorWidgetKey));
+    ctx.setFocusedWidget(ctx.makeId(EditorWidgetKey(editor)));
     ctx.input().consumeMouse();
 }
 
 void ApplySearchAwareStyle(DocumentTab& tab, const fst::Theme& theme) {
-    const std::string pathOrName = tab.path.empty() ? tab.name : tab.path;
+    applyCppSyntaxHighlighting(tab, theme);
     if (!tab.findVisible || tab.findQuery.empty()) {
-        applyCppSyntaxHighlighting(tab.editor, pathOrName, theme);
         return;
     }
 
+    const std::string pathOrName = tab.path.empty() ? tab.name : tab.path;
+
     const bool cppLike = isCppLikePath(pathOrName);
-    const std::string query = tab.findQuery;
     const fst::Color matchBackground(
         theme.colors.warning.r,
         theme.colors.warning.g,
         theme.colors.warning.b,
         95);
 
-    tab.editor.setStyleProvider([cppLike, query, theme, matchBackground](int, const std::string& lineText) {
-        const std::vector<fst::TextSegment> baseSegments =
-            cppLike ? colorizeCppSnippet(lineText, theme) : std::vector<fst::TextSegment>{};
-        return BuildSearchStyledSegments(lineText, baseSegments, query, theme.colors.text, matchBackground);
+    DocumentTab* target = &tab;
+    tab.editor.setStyleProvider([target, cppLike, theme, matchBackground](int line, const std::string& lineText) {
+        static const std::vector<fst::TextSegment> kNoSegments;
+        const size_t lineIndex = static_cast<size_t>(std::max(0, line));
+        const std::vector<fst::TextSegment>& baseSegments =
+            cppLike ? target->highlight.Line(target->document, lineIndex, lineText) : kNoSegments;
+        std::vector<FindMatch> matches;
+        target->find.LineMatches(target->document, lineIndex, matches);
+        return BuildSearchStyledSegments(lineText, baseSegments, matches, theme.colors.text, matchBackground);
     });
 }
 
@@ -432,7 +289,9 @@ bool RenderFindBar(
     DocumentTab& tab,
     const fst::Rect& barRect,
     bool& requestNextMatch,
-    bool& requestPreviousMatch) {
+    bool& requestPreviousMatch,
+    bool& requestReplace,
+    bool& requestReplaceAll) {
     const fst::Theme& theme = ctx.theme();
     fst::IDrawList& dl = ctx.drawList();
 
@@ -441,10 +300,13 @@ bool RenderFindBar(
 
     const float padding = 6.0f;
     const float gap = 6.0f;
-    const float controlHeight = std::max(20.0f, barRect.height() - padding * 2.0f);
+    // Two rows: find input, mode toggles, next/previous and counter; then replace.
+    const float controlHeight = std::max(20.0f, (barRect.height() - padding * 3.0f) * 0.5f);
+    const float replaceRowY = barRect.y() + padding * 2.0f + controlHeight;
     const float buttonWidth = 86.0f;
+    const float toggleWidth = 30.0f;
     const float counterReserve = 80.0f;
-    const float reservedWidth = buttonWidth * 2.0f + counterReserve + gap * 3.0f;
+    const float reservedWidth = toggleWidth * 3.0f + buttonWidth * 2.0f + counterReserve + gap * 6.0f;
     const float inputWidth = std::max(10.0f, barRect.width() - padding * 2.0f - reservedWidth);
 
     const std::string inputId = "editor_find_input_" + tab.id;
@@ -457,9 +319,29 @@ bool RenderFindBar(
     inputOptions.style = fst::Style()
                              .withPos(barRect.x() + padding, barRect.y() + padding)
                              .withSize(inputWidth, controlHeight);
-    const bool queryChanged = fst::TextInput(ctx, inputId, tab.findQuery, inputOptions);
+    bool queryChanged = fst::TextInput(ctx, inputId, tab.findQuery, inputOptions);
+
+    // Mode toggles; an active one gets an accent outline.
+    float toggleX = barRect.x() + padding + inputWidth + gap;
+    const auto renderToggle = [&](const char* label, bool& enabled) {
+        fst::ButtonOptions toggleOptions;
+        toggleOptions.style = fst::Style().withPos(toggleX, barRect.y() + padding).withSize(toggleWidth, controlHeight);
+        if (fst::Button(ctx, label, toggleOptions)) {
+            enabled = !enabled;
+            queryChanged = true;
+        }
+        if (enabled) {
+            dl.addRect(fst::Rect(toggleX, barRect.y() + padding, toggleWidth, controlHeight), theme.colors.primary);
+        }
+        toggleX += toggleWidth + gap;
+    };
+    bool matchCase = tab.findOptions.caseSensitive;
+    renderToggle("Aa", matchCase);
+    tab.findOptions.caseSensitive = matchCase;
+    renderToggle("ab", tab.findOptions.wholeWord);
+    renderToggle(".*", tab.findOptions.regex);
 
-    const float nextX = barRect.x() + padding + inputWidth + gap;
+    const float nextX = toggleX;
     fst::ButtonOptions nextOptions;
     nextOptions.style = fst::Style().withPos(nextX, barRect.y() + padding).withSize(buttonWidth, controlHeight);
     if (fst::Button(ctx, fst::i18n("find.next"), nextOptions)) {
@@ -473,21 +355,39 @@ bool RenderFindBar(
         requestPreviousMatch = true;
     }
 
-    const std::vector<size_t> matches = FindAllMatches(tab.editor.getText(), tab.findQuery);
+    const std::vector<FindMatch>& matches = tab.find.Matches(tab.document, tab.findQuery, tab.findOptions);
     const int safeIndex = (tab.findMatchIndex >= 0 && tab.findMatchIndex < static_cast<int>(matches.size()))
         ? tab.findMatchIndex + 1
         : (matches.empty() ? 0 : 1);
-    const std::string counterText =
-        "(" + std::to_string(safeIndex) + "/" + std::to_string(matches.size()) + ")";
+    const std::string counterText = tab.find.HasError()
+        ? fst::i18n("find.invalid_regex")
+        : "(" + std::to_string(safeIndex) + "/" + std::to_string(matches.size()) + ")";
 
     if (fst::Font* font = ctx.font()) {
         const fst::Vec2 counterSize = font->measureText(counterText);
         const fst::Vec2 counterPos(
             prevX + buttonWidth + gap,
-            barRect.y() + (barRect.height() - counterSize.y) * 0.5f);
+            barRect.y() + padding + (controlHeight - counterSize.y) * 0.5f);
         dl.addText(font, counterPos, counterText, theme.colors.text);
     }
 
+    fst::TextInputOptions replaceOptions;
+    replaceOptions.style = fst::Style()
+                               .withPos(barRect.x() + padding, replaceRowY)
+                               .withSize(inputWidth, controlHeight);
+    (void)fst::TextInput(ctx, "editor_replace_input_" + tab.id, tab.replaceText, replaceOptions);
+
+    fst::ButtonOptions replaceButtonOptions;
+    replaceButtonOptions.style = fst::Style().withPos(nextX, replaceRowY).withSize(buttonWidth, controlHeight);
+    if (fst::Button(ctx, fst::i18n("find.replace"), replaceButtonOptions)) {
+        requestReplace = true;
+    }
+    fst::ButtonOptions replaceAllOptions;
+    replaceAllOptions.style = fst::Style().withPos(prevX, replaceRowY).withSize(buttonWidth, controlHeight);
+    if (fst::Button(ctx, fst::i18n("find.replace_all"), replaceAllOptions)) {
+        requestReplaceAll = true;
+    }
+
     const fst::WidgetState inputState = fst::getWidgetState(ctx, ctx.makeId(inputId));
     const fst::InputState& input = ctx.input();
     if (inputState.focused && (input.isKeyPressed(fst::Key::Enter) || input.isKeyPressed(fst::Key::KPEnter))) {
@@ -518,6 +418,7 @@ void RenderEditorPanel(
     const std::string& completionOwnerDocumentPath,
     bool lspActive,
     LSPClient& lsp,
+    BackgroundLexer& backgroundLexer,
     const ClampActiveTabFn& clampActiveTab,
     const CloseTabFn& closeTab,
     const CloseCompletionPopupFn& closeCompletionPopup) {
@@ -565,11 +466,20 @@ void RenderEditorPanel(
         bool requestNextMatch = false;
         bool requestPreviousMatch = false;
         bool findQueryChanged = false;
+        bool requestReplace = false;
+        bool requestReplaceAll = false;
 
         if (activeDoc.findVisible) {
-            const float findBarHeight = 38.0f;
+            const float findBarHeight = 70.0f;
             const fst::Rect findBarRect(editorArea.x(), editorArea.y(), editorArea.width(), findBarHeight);
-            findQueryChanged = RenderFindBar(ctx, activeDoc, findBarRect, requestNextMatch, requestPreviousMatch);
+            findQueryChanged = RenderFindBar(
+                ctx,
+                activeDoc,
+                findBarRect,
+                requestNextMatch,
+                requestPreviousMatch,
+                requestReplace,
+                requestReplaceAll);
             editorArea = fst::Rect(
                 editorArea.x(),
                 editorArea.y() + findBarHeight,
@@ -577,8 +487,7 @@ void RenderEditorPanel(
                 std::max(0.0f, editorArea.height() - findBarHeight));
         }
 
-        const std::string textBeforeRender = activeDoc.editor.getText();
-        const std::vector<size_t> findMatches = FindAllMatches(textBeforeRender, activeDoc.findQuery);
+        const std::vector<FindMatch>& findMatches = activeDoc.find.Matches(activeDoc.document, activeDoc.findQuery, activeDoc.findOptions);
         if (!activeDoc.findVisible || activeDoc.findQuery.empty()) {
             activeDoc.findMatchIndex = -1;
         } else {
@@ -591,8 +500,12 @@ void RenderEditorPanel(
                 activeDoc.findMatchIndex = -1;
             } else {
                 if (activeDoc.findMatchIndex < 0 || activeDoc.findMatchIndex >= static_cast<int>(findMatches.size())) {
-                    const size_t cursorOffset = offsetFromPosition(textBeforeRender, activeDoc.editor.cursor());
-                    const auto it = std::lower_bound(findMatches.begin(), findMatches.end(), cursorOffset);
+                    const size_t cursorOffset = offsetFromPosition(activeDoc.document, activeDoc.editor.cursor());
+                    const auto it = std::lower_bound(
+                        findMatches.begin(),
+                        findMatches.end(),
+                        cursorOffset,
+                        [](const FindMatch& match, size_t offset) { return match.start < offset; });
                     activeDoc.findMatchIndex = (it == findMatches.end())
                         ? 0
                         : static_cast<int>(std::distance(findMatches.begin(), it));
@@ -612,7 +525,27 @@ void RenderEditorPanel(
 
                 if (jumpToMatch) {
                     activeDoc.editor.setCursor(
-                        positionFromOffset(textBeforeRender, findMatches[static_cast<size_t>(activeDoc.findMatchIndex)]));
+                        positionFromOffset(activeDoc.document, findMatches[static_cast<size_t>(activeDoc.findMatchIndex)].start));
+                }
+
+                // Both kinds of replace are a single document edit, so they reach the
+                // editor as one setText and clangd as one incremental change. Clearing
+                // the index makes the next frame pick the first match after the caret.
+                if (requestReplace) {
+                    const FindMatch match = findMatches[static_cast<size_t>(activeDoc.findMatchIndex)];
+                    const std::string replacement =
+                        activeDoc.find.ExpandReplacement(activeDoc.document.Text(), match, activeDoc.replaceText);
+                    EditDocument(activeDoc, match.start, match.end - match.start, replacement);
+                    PushDocumentToEditor(activeDoc, positionFromOffset(activeDoc.document, match.start + replacement.size()));
+                    activeDoc.findMatchIndex = -1;
+                } else if (requestReplaceAll) {
+                    const TextChange change = activeDoc.find.ReplaceAll(activeDoc.document, activeDoc.replaceText);
+                    if (!change.removedText.empty() || !change.insertedText.empty()) {
+                        const fst::TextPosition cursor = activeDoc.editor.cursor();
+                        EditDocument(activeDoc, change.offset, change.removedText.size(), change.insertedText);
+                        PushDocumentToEditor(activeDoc, cursor);
+                        activeDoc.findMatchIndex = -1;
+                    }
                 }
             }
         }
@@ -660,7 +593,12 @@ void RenderEditorPanel(
             activeDoc.editor.render(ctx, layout.textArea, editorOptions);
         }
 
-        std::string currentText = activeDoc.editor.getText();
+        SyncDocumentFromEditor(ctx, activeDoc);
+        const std::string& activePathOrName = activeDoc.path.empty() ? activeDoc.name : activeDoc.path;
+        const bool activeCppLike = isCppLikePath(activePathOrName);
+        if (activeCppLike) {
+            activeDoc.highlight.Schedule(backgroundLexer, activeDoc.document);
+        }
         if (layout.showMinimap) {
             const std::string minimapWidgetKey = "editor_minimap_" + activeDoc.id;
             const fst::WidgetInteraction minimapInteraction = fst::handleWidgetInteraction(
@@ -668,13 +606,14 @@ void RenderEditorPanel(
                 ctx.makeId(minimapWidgetKey),
                 layout.minimapArea,
                 true);
-            const std::string minimapPathOrName = activeDoc.path.empty() ? activeDoc.name : activeDoc.path;
-            const bool minimapCppLike = isCppLikePath(minimapPathOrName);
+            const std::shared_ptr<const LexedText> lexed = activeDoc.highlight.Lexed();
             const MinimapRenderInfo minimapInfo = RenderEditorMinimap(
                 ctx,
                 layout.minimapArea,
-                currentText,
-                minimapCppLike,
+                activeDoc.minimap,
+                activeDoc.document,
+                activeCppLike,
+                lexed.get(),
                 activeDoc.editor.firstVisibleLine(),
                 activeDoc.editor.visibleLineCount(),
                 activeDoc.editor.cursor().line,
@@ -682,18 +621,21 @@ void RenderEditorPanel(
                 minimapInteraction.dragging);
             HandleMinimapNavigation(ctx, minimapInteraction, minimapInfo, activeDoc.editor);
         }
-        activeDoc.dirty = (currentText != activeDoc.savedText);
+        UpdateDirtyState(activeDoc);
 
         if (lspActive && !activeDoc.lspDocumentPath.empty()) {
             if (!activeDoc.lspOpened) {
-                lsp.DidOpen(activeDoc.lspDocumentPath, currentText);
+                lsp.DidOpen(activeDoc.lspDocumentPath, activeDoc.document.Text());
                 activeDoc.lspOpened = true;
-                activeDoc.lspTextSnapshot = currentText;
-            } else if (currentText != activeDoc.lspTextSnapshot) {
-                lsp.DidChange(activeDoc.lspDocumentPath, currentText);
-                activeDoc.lspTextSnapshot = currentText;
+            } else if (!activeDoc.pendingChanges.empty()) {
+                if (lsp.SupportsIncrementalSync()) {
+                    lsp.DidChange(activeDoc.lspDocumentPath, activeDoc.pendingChanges);
+                } else {
+                    lsp.DidChange(activeDoc.lspDocumentPath, activeDoc.document.Text());
+                }
             }
         }
+        activeDoc.pendingChanges.clear();
     }
 
     if (closeRequested >= 0) {
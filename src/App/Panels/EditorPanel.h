@@ -1,6 +1,7 @@
 #pragma once
 
 #include "App/FinTypes.h"
+#include "Core/BackgroundLexer.h"
 #include "Core/LSPClient.h"
 #include "fastener/fastener.h"
 
@@ -27,6 +28,7 @@ void RenderEditorPanel(
     const std::string& completionOwnerDocumentPath,
     bool lspActive,
     LSPClient& lsp,
+    BackgroundLexer& backgroundLexer,
     const ClampActiveTabFn& clampActiveTab,
     const CloseTabFn& closeTab,
     const CloseCompletionPopupFn& closeCompletionPopup);
@@ -112,10 +112,7 @@ void RenderLspDiagnosticsPanel(
 
             bool selected = false;
             if (fst::Selectable(ctx, clickableLine, selected)) {
-                fst::TextPosition pos;
-                pos.line = std::max(0, diag.line);
-                pos.column = std::max(0, diag.range_start);
-                tab.editor.setCursor(pos);
+                tab.editor.setCursor(positionFromLspCharacter(tab.document, diag.line, diag.range_start));
             }
         }
         fst::EndHorizontal(ctx);
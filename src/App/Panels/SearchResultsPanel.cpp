@@ -0,0 +1,172 @@
+#include "App/Panels/SearchResultsPanel.h"
+
+#include "App/FinHelpers.h"
+#include "fastener/fastener.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace fin {
+
+namespace {
+
+// Rows drawn per frame; the rest of a huge result set is only counted.
+constexpr size_t kMaxShownHits = 2000;
+
+// Purely lexical: this runs for every listed file on every frame.
+std::string DisplayPath(const std::filesystem::path& root, const std::string& path) {
+    const std::filesystem::path relative = std::filesystem::u8path(path).lexically_relative(root);
+    return relative.empty() ? path : relative.u8string();
+}
+
+} // namespace
+
+void RenderSearchResultsPanel(
+    fst::Context& ctx,
+    WorkspaceSearch& search,
+    TrigramIndex* workspaceIndex,
+    SearchResultsState& state,
+    const std::filesystem::path& currentPath,
+    std::vector<std::unique_ptr<DocumentTab>>& docs,
+    int& activeTab,
+    const OpenDocumentFn& openDocument,
+    const ClampActiveTabFn& clampActiveTab) {
+    // Results stream in while the search runs, also while another tab of the dock is shown.
+    const size_t takenFrom = state.files.size();
+    if (search.TakeResults(state.files)) {
+        for (size_t i = takenFrom; i < state.files.size(); ++i) {
+            state.hitCount += state.files[i].hits.size();
+        }
+    }
+
+    if (!fst::BeginDockableWindow(ctx, fst::i18n("window.search_results"))) {
+        return;
+    }
+
+    const fst::Rect bounds = ctx.layout().currentBounds();
+    beginScrollablePanelContent(ctx, "search_results_scroll", bounds);
+    const fst::Theme& theme = ctx.theme();
+
+    const std::string inputId = "search_results_query";
+    if (state.focusPending) {
+        ctx.setFocusedWidget(ctx.makeId(inputId));
+        state.focusPending = false;
+    }
+
+    bool startSearch = false;
+    const bool running = search.IsRunning();
+    fst::BeginHorizontal(ctx, 8.0f);
+    {
+        fst::TextInputOptions inputOptions;
+        inputOptions.style = fst::Style().withWidth(std::max(120.0f, bounds.width() - 140.0f));
+        (void)fst::TextInput(ctx, inputId, state.query, inputOptions);
+
+        if (running) {
+            if (fst::Button(ctx, fst::i18n("search.cancel"))) {
+                search.Cancel();
+            }
+        } else if (fst::Button(ctx, fst::i18n("search.start"))) {
+            startSearch = true;
+        }
+    }
+    fst::EndHorizontal(ctx);
+
+    fst::BeginHorizontal(ctx, 14.0f);
+    {
+        (void)fst::Checkbox(ctx, fst::i18n("search.match_case"), state.options.caseSensitive);
+        (void)fst::Checkbox(ctx, fst::i18n("search.whole_word"), state.options.wholeWord);
+        (void)fst::Checkbox(ctx, fst::i18n("search.regex"), state.options.regex);
+    }
+    fst::EndHorizontal(ctx);
+
+    const fst::WidgetState inputState = fst::getWidgetState(ctx, ctx.makeId(inputId));
+    const fst::InputState& input = ctx.input();
+    if (inputState.focused && (input.isKeyPressed(fst::Key::Enter) || input.isKeyPressed(fst::Key::KPEnter))) {
+        startSearch = true;
+    }
+    if (startSearch && !state.query.empty()) {
+        state.root = currentPath;
+        state.files.clear();
+        state.hitCount = 0;
+        std::shared_ptr<const TrigramFilter> filter;
+        if (workspaceIndex != nullptr) {
+            // The index stays on the workspace it was opened for; folders outside it,
+            // and every folder until it is ready, are searched without a filter.
+            filter = workspaceIndex->Filter(state.root, state.query, state.options);
+        }
+        search.Start(state.root, state.query, state.options, std::move(filter));
+    }
+
+    fst::LabelOptions folderOpt;
+    folderOpt.color = theme.colors.textSecondary;
+    fst::Label(ctx, fst::i18n("search.folder", {(state.root.empty() ? currentPath : state.root).u8string()}), folderOpt);
+
+    const std::string hits = std::to_string(state.hitCount);
+    const std::string fileCount = std::to_string(state.files.size());
+    if (search.IsRunning()) {
+        fst::LabelSecondary(ctx, fst::i18n("search.running", {std::to_string(search.FilesSearched()), hits}));
+    } else if (search.Truncated()) {
+        fst::LabelSecondary(ctx, fst::i18n("search.truncated", {hits, fileCount}));
+    } else if (!state.root.empty()) {
+        fst::LabelSecondary(ctx, fst::i18n("search.summary", {hits, fileCount}));
+    }
+    if (search.LongLinesSkipped() > 0) {
+        fst::LabelSecondary(
+            ctx,
+            fst::i18n(
+                "search.long_lines_skipped",
+                {std::to_string(search.LongLinesSkipped()), std::to_string(WorkspaceSearch::kMaxRegexLineBytes / 1024)}));
+    }
+    if (search.FilesSkippedByIndex() > 0) {
+        fst::LabelSecondary(ctx, fst::i18n("search.index_skipped", {std::to_string(search.FilesSkippedByIndex())}));
+    } else if (workspaceIndex != nullptr && !workspaceIndex->IsReady()) {
+        fst::LabelSecondary(ctx, fst::i18n("search.index_building"));
+    }
+    fst::Separator(ctx);
+
+    if (state.files.empty()) {
+        if (!state.root.empty() && !search.IsRunning()) {
+            fst::LabelSecondary(ctx, fst::i18n("search.no_results"));
+        }
+        endScrollablePanelContent(ctx, "search_results_scroll", bounds);
+        fst::EndDockableWindow(ctx);
+        return;
+    }
+
+    size_t shown = 0;
+    for (const WorkspaceSearchFile& file : state.files) {
+        if (shown >= kMaxShownHits) {
+            break;
+        }
+        fst::LabelOptions fileOpt;
+        fileOpt.color = theme.colors.primary;
+        fst::Label(ctx, DisplayPath(state.root, file.path) + "  (" + std::to_string(file.hits.size()) + ")", fileOpt);
+
+        for (const WorkspaceSearchHit& hit : file.hits) {
+            if (shown >= kMaxShownHits) {
+                break;
+            }
+            ++shown;
+            const std::string row = "  " + std::to_string(hit.line + 1) + ":" + std::to_string(hit.column + 1) +
+                                    "  " + hit.preview;
+            bool selected = false;
+            if (fst::Selectable(ctx, row, selected) && openDocument(file.path)) {
+                clampActiveTab();
+                if (activeTab >= 0) {
+                    fst::TextPosition pos;
+                    pos.line = static_cast<int>(hit.line);
+                    pos.column = static_cast<int>(hit.column);
+                    docs[activeTab]->editor.setCursor(pos);
+                }
+            }
+        }
+    }
+    if (shown < state.hitCount) {
+        fst::LabelSecondary(ctx, fst::i18n("search.more_hidden", {std::to_string(state.hitCount - shown)}));
+    }
+
+    endScrollablePanelContent(ctx, "search_results_scroll", bounds);
+    fst::EndDockableWindow(ctx);
+}
+
+} // namespace fin
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "App/FinTypes.h"
+#include "Core/TrigramIndex.h"
+#include "Core/WorkspaceSearch.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fst {
+class Context;
+}
+
+namespace fin {
+
+using ClampActiveTabFn = std::function<void()>;
+using OpenDocumentFn = std::function<bool(const std::string&)>;
+
+struct SearchResultsState {
+    std::string query;
+    FindOptions options;
+    std::filesystem::path root; // folder of the last search
+    std::vector<WorkspaceSearchFile> files;
+    size_t hitCount = 0;
+    bool focusPending = false;
+};
+
+void RenderSearchResultsPanel(
+    fst::Context& ctx,
+    WorkspaceSearch& search,
+    TrigramIndex* workspaceIndex, // null when the index is disabled
+    SearchResultsState& state,
+    const std::filesystem::path& currentPath,
+    std::vector<std::unique_ptr<DocumentTab>>& docs,
+    int& activeTab,
+    const OpenDocumentFn& openDocument,
+    const ClampActiveTabFn& clampActiveTab);
+
+} // namespace fin
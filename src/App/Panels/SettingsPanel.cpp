@@ -44,6 +44,8 @@ void RenderSettingsPanel(
     (void)fst::Checkbox(ctx, fst::i18n("settings.auto_brackets"), config.autoClosingBrackets);
     (void)fst::Checkbox(ctx, fst::i18n("settings.smart_indent"), config.smartIndentEnabled);
     (void)fst::Checkbox(ctx, fst::i18n("settings.minimap"), config.minimapEnabled);
+    (void)fst::Checkbox(ctx, fst::i18n("settings.workspace_index"), config.workspaceIndexEnabled);
+    (void)fst::Checkbox(ctx, fst::i18n("settings.symbol_index"), config.symbolIndexEnabled);
 
     std::vector<std::string> themeNames = {
         fst::i18n("theme.dark"),
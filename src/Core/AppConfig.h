@@ -18,5 +18,8 @@ struct AppConfig {
     bool autoClosingBrackets = true;
     bool smartIndentEnabled = true;
     bool minimapEnabled = true;
+    bool workspaceIndexEnabled = false; // trigram index for Find in Files
+    bool symbolIndexEnabled = true;     // workspace symbols for local completion
+    int lspChangeDelayMs = 100; // didChange coalescing window
     bool showSettingsWindow = false;
 };
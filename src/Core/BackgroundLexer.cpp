@@ -0,0 +1,117 @@
+#include "BackgroundLexer.h"
+#include "CharScan.h"
+#include <string_view>
+
+namespace {
+
+// How often (in lines) a running job checks whether a newer version arrived.
+constexpr size_t kSupersedeCheckLines = 4096;
+
+} // namespace
+
+std::shared_ptr<const LexedText> LexedTextSlot::Latest() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latest;
+}
+
+BackgroundLexer::BackgroundLexer() {
+    m_thread = std::thread(&BackgroundLexer::WorkLoop, this);
+}
+
+BackgroundLexer::~BackgroundLexer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void BackgroundLexer::Submit(
+    const std::shared_ptr<LexedTextSlot>& slot,
+    uint64_t version,
+    std::shared_ptr<const std::string> text) {
+    if (!slot || !text) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool replaced = false;
+        for (Job& job : m_jobs) {
+            if (job.slot.lock() == slot) {
+                job.version = version;
+                job.text = std::move(text);
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            m_jobs.push_back(Job{slot, version, std::move(text)});
+        }
+    }
+    m_cv.notify_one();
+}
+
+bool BackgroundLexer::IsSuperseded(const LexedTextSlot* slot, uint64_t version) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop) return true;
+    for (const Job& job : m_jobs) {
+        if (job.version != version && job.slot.lock().get() == slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BackgroundLexer::WorkLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        std::shared_ptr<const LexedText> result = Lex(job);
+        if (!result) continue;
+
+        if (std::shared_ptr<LexedTextSlot> slot = job.slot.lock()) {
+            std::lock_guard<std::mutex> lock(slot->m_mutex);
+            if (!slot->m_latest || slot->m_latest->version < result->version) {
+                slot->m_latest = std::move(result);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const LexedText> BackgroundLexer::Lex(const Job& job) {
+    const std::string_view text(*job.text);
+    std::vector<LineSpan> lines;
+    CollectLines(text, lines);
+
+    auto result = std::make_shared<LexedText>();
+    result->version = job.version;
+    result->lineFirstToken.reserve(lines.size() + 1);
+    result->lineEndStates.reserve(lines.size());
+    result->tokens.reserve(text.size() / 4);
+
+    const std::shared_ptr<LexedTextSlot> slot = job.slot.lock();
+    if (!slot) return nullptr;
+    CppLexState state;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0 && i % kSupersedeCheckLines == 0 && IsSuperseded(slot.get(), job.version)) {
+            return nullptr;
+        }
+        std::string_view line = text.substr(lines[i].start, lines[i].end - lines[i].start);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        result->lineFirstToken.push_back(static_cast<uint32_t>(result->tokens.size()));
+        LexCppLine(line, state, result->tokens);
+        result->lineEndStates.push_back(state);
+    }
+    result->lineFirstToken.push_back(static_cast<uint32_t>(result->tokens.size()));
+    return result;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "CppLexer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tokens of a whole document as of one edit version.
+struct LexedText {
+    uint64_t version = 0;
+    std::vector<CppToken> tokens;            // all lines, in line order
+    std::vector<uint32_t> lineFirstToken;    // tokens of line i: [lineFirstToken[i], lineFirstToken[i + 1])
+    std::vector<CppLexState> lineEndStates;  // state after each line
+
+    size_t LineCount() const { return lineEndStates.size(); }
+};
+
+// Where the worker publishes results for one document. The UI keeps the slot and
+// reads whatever version is latest; the worker only holds it weakly, so closing a
+// document drops its queued work.
+class LexedTextSlot {
+public:
+    std::shared_ptr<const LexedText> Latest() const;
+
+private:
+    friend class BackgroundLexer;
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const LexedText> m_latest;
+};
+
+// One worker thread that lexes whole documents off the UI thread. Submitting a
+// newer version for a slot replaces its queued job and abandons one in progress.
+class BackgroundLexer {
+public:
+    BackgroundLexer();
+    ~BackgroundLexer();
+
+    BackgroundLexer(const BackgroundLexer&) = delete;
+    BackgroundLexer& operator=(const BackgroundLexer&) = delete;
+
+    void Submit(const std::shared_ptr<LexedTextSlot>& slot, uint64_t version, std::shared_ptr<const std::string> text);
+
+private:
+    struct Job {
+        std::weak_ptr<LexedTextSlot> slot;
+        uint64_t version = 0;
+        std::shared_ptr<const std::string> text;
+    };
+
+    void WorkLoop();
+    bool IsSuperseded(const LexedTextSlot* slot, uint64_t version);
+    std::shared_ptr<const LexedText> Lex(const Job& job);
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,478 @@
+#include "CharScan.h"
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FIN_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FIN_SCAN_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(FIN_SCAN_AVX2) || defined(FIN_SCAN_SSE2)
+
+unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// One vector of bytes; the same scanners below are written once against it.
+#if defined(FIN_SCAN_AVX2)
+using Vec = __m256i;
+constexpr size_t kBlock = 32;
+constexpr uint32_t kFullMask = 0xffffffffu;
+inline Vec Load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Vec Splat(char ch) { return _mm256_set1_epi8(ch); }
+inline Vec Equal(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+inline void Store(char* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+inline Vec And(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm256_sub_epi8(a, b); }
+inline Vec MinUnsigned(Vec a, Vec b) { return _mm256_min_epu8(a, b); }
+inline uint32_t MoveMask(Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#else
+using Vec = __m128i;
+constexpr size_t kBlock = 16;
+constexpr uint32_t kFullMask = 0xffffu;
+inline Vec Load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Vec Splat(char ch) { return _mm_set1_epi8(ch); }
+inline Vec Equal(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+inline void Store(char* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+inline Vec And(Vec a, Vec b) { return _mm_and_si128(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm_sub_epi8(a, b); }
+inline Vec MinUnsigned(Vec a, Vec b) { return _mm_min_epu8(a, b); }
+inline uint32_t MoveMask(Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#endif
+
+// 0xff where lo <= byte <= lo + span (unsigned wrap-around makes it one compare).
+inline Vec InRange(Vec v, char lo, char span) {
+    const Vec shifted = Sub(v, Splat(lo));
+    return Equal(MinUnsigned(shifted, Splat(span)), shifted);
+}
+
+inline uint32_t IdentifierMask(Vec v) {
+    const Vec letter = InRange(Or(v, Splat(0x20)), 'a', 'z' - 'a');
+    const Vec digit = InRange(v, '0', 9);
+    return MoveMask(Or(Or(letter, digit), Equal(v, Splat('_'))));
+}
+
+inline uint32_t BlankMask(const char* p) {
+    const Vec v = Load(p);
+    return MoveMask(Or(Equal(v, Splat(' ')), Equal(v, Splat('\t'))));
+}
+
+#define FIN_SCAN_SIMD 1
+
+#endif
+
+constexpr size_t kChunk = 64;
+
+uint64_t ValidMask(size_t count) {
+    return count >= kChunk ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+unsigned CountTrailingZeros64(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned long index = 0;
+    if (_BitScanForward(&index, static_cast<uint32_t>(mask))) return static_cast<unsigned>(index);
+    _BitScanForward(&index, static_cast<uint32_t>(mask >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+size_t PopCount64(uint64_t mask) {
+    return std::bitset<64>(mask).count();
+}
+
+#if defined(FIN_SCAN_SIMD)
+
+// Texts up to this long are matched with a fixed number of blocks.
+constexpr size_t kShortWindow = 32;
+
+// The `count` (< 16) bytes at `p` in the low bytes of a 16-byte value, zeros above.
+// Built from overlapping loads that stay within the bytes, in registers: copying them
+// to a padded buffer and loading that stalls on store forwarding for every candidate.
+inline __m128i LoadPartial16(const char* p, size_t count) {
+    uint64_t low = 0;
+    uint64_t high = 0;
+    if (count >= 8) {
+        std::memcpy(&low, p, 8);
+        uint64_t last = 0;
+        std::memcpy(&last, p + count - 8, 8);
+        high = count > 8 ? last >> ((16 - count) * 8) : 0;
+    } else if (count >= 4) {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        std::memcpy(&first, p, 4);
+        std::memcpy(&last, p + count - 4, 4);
+        low = first | (static_cast<uint64_t>(last) << ((count - 4) * 8));
+    } else if (count > 0) {
+        const auto byte = [p](size_t i) { return static_cast<uint64_t>(static_cast<unsigned char>(p[i])); };
+        low = byte(0) | (byte(count / 2) << (count / 2 * 8)) | (byte(count - 1) << ((count - 1) * 8));
+    }
+    return _mm_set_epi64x(static_cast<long long>(high), static_cast<long long>(low));
+}
+
+// Block `start` of the `size` bytes at `text`, zeros past the end.
+inline Vec LoadBlock(const char* text, size_t size, size_t start) {
+    if (start + kBlock <= size) {
+        return Load(text + start);
+    }
+    const size_t count = start < size ? size - start : 0;
+#if defined(FIN_SCAN_AVX2)
+    const __m128i low = count >= 16 ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + start))
+                                    : LoadPartial16(text + start, count);
+    const __m128i high = count > 16 ? LoadPartial16(text + start + 16, count - 16) : _mm_setzero_si128();
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+#else
+    return LoadPartial16(text + start, count);
+#endif
+}
+
+inline Vec FoldCase(Vec v) {
+    return Or(v, And(InRange(Or(v, Splat(0x20)), 'a', 'z' - 'a'), Splat(0x20)));
+}
+
+// Whether the query bytes (one splatted vector each) occur in order within the first
+// `size` bytes at `text`, ignoring ASCII case; `blocks` covers at least `size` bytes.
+// Every query byte is compared, without an early exit: once one misses, `from` stays
+// 0. A fixed amount of work per text keeps the branches predictable, which matters
+// more than the compares saved.
+inline bool IsFoldedSubsequence(
+    const char* text,
+    size_t size,
+    size_t blocks,
+    const Vec* needles,
+    size_t count) {
+    Vec folded[kChunk / kBlock];
+    for (size_t b = 0; b < blocks; ++b) {
+        folded[b] = FoldCase(LoadBlock(text, size, b * kBlock));
+    }
+    const uint64_t valid = ValidMask(size);
+    uint64_t from = valid; // positions the next query byte may take
+    uint64_t mask = valid;
+    for (size_t j = 0; j < count; ++j) {
+        mask = 0;
+        for (size_t b = 0; b < blocks; ++b) {
+            mask |= static_cast<uint64_t>(MoveMask(Equal(folded[b], needles[j]))) << (b * kBlock);
+        }
+        mask &= from;
+        const uint64_t lowest = mask & (~mask + 1);
+        from = ~((lowest << 1) - 1) & valid; // above the lowest match; 0 without one
+    }
+    return mask != 0;
+}
+
+#endif
+
+// Bit i set when byte i of the 64-byte chunk at `p` matches.
+uint64_t IdentifierMask64(const char* p) {
+    uint64_t mask = 0;
+#if defined(FIN_SCAN_SIMD)
+    for (size_t k = 0; k < kChunk; k += kBlock) {
+        mask |= static_cast<uint64_t>(IdentifierMask(Load(p + k))) << k;
+    }
+#else
+    for (size_t k = 0; k < kChunk; ++k) {
+        mask |= static_cast<uint64_t>(IsIdentifierByte(p[k])) << k;
+    }
+#endif
+    return mask;
+}
+
+uint64_t EqualMask64(const char* p, char ch) {
+    uint64_t mask = 0;
+#if defined(FIN_SCAN_SIMD)
+    const Vec needle = Splat(ch);
+    for (size_t k = 0; k < kChunk; k += kBlock) {
+        mask |= static_cast<uint64_t>(MoveMask(Equal(Load(p + k), needle))) << k;
+    }
+#else
+    for (size_t k = 0; k < kChunk; ++k) {
+        mask |= static_cast<uint64_t>(p[k] == ch) << k;
+    }
+#endif
+    return mask;
+}
+
+// Calls fn(chunkPointer, chunkOffset, validMask) for each 64-byte chunk; the last
+// partial chunk is copied into a zero-padded buffer so the same mask code applies.
+template <typename Fn>
+void ForEachChunk(std::string_view text, Fn&& fn) {
+    size_t offset = 0;
+    for (; offset + kChunk <= text.size(); offset += kChunk) {
+        fn(text.data() + offset, offset, ~uint64_t(0));
+    }
+    if (offset < text.size()) {
+        char tail[kChunk] = {};
+        std::memcpy(tail, text.data() + offset, text.size() - offset);
+        fn(tail, offset, ValidMask(text.size() - offset));
+    }
+}
+
+// Scans blocks while `blockMask` (bit set = byte ends the run) is zero, then
+// finishes with `isStop` on the tail.
+template <typename BlockMask, typename IsStop>
+size_t ScanUntil(std::string_view text, size_t from, BlockMask&& blockMask, IsStop&& isStop) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t i = from;
+#if defined(FIN_SCAN_SIMD)
+    for (; i + kBlock <= size; i += kBlock) {
+        const uint32_t mask = blockMask(data + i);
+        if (mask != 0) {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+#else
+    (void)blockMask;
+#endif
+    for (; i < size; ++i) {
+        if (isStop(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+} // namespace
+
+size_t SkipIdentifierBytes(std::string_view text, size_t from) {
+    return ScanUntil(
+        text, from,
+        [](const char* p) {
+#if defined(FIN_SCAN_SIMD)
+            return ~IdentifierMask(Load(p)) & kFullMask;
+#else
+            (void)p;
+            return 0u;
+#endif
+        },
+        [](char ch) { return !IsIdentifierByte(ch); });
+}
+
+size_t SkipNonIdentifierBytes(std::string_view text, size_t from) {
+    return ScanUntil(
+        text, from,
+        [](const char* p) {
+#if defined(FIN_SCAN_SIMD)
+            return IdentifierMask(Load(p));
+#else
+            (void)p;
+            return 0u;
+#endif
+        },
+        [](char ch) { return IsIdentifierByte(ch); });
+}
+
+size_t SkipBlanks(std::string_view text, size_t from) {
+    return ScanUntil(
+        text, from,
+        [](const char* p) {
+#if defined(FIN_SCAN_SIMD)
+            return ~BlankMask(p) & kFullMask;
+#else
+            (void)p;
+            return 0u;
+#endif
+        },
+        [](char ch) { return !IsBlankByte(ch); });
+}
+
+size_t FindByteOf(std::string_view text, size_t from, char a, char b) {
+    return ScanUntil(
+        text, from,
+        [a, b](const char* p) {
+#if defined(FIN_SCAN_SIMD)
+            const Vec v = Load(p);
+            return MoveMask(Or(Equal(v, Splat(a)), Equal(v, Splat(b))));
+#else
+            (void)p;
+            return 0u;
+#endif
+        },
+        [a, b](char ch) { return ch == a || ch == b; });
+}
+
+size_t FindByteOf(std::string_view text, size_t from, char a, char b, char c) {
+    return ScanUntil(
+        text, from,
+        [a, b, c](const char* p) {
+#if defined(FIN_SCAN_SIMD)
+            const Vec v = Load(p);
+            return MoveMask(Or(Or(Equal(v, Splat(a)), Equal(v, Splat(b))), Equal(v, Splat(c))));
+#else
+            (void)p;
+            return 0u;
+#endif
+        },
+        [a, b, c](char ch) { return ch == a || ch == b || ch == c; });
+}
+
+void CollectIdentifierRuns(std::string_view text, size_t minLength, std::vector<ByteRun>& runs) {
+    bool open = false;
+    size_t openStart = 0;
+    uint64_t previousLast = 0; // was the byte before this chunk part of an identifier
+
+    const auto emit = [&](size_t start, size_t end) {
+        if (end - start >= minLength) {
+            runs.push_back({start, end});
+        }
+    };
+
+    ForEachChunk(text, [&](const char* chunk, size_t offset, uint64_t valid) {
+        const uint64_t mask = IdentifierMask64(chunk) & valid;
+        const uint64_t shifted = (mask << 1) | previousLast;
+        uint64_t starts = mask & ~shifted;
+        uint64_t ends = ~mask & shifted;
+        // Starts and ends alternate, so pair each start with the next end.
+        if (open && ends != 0) {
+            emit(openStart, offset + CountTrailingZeros64(ends));
+            ends &= ends - 1;
+            open = false;
+        }
+        while (starts != 0) {
+            const size_t start = offset + CountTrailingZeros64(starts);
+            starts &= starts - 1;
+            if (ends == 0) {
+                open = true;
+                openStart = start;
+                break;
+            }
+            emit(start, offset + CountTrailingZeros64(ends));
+            ends &= ends - 1;
+        }
+        previousLast = mask >> 63;
+    });
+    if (open) {
+        emit(openStart, text.size());
+    }
+}
+
+void CollectLines(std::string_view text, std::vector<LineSpan>& lines) {
+    size_t lineStart = 0;
+    size_t tabs = 0;
+    ForEachChunk(text, [&](const char* chunk, size_t offset, uint64_t valid) {
+        uint64_t newlines = EqualMask64(chunk, '\n') & valid;
+        uint64_t tabMask = EqualMask64(chunk, '\t') & valid;
+        while (newlines != 0) {
+            const unsigned bit = CountTrailingZeros64(newlines);
+            const uint64_t before = (uint64_t(1) << bit) - 1;
+            tabs += PopCount64(tabMask & before);
+            lines.push_back({lineStart, offset + bit, tabs});
+            lineStart = offset + bit + 1;
+            tabs = 0;
+            tabMask &= ~before & ~(uint64_t(1) << bit);
+            newlines &= newlines - 1;
+        }
+        tabs += PopCount64(tabMask);
+    });
+    lines.push_back({lineStart, text.size(), tabs});
+}
+
+void FilterFoldedSubsequences(
+    const std::vector<std::string_view>& texts,
+    std::string_view foldedQuery,
+    std::vector<uint32_t>& out) {
+    const size_t queryLength = foldedQuery.size();
+    if (queryLength > ShortStringMasks::kMaxBytes) {
+        return;
+    }
+#if defined(FIN_SCAN_SIMD)
+    Vec needles[ShortStringMasks::kMaxBytes];
+    for (size_t j = 0; j < queryLength; ++j) {
+        needles[j] = Splat(foldedQuery[j]);
+    }
+#endif
+    for (size_t index = 0; index < texts.size(); ++index) {
+        const std::string_view text = texts[index];
+        if (text.size() < queryLength) {
+            continue;
+        }
+#if defined(FIN_SCAN_SIMD)
+        const size_t size = std::min(text.size(), ShortStringMasks::kMaxBytes);
+        const bool matched = size <= kShortWindow
+            ? IsFoldedSubsequence(text.data(), size, kShortWindow / kBlock, needles, queryLength)
+            : IsFoldedSubsequence(text.data(), size, (size + kBlock - 1) / kBlock, needles, queryLength);
+        if (!matched) {
+            continue;
+        }
+#else
+        size_t j = 0;
+        for (size_t i = 0; i < text.size() && i < ShortStringMasks::kMaxBytes && j < queryLength; ++i) {
+            const char ch = text[i];
+            if (((ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch) == foldedQuery[j]) {
+                ++j;
+            }
+        }
+        if (j < queryLength) {
+            continue;
+        }
+#endif
+        out.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+ShortStringMasks::ShortStringMasks(std::string_view text)
+    : m_size(std::min(text.size(), kMaxBytes)) {
+    // Word starts come from the same loads as the folded copy; loading the text
+    // again later costs more than these few compares.
+    uint64_t identifier = 0;
+    uint64_t upper = 0;
+    uint64_t underscore = 0;
+#if defined(FIN_SCAN_SIMD)
+    for (size_t k = 0; k < m_size; k += kBlock) {
+        const Vec v = LoadBlock(text.data(), m_size, k);
+        Store(m_folded + k, FoldCase(v));
+        identifier |= static_cast<uint64_t>(IdentifierMask(v)) << k;
+        upper |= static_cast<uint64_t>(MoveMask(InRange(v, 'A', 'Z' - 'A'))) << k;
+        underscore |= static_cast<uint64_t>(MoveMask(Equal(v, Splat('_')))) << k;
+    }
+#else
+    for (size_t i = 0; i < m_size; ++i) {
+        const char ch = text[i];
+        m_folded[i] = (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+        identifier |= static_cast<uint64_t>(IsIdentifierByte(ch)) << i;
+        upper |= static_cast<uint64_t>(ch >= 'A' && ch <= 'Z') << i;
+        underscore |= static_cast<uint64_t>(ch == '_') << i;
+    }
+#endif
+    const uint64_t starts = identifier & (~(identifier << 1) | (underscore << 1) | (upper & ~(upper << 1)));
+    m_wordStarts = starts & ValidMask(m_size);
+}
+
+uint64_t ShortStringMasks::FoldedEqual(char folded) const {
+    uint64_t mask = 0;
+#if defined(FIN_SCAN_SIMD)
+    const Vec needle = Splat(folded);
+    for (size_t k = 0; k < m_size; k += kBlock) {
+        mask |= static_cast<uint64_t>(MoveMask(Equal(Load(m_folded + k), needle))) << k;
+    }
+#else
+    for (size_t i = 0; i < m_size; ++i) {
+        mask |= static_cast<uint64_t>(m_folded[i] == folded) << i;
+    }
+#endif
+    return mask & ValidMask(m_size);
+}
+
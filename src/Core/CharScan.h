@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Byte classification for source text. Unlike <cctype> it ignores the C locale, so
+// bytes >= 0x80 (UTF-8) never count as letters and the checks are table lookups.
+enum CharClass : uint8_t {
+    kCharAlpha = 1 << 0,      // A-Z a-z
+    kCharDigit = 1 << 1,      // 0-9
+    kCharHexDigit = 1 << 2,   // 0-9 A-F a-f
+    kCharIdentifier = 1 << 3, // alpha, digit, '_'
+    kCharBlank = 1 << 4       // ' ' '\t'
+};
+
+constexpr std::array<uint8_t, 256> MakeCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int ch = 0; ch < 256; ++ch) {
+        uint8_t flags = 0;
+        const bool alpha = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+        const bool digit = ch >= '0' && ch <= '9';
+        if (alpha) flags |= kCharAlpha;
+        if (digit) flags |= kCharDigit;
+        if (digit || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F')) flags |= kCharHexDigit;
+        if (alpha || digit || ch == '_') flags |= kCharIdentifier;
+        if (ch == ' ' || ch == '\t') flags |= kCharBlank;
+        table[static_cast<size_t>(ch)] = flags;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> kCharClassTable = MakeCharClassTable();
+
+inline bool HasCharClass(char ch, uint8_t flags) {
+    return (kCharClassTable[static_cast<unsigned char>(ch)] & flags) != 0;
+}
+inline bool IsAlphaByte(char ch) { return HasCharClass(ch, kCharAlpha); }
+inline bool IsDigitByte(char ch) { return HasCharClass(ch, kCharDigit); }
+inline bool IsHexDigitByte(char ch) { return HasCharClass(ch, kCharHexDigit); }
+inline bool IsIdentifierByte(char ch) { return HasCharClass(ch, kCharIdentifier); }
+inline bool IsIdentifierStartByte(char ch) { return ch == '_' || IsAlphaByte(ch); }
+inline bool IsBlankByte(char ch) { return HasCharClass(ch, kCharBlank); }
+
+// Run scanners, 16 (SSE2) or 32 (AVX2) bytes per step with a scalar tail; plain
+// scalar loops elsewhere. Each returns the first position >= `from` that ends the
+// run, or text.size().
+size_t SkipIdentifierBytes(std::string_view text, size_t from);
+size_t SkipNonIdentifierBytes(std::string_view text, size_t from);
+size_t SkipBlanks(std::string_view text, size_t from);
+
+// First position >= `from` holding one of the given bytes, or text.size().
+size_t FindByteOf(std::string_view text, size_t from, char a, char b);
+size_t FindByteOf(std::string_view text, size_t from, char a, char b, char c);
+
+// Whole-buffer passes: bytes are classified 64 at a time into bitmasks and runs are
+// read off the mask bits, so per-line/per-token cost is a few bit operations.
+struct ByteRun {
+    size_t start = 0;
+    size_t end = 0;
+};
+
+struct LineSpan {
+    size_t start = 0;
+    size_t end = 0;  // excludes the '\n'
+    size_t tabs = 0; // '\t' bytes in [start, end)
+};
+
+// Identifier runs of at least `minLength` bytes, appended to `runs` in order.
+void CollectIdentifierRuns(std::string_view text, size_t minLength, std::vector<ByteRun>& runs);
+
+// One LineSpan per '\n'-separated line (an empty text has one empty line).
+void CollectLines(std::string_view text, std::vector<LineSpan>& lines);
+
+// Appends to `out` the index of every text whose first ShortStringMasks::kMaxBytes
+// bytes contain `foldedQuery` (lower case) as a subsequence, ignoring ASCII case.
+// The batch form keeps the per-text work in registers and nearly branch-free: a load
+// and a fold per block, then one compare per query byte.
+void FilterFoldedSubsequences(
+    const std::vector<std::string_view>& texts,
+    std::string_view foldedQuery,
+    std::vector<uint32_t>& out);
+
+// The first (up to) 64 bytes of a short string such as an identifier or a completion
+// label, case-folded once and then compared a block at a time into bitmasks: bit i
+// describes byte i, bits past the end are clear.
+class ShortStringMasks {
+public:
+    static constexpr size_t kMaxBytes = 64;
+
+    explicit ShortStringMasks(std::string_view text);
+
+    size_t Size() const { return m_size; }
+    // Bytes equal to `folded` ignoring ASCII case; `folded` must be lower case.
+    uint64_t FoldedEqual(char folded) const;
+    // Identifier bytes that start a word: the first of a run, the one after '_' and
+    // an upper-case letter after a non-upper-case one (camelCase).
+    uint64_t WordStarts() const { return m_wordStarts; }
+
+private:
+    size_t m_size = 0;
+    uint64_t m_wordStarts = 0;
+    // The text with ASCII letters in lower case, up to Size() rounded up to the block
+    // size; bytes past Size() are unspecified.
+    alignas(32) char m_folded[kMaxBytes];
+};
@@ -19,6 +19,9 @@ void SaveConfig(const AppConfig& config) {
         out << "brackets=" << (config.autoClosingBrackets ? "1" : "0") << "\n";
         out << "indent=" << (config.smartIndentEnabled ? "1" : "0") << "\n";
         out << "minimap=" << (config.minimapEnabled ? "1" : "0") << "\n";
+        out << "wsindex=" << (config.workspaceIndexEnabled ? "1" : "0") << "\n";
+        out << "symindex=" << (config.symbolIndexEnabled ? "1" : "0") << "\n";
+        out << "lspdelay=" << config.lspChangeDelayMs << "\n";
         
         for (const auto& path : config.openFiles) {
             if (!path.empty()) {
@@ -55,6 +58,9 @@ AppConfig LoadConfig() {
                 else if (key == "brackets") config.autoClosingBrackets = (value == "1");
                 else if (key == "indent") config.smartIndentEnabled = (value == "1");
                 else if (key == "minimap") config.minimapEnabled = (value == "1");
+                else if (key == "wsindex") config.workspaceIndexEnabled = (value == "1");
+                else if (key == "symindex") config.symbolIndexEnabled = (value == "1");
+                else if (key == "lspdelay") config.lspChangeDelayMs = std::stoi(value);
                 else if (key == "file") config.openFiles.push_back(value);
             }
         }
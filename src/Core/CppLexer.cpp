@@ -0,0 +1,450 @@
+#include "CppLexer.h"
+#include "CharScan.h"
+
+namespace {
+
+bool IsRawStringPrefix(std::string_view word) {
+    return word == "R" || word == "LR" || word == "uR" || word == "UR" || word == "u8R";
+}
+
+struct QuotedEnd {
+    int end = 0;
+    bool closed = false;
+};
+
+QuotedEnd ScanQuoted(std::string_view text, int from, char quote) {
+    const int lineLength = static_cast<int>(text.size());
+    int end = static_cast<int>(FindByteOf(text, static_cast<size_t>(from), quote, '\\'));
+    while (end < lineLength) {
+        if (text[end] == quote) {
+            return {end + 1, true};
+        }
+        end = static_cast<int>(FindByteOf(text, static_cast<size_t>(end + 2), quote, '\\'));
+    }
+    return {lineLength, false};
+}
+
+// A string may only continue past the line when the line ends in a backslash.
+void FinishQuoted(std::string_view text, char quote, bool closed, CppLexState& state) {
+    if (!closed && quote == '"' && !text.empty() && text.back() == '\\') {
+        state.mode = CppLexState::Mode::String;
+        state.quote = quote;
+    }
+}
+
+// Scans for ")delim\"" from `from`; returns the column past it, or -1.
+int FindRawStringEnd(std::string_view text, int from, const std::string& delimiter) {
+    size_t pos = static_cast<size_t>(from);
+    while ((pos = text.find(')', pos)) != std::string_view::npos) {
+        const std::string_view rest = text.substr(pos + 1);
+        if (rest.size() > delimiter.size() && rest.compare(0, delimiter.size(), delimiter) == 0 &&
+            rest[delimiter.size()] == '"') {
+            return static_cast<int>(pos + 1 + delimiter.size() + 1);
+        }
+        ++pos;
+    }
+    return -1;
+}
+
+void Push(std::vector<CppToken>& tokens, int start, int end, CppTokenKind kind) {
+    if (end > start) {
+        tokens.push_back({start, end, kind});
+    }
+}
+
+// Directive text is coloured as a whole, with comments split out; strings are
+// skipped so "/*" inside an #include path does not open a comment.
+void LexDirective(std::string_view text, int from, CppLexState& state, std::vector<CppToken>& tokens) {
+    const int lineLength = static_cast<int>(text.size());
+    int runStart = from;
+    int i = from;
+    while (i < lineLength) {
+        const char ch = text[i];
+        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '/') {
+            Push(tokens, runStart, i, CppTokenKind::Preprocessor);
+            Push(tokens, i, lineLength, CppTokenKind::Comment);
+            return;
+        }
+        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '*') {
+            Push(tokens, runStart, i, CppTokenKind::Preprocessor);
+            const size_t close = text.find("*/", static_cast<size_t>(i + 2));
+            if (close == std::string_view::npos) {
+                Push(tokens, i, lineLength, CppTokenKind::Comment);
+                state.mode = CppLexState::Mode::BlockComment;
+                return;
+            }
+            const int end = static_cast<int>(close + 2);
+            Push(tokens, i, end, CppTokenKind::Comment);
+            runStart = i = end;
+            continue;
+        }
+        if (ch == '"' || ch == '\'') {
+            i = ScanQuoted(text, i + 1, ch).end;
+            continue;
+        }
+        i = static_cast<int>(FindByteOf(text, static_cast<size_t>(i + 1), '/', '"', '\''));
+    }
+    Push(tokens, runStart, lineLength, CppTokenKind::Preprocessor);
+    if (lineLength > 0 && text.back() == '\\') {
+        state.mode = CppLexState::Mode::Preprocessor;
+    }
+}
+
+struct WordEntry {
+    std::string_view word;
+    uint8_t flags;
+};
+
+constexpr WordEntry kWords[] = {
+    {"alignas", kCppWordKeyword},
+    {"alignof", kCppWordKeyword},
+    {"asm", kCppWordKeyword},
+    {"auto", kCppWordKeyword},
+    {"break", kCppWordKeyword},
+    {"case", kCppWordKeyword},
+    {"catch", kCppWordKeyword},
+    {"class", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"const", kCppWordKeyword},
+    {"consteval", kCppWordKeyword},
+    {"constexpr", kCppWordKeyword},
+    {"constinit", kCppWordKeyword},
+    {"continue", kCppWordKeyword},
+    {"co_await", kCppWordKeyword},
+    {"co_return", kCppWordKeyword},
+    {"co_yield", kCppWordKeyword},
+    {"decltype", kCppWordKeyword},
+    {"default", kCppWordKeyword},
+    {"delete", kCppWordKeyword},
+    {"do", kCppWordKeyword},
+    {"else", kCppWordKeyword},
+    {"enum", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"explicit", kCppWordKeyword},
+    {"export", kCppWordKeyword},
+    {"extern", kCppWordKeyword},
+    {"false", kCppWordKeyword},
+    {"final", kCppWordKeyword},
+    {"for", kCppWordKeyword},
+    {"friend", kCppWordKeyword},
+    {"goto", kCppWordKeyword},
+    {"if", kCppWordKeyword},
+    {"import", kCppWordKeyword},
+    {"inline", kCppWordKeyword},
+    {"module", kCppWordKeyword},
+    {"mutable", kCppWordKeyword},
+    {"namespace", kCppWordKeyword},
+    {"new", kCppWordKeyword},
+    {"noexcept", kCppWordKeyword},
+    {"nullptr", kCppWordKeyword},
+    {"operator", kCppWordKeyword},
+    {"override", kCppWordKeyword},
+    {"private", kCppWordKeyword},
+    {"protected", kCppWordKeyword},
+    {"public", kCppWordKeyword},
+    {"register", kCppWordKeyword},
+    {"requires", kCppWordKeyword},
+    {"return", kCppWordKeyword},
+    {"sizeof", kCppWordKeyword},
+    {"static", kCppWordKeyword},
+    {"static_assert", kCppWordKeyword},
+    {"struct", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"switch", kCppWordKeyword},
+    {"template", kCppWordKeyword},
+    {"this", kCppWordKeyword},
+    {"thread_local", kCppWordKeyword},
+    {"throw", kCppWordKeyword},
+    {"true", kCppWordKeyword},
+    {"try", kCppWordKeyword},
+    {"typedef", kCppWordKeyword},
+    {"typename", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"union", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"using", kCppWordKeyword | kCppWordTypeIntroducer},
+    {"virtual", kCppWordKeyword},
+    {"volatile", kCppWordKeyword},
+    {"while", kCppWordKeyword},
+    {"bool", kCppWordType},
+    {"char", kCppWordType},
+    {"char8_t", kCppWordType},
+    {"char16_t", kCppWordType},
+    {"char32_t", kCppWordType},
+    {"double", kCppWordType},
+    {"float", kCppWordType},
+    {"int", kCppWordType},
+    {"long", kCppWordType},
+    {"short", kCppWordType},
+    {"signed", kCppWordType},
+    {"unsigned", kCppWordType},
+    {"void", kCppWordType},
+    {"wchar_t", kCppWordType},
+    {"size_t", kCppWordType},
+    {"ptrdiff_t", kCppWordType},
+    {"uint8_t", kCppWordType},
+    {"uint16_t", kCppWordType},
+    {"uint32_t", kCppWordType},
+    {"uint64_t", kCppWordType},
+    {"int8_t", kCppWordType},
+    {"int16_t", kCppWordType},
+    {"int32_t", kCppWordType},
+    {"int64_t", kCppWordType},
+    {"std", kCppWordType},
+    {"string", kCppWordType},
+};
+
+constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+constexpr size_t kMinWordLength = 2;
+constexpr size_t kMaxWordLength = 13;
+
+// Perfect hash over (length, first, middle, last character): every word in kWords
+// lands in its own slot, so a lookup is one hash, one load and one compare.
+constexpr size_t kWordSlots = 512;
+constexpr uint32_t kWordSeed = 2551;
+
+constexpr uint32_t WordSlot(std::string_view word, uint32_t seed) {
+    uint32_t hash = static_cast<uint32_t>(word.size());
+    hash = hash * seed + static_cast<unsigned char>(word[0]);
+    hash = hash * seed + static_cast<unsigned char>(word[word.size() / 2]);
+    hash = hash * seed + static_cast<unsigned char>(word[word.size() - 1]);
+    hash ^= hash >> 15;
+    return hash % kWordSlots;
+}
+
+struct WordTable {
+    int8_t slots[kWordSlots] = {};
+    bool perfect = true;
+};
+
+constexpr WordTable BuildWordTable() {
+    WordTable table;
+    for (size_t slot = 0; slot < kWordSlots; ++slot) {
+        table.slots[slot] = -1;
+    }
+    for (size_t index = 0; index < kWordCount; ++index) {
+        const uint32_t slot = WordSlot(kWords[index].word, kWordSeed);
+        if (table.slots[slot] >= 0) {
+            table.perfect = false;
+        }
+        table.slots[slot] = static_cast<int8_t>(index);
+    }
+    return table;
+}
+
+constexpr WordTable kWordTable = BuildWordTable();
+static_assert(kWordCount < 128, "word indices are stored as int8_t");
+static_assert(kWordTable.perfect, "kWords collide under kWordSeed; search for a seed that separates them again");
+
+} // namespace
+
+uint8_t ClassifyCppWord(std::string_view word) {
+    if (word.size() < kMinWordLength || word.size() > kMaxWordLength) {
+        return 0;
+    }
+    const int8_t index = kWordTable.slots[WordSlot(word, kWordSeed)];
+    if (index < 0 || kWords[index].word != word) {
+        return 0;
+    }
+    return kWords[index].flags;
+}
+
+void LexCppLine(std::string_view text, CppLexState& state, std::vector<CppToken>& tokens) {
+    const int lineLength = static_cast<int>(text.size());
+    int i = 0;
+
+    // Finish whatever the previous line left open.
+    const CppLexState entry = state;
+    state = CppLexState();
+    switch (entry.mode) {
+    case CppLexState::Mode::Code:
+        break;
+    case CppLexState::Mode::BlockComment: {
+        const size_t close = text.find("*/");
+        if (close == std::string_view::npos) {
+            Push(tokens, 0, lineLength, CppTokenKind::Comment);
+            state.mode = CppLexState::Mode::BlockComment;
+            return;
+        }
+        i = static_cast<int>(close + 2);
+        Push(tokens, 0, i, CppTokenKind::Comment);
+        break;
+    }
+    case CppLexState::Mode::String: {
+        const QuotedEnd quoted = ScanQuoted(text, 0, entry.quote);
+        Push(tokens, 0, quoted.end, CppTokenKind::String);
+        if (!quoted.closed) {
+            FinishQuoted(text, entry.quote, false, state);
+            return;
+        }
+        i = quoted.end;
+        break;
+    }
+    case CppLexState::Mode::RawString: {
+        const int end = FindRawStringEnd(text, 0, entry.rawDelimiter);
+        if (end < 0) {
+            Push(tokens, 0, lineLength, CppTokenKind::String);
+            state = entry;
+            return;
+        }
+        Push(tokens, 0, end, CppTokenKind::String);
+        i = end;
+        break;
+    }
+    case CppLexState::Mode::Preprocessor:
+        LexDirective(text, 0, state, tokens);
+        return;
+    }
+
+    if (i == 0) {
+        const size_t firstCode = text.find_first_not_of(" \t");
+        if (firstCode != std::string_view::npos && text[firstCode] == '#') {
+            LexDirective(text, static_cast<int>(firstCode), state, tokens);
+            return;
+        }
+    }
+
+    bool expectTypeName = false;
+    while (i < lineLength) {
+        const char ch = text[i];
+
+        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '/') {
+            Push(tokens, i, lineLength, CppTokenKind::Comment);
+            break;
+        }
+
+        if (ch == '/' && i + 1 < lineLength && text[i + 1] == '*') {
+            int end = lineLength;
+            const size_t close = text.find("*/", static_cast<size_t>(i + 2));
+            if (close != std::string_view::npos) {
+                end = static_cast<int>(close + 2);
+            } else {
+                state.mode = CppLexState::Mode::BlockComment;
+            }
+            Push(tokens, i, end, CppTokenKind::Comment);
+            i = end;
+            continue;
+        }
+
+        if (ch == '"' || ch == '\'') {
+            const QuotedEnd quoted = ScanQuoted(text, i + 1, ch);
+            Push(tokens, i, quoted.end, CppTokenKind::String);
+            FinishQuoted(text, ch, quoted.closed, state);
+            i = quoted.end;
+            continue;
+        }
+
+        if (IsDigitByte(ch) || (ch == '.' && i + 1 < lineLength && IsDigitByte(text[i + 1]))) {
+            int end = i;
+            if (ch == '0' && i + 1 < lineLength && (text[i + 1] == 'x' || text[i + 1] == 'X')) {
+                end += 2;
+                while (end < lineLength && IsHexDigitByte(text[end])) {
+                    ++end;
+                }
+            } else {
+                // Step over a leading '.', otherwise "1.2.3" would stall on the second dot.
+                bool seenDot = (ch == '.');
+                end += seenDot ? 1 : 0;
+                while (end < lineLength) {
+                    const char n = text[end];
+                    if (IsDigitByte(n)) {
+                        ++end;
+                        continue;
+                    }
+                    if (n == '.' && !seenDot) {
+                        seenDot = true;
+                        ++end;
+                        continue;
+                    }
+                    if ((n == 'e' || n == 'E') && end + 1 < lineLength) {
+                        int expPos = end + 1;
+                        if (text[expPos] == '+' || text[expPos] == '-') {
+                            ++expPos;
+                        }
+                        if (expPos < lineLength && IsDigitByte(text[expPos])) {
+                            end = expPos + 1;
+                            while (end < lineLength && IsDigitByte(text[end])) {
+                                ++end;
+                            }
+                            continue;
+                        }
+                    }
+                    break;
+                }
+            }
+            while (end < lineLength && IsAlphaByte(text[end])) {
+                ++end;
+            }
+            Push(tokens, i, end, CppTokenKind::Number);
+            i = end;
+            continue;
+        }
+
+        if (IsIdentifierStartByte(ch)) {
+            const int end = static_cast<int>(SkipIdentifierBytes(text, static_cast<size_t>(i + 1)));
+
+            const std::string_view wordView = text.substr(static_cast<size_t>(i), static_cast<size_t>(end - i));
+            if (end < lineLength && text[end] == '"' && IsRawStringPrefix(wordView)) {
+                const size_t paren = text.find('(', static_cast<size_t>(end + 1));
+                if (paren != std::string_view::npos) {
+                    const std::string delimiter(text.substr(static_cast<size_t>(end + 1), paren - static_cast<size_t>(end + 1)));
+                    const int close = FindRawStringEnd(text, static_cast<int>(paren + 1), delimiter);
+                    if (close < 0) {
+                        Push(tokens, i, lineLength, CppTokenKind::String);
+                        state.mode = CppLexState::Mode::RawString;
+                        state.rawDelimiter = delimiter;
+                        return;
+                    }
+                    Push(tokens, i, close, CppTokenKind::String);
+                    i = close;
+                    continue;
+                }
+            }
+
+            const uint8_t wordFlags = ClassifyCppWord(wordView);
+            if ((wordFlags & kCppWordType) != 0) {
+                Push(tokens, i, end, CppTokenKind::Type);
+                expectTypeName = false;
+            } else if ((wordFlags & kCppWordKeyword) != 0) {
+                Push(tokens, i, end, CppTokenKind::Keyword);
+                expectTypeName = (wordFlags & kCppWordTypeIntroducer) != 0;
+            } else {
+                if (expectTypeName || (wordView[0] >= 'A' && wordView[0] <= 'Z')) {
+                    Push(tokens, i, end, CppTokenKind::Type);
+                    expectTypeName = false;
+                } else {
+                    const int probe = static_cast<int>(SkipBlanks(text, static_cast<size_t>(end)));
+                    if (probe < lineLength && text[probe] == '(') {
+                        Push(tokens, i, end, CppTokenKind::Function);
+                    } else if (probe < lineLength && text[probe] == '<') {
+                        Push(tokens, i, end, CppTokenKind::Function);
+                    }
+                }
+            }
+            i = end;
+            continue;
+        }
+
+        if (ch == ':' && i + 1 < lineLength && text[i + 1] == ':') {
+            Push(tokens, i, i + 2, CppTokenKind::Punctuation);
+            i += 2;
+            continue;
+        }
+
+        if (ch == '-' && i + 1 < lineLength && text[i + 1] == '>') {
+            Push(tokens, i, i + 2, CppTokenKind::Punctuation);
+            i += 2;
+            continue;
+        }
+
+        if (ch == '<' || ch == '>' || ch == '(' || ch == ')' ||
+            ch == '[' || ch == ']' || ch == '{' || ch == '}' ||
+            ch == ',' || ch == '*' || ch == '&' || ch == '=') {
+            Push(tokens, i, i + 1, CppTokenKind::Punctuation);
+            ++i;
+            continue;
+        }
+
+        if (IsBlankByte(ch)) {
+            i = static_cast<int>(SkipBlanks(text, static_cast<size_t>(i + 1)));
+            continue;
+        }
+
+        ++i;
+    }
+}
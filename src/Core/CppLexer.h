@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class CppTokenKind : uint8_t {
+    Keyword,
+    Type,
+    Number,
+    String,
+    Comment,
+    Preprocessor,
+    Function,
+    Punctuation
+};
+
+// Byte columns [start, end) within one line.
+struct CppToken {
+    int start = 0;
+    int end = 0;
+    CppTokenKind kind = CppTokenKind::Punctuation;
+};
+
+// What is still open at the end of a line: a block comment, a string continued with
+// a backslash, a raw string or a continued preprocessor directive. Two lines lexed
+// from equal states produce equal tokens, which is what lets a cache stop re-lexing.
+struct CppLexState {
+    enum class Mode : uint8_t { Code, BlockComment, String, RawString, Preprocessor };
+
+    Mode mode = Mode::Code;
+    char quote = 0;           // Mode::String
+    std::string rawDelimiter; // Mode::RawString
+
+    bool operator==(const CppLexState& other) const {
+        return mode == other.mode && quote == other.quote && rawDelimiter == other.rawDelimiter;
+    }
+    bool operator!=(const CppLexState& other) const { return !(*this == other); }
+};
+
+enum CppWordFlags : uint8_t {
+    kCppWordKeyword = 1 << 0,
+    kCppWordType = 1 << 1,
+    kCppWordTypeIntroducer = 1 << 2   // class/struct/...: the next identifier is a type name
+};
+
+// CppWordFlags of an identifier, 0 for ordinary names. Allocation-free.
+uint8_t ClassifyCppWord(std::string_view word);
+
+// Appends the tokens of `line` (without its '\n') to `tokens`. `state` is the state
+// at the start of the line on entry and the state at its end on return.
+void LexCppLine(std::string_view line, CppLexState& state, std::vector<CppToken>& tokens);
@@ -0,0 +1,82 @@
+#include "FileContents.h"
+#include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Mapping costs more syscalls and page faults than a plain read for small files,
+// which are most of a source tree.
+constexpr size_t kMapThresholdBytes = 256u * 1024u;
+
+} // namespace
+
+FileContents::FileContents(const std::string& path, std::string& buffer, size_t maxBytes) {
+#ifdef _WIN32
+    const std::wstring widePath = std::filesystem::u8path(path).wstring();
+    m_file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart <= 0 ||
+        static_cast<unsigned long long>(size.QuadPart) > maxBytes) {
+        return;
+    }
+    if (static_cast<size_t>(size.QuadPart) < kMapThresholdBytes) {
+        buffer.resize(static_cast<size_t>(size.QuadPart));
+        DWORD read = 0;
+        if (ReadFile(m_file, buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr)) {
+            m_data = buffer.data();
+            m_size = read;
+        }
+        return;
+    }
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) return;
+    const void* view = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) return;
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_mapped = true;
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 &&
+        static_cast<unsigned long long>(info.st_size) <= maxBytes) {
+        if (static_cast<size_t>(info.st_size) < kMapThresholdBytes) {
+            buffer.resize(static_cast<size_t>(info.st_size));
+            const ssize_t got = read(fd, buffer.data(), buffer.size());
+            if (got > 0) {
+                m_data = buffer.data();
+                m_size = static_cast<size_t>(got);
+            }
+            close(fd);
+            return;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            m_data = static_cast<const char*>(view);
+            m_size = static_cast<size_t>(info.st_size);
+            m_mapped = true;
+            madvise(view, m_size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+#endif
+}
+
+FileContents::~FileContents() {
+#ifdef _WIN32
+    if (m_mapped) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+    if (m_mapped) munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
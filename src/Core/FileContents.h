@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only view of a whole file, mapped when large and read into `buffer` (which
+// the caller may reuse across files) when small; empty when the file cannot be read,
+// is not a regular file or is larger than `maxBytes`.
+class FileContents {
+public:
+    FileContents(const std::string& path, std::string& buffer, size_t maxBytes);
+    ~FileContents();
+
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+
+    std::string_view View() const { return std::string_view(m_data != nullptr ? m_data : "", m_size); }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+};
@@ -0,0 +1,422 @@
+#include "FindEngine.h"
+#include "CharScan.h"
+#include <algorithm>
+
+namespace {
+
+char FoldAscii(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+char UpperAscii(char ch) {
+    return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+}
+
+bool EqualsFolded(std::string_view text, std::string_view needle) {
+    for (size_t i = 0; i < needle.size(); ++i) {
+        if (FoldAscii(text[i]) != needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsRegexQuantifier(char ch) {
+    return ch == '*' || ch == '+' || ch == '?' || ch == '{';
+}
+
+bool StartsBefore(const FindMatch& match, size_t offset) {
+    return match.start < offset;
+}
+
+// ECMAScript replacement patterns: $$, $&, $` and $' (within the line), $1 ... $99;
+// groups that did not take part expand to nothing, unknown ones stay as written.
+std::string FormatReplacement(std::string_view line, const std::vector<size_t>& groups, std::string_view replacement) {
+    const size_t groupCount = groups.size() / 2 - 1;
+    const auto appendGroup = [&](std::string& out, size_t group) {
+        if (groups[2 * group] != LinearRegex::kNoGroup) {
+            out.append(line.substr(groups[2 * group], groups[2 * group + 1] - groups[2 * group]));
+        }
+    };
+    std::string out;
+    for (size_t i = 0; i < replacement.size(); ++i) {
+        const char next = i + 1 < replacement.size() ? replacement[i + 1] : '\0';
+        if (replacement[i] != '$' || next == '\0') {
+            out.push_back(replacement[i]);
+            continue;
+        }
+        if (next == '$') {
+            out.push_back('$');
+        } else if (next == '&') {
+            appendGroup(out, 0);
+        } else if (next == '`') {
+            out.append(line.substr(0, groups[0]));
+        } else if (next == '\'') {
+            out.append(line.substr(groups[1]));
+        } else if (next >= '0' && next <= '9') {
+            const char second = i + 2 < replacement.size() ? replacement[i + 2] : '\0';
+            const size_t one = static_cast<size_t>(next - '0');
+            const size_t two = one * 10 + static_cast<size_t>(second - '0');
+            if (second >= '0' && second <= '9' && two >= 1 && two <= groupCount) {
+                appendGroup(out, two);
+                ++i;
+            } else if (one >= 1 && one <= groupCount) {
+                appendGroup(out, one);
+            } else {
+                out.push_back('$');
+                continue;
+            }
+        } else {
+            out.push_back('$');
+            continue;
+        }
+        ++i;
+    }
+    return out;
+}
+
+} // namespace
+
+// Groups, classes and escapes like \d end a run; a quantifier that allows zero
+// repetitions takes the character before it out of the run.
+std::string RequiredRegexLiteral(std::string_view pattern) {
+    std::string best;
+    std::string run;
+    const auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    int depth = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char ch = pattern[i];
+        if (ch == '|' && depth == 0) {
+            return std::string();
+        }
+        if (ch == '(') {
+            ++depth;
+            endRun();
+            continue;
+        }
+        if (ch == ')') {
+            depth = std::max(0, depth - 1);
+            endRun();
+            continue;
+        }
+        if (ch == '[') {
+            // Skip the class ("[]" and "[^]" included).
+            size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '^') ++j;
+            while (j < pattern.size() && pattern[j] != ']') {
+                j += pattern[j] == '\\' ? 2 : 1;
+            }
+            i = j;
+            endRun();
+            continue;
+        }
+
+        char literal = 0;
+        if (ch == '\\' && i + 1 < pattern.size()) {
+            const char escaped = pattern[++i];
+            if (IsIdentifierByte(escaped)) {
+                // \d, \w, \b, \n, \x41, backreferences... not worth decoding.
+                endRun();
+                continue;
+            }
+            literal = escaped;
+        } else if (ch == '{') {
+            // {n,m}: skip the counts as well.
+            while (i + 1 < pattern.size() && pattern[i] != '}') ++i;
+            endRun();
+            continue;
+        } else if (ch == '.' || ch == '^' || ch == '$' || IsRegexQuantifier(ch)) {
+            endRun();
+            continue;
+        } else {
+            literal = ch;
+        }
+
+        if (depth > 0) {
+            continue;
+        }
+        const char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+        if (next == '*' || next == '?' || next == '{') {
+            endRun();
+            continue;
+        }
+        run.push_back(literal);
+        if (next == '+') {
+            endRun();
+        }
+    }
+    endRun();
+    return best;
+}
+
+void FindEngine::Compile() {
+    m_error = false;
+    m_required.clear();
+    if (!m_options.regex || m_query.empty()) {
+        return;
+    }
+    if (!m_regex.Compile(m_query, m_options.caseSensitive)) {
+        m_error = true;
+        return;
+    }
+    m_required = RequiredRegexLiteral(m_query);
+    if (!m_options.caseSensitive) {
+        std::transform(m_required.begin(), m_required.end(), m_required.begin(), FoldAscii);
+    }
+}
+
+void FindEngine::Reset() {
+    m_version = UINT64_MAX;
+    m_matches.clear();
+    m_dirty = false;
+}
+
+void FindEngine::OnEdit(size_t offset, size_t removedLength, size_t insertedLength) {
+    if (m_version == UINT64_MAX) {
+        return;
+    }
+
+    // Matches starting inside the removed text are gone and later ones move with the
+    // text. A match that starts earlier but runs into the edit is on the edited line,
+    // so the refresh below replaces it.
+    const size_t removedEnd = offset + removedLength;
+    const auto first = std::lower_bound(m_matches.begin(), m_matches.end(), offset, StartsBefore);
+    const auto last = std::lower_bound(first, m_matches.end(), removedEnd, StartsBefore);
+    const auto tail = m_matches.erase(first, last);
+    for (auto it = tail; it != m_matches.end(); ++it) {
+        it->start = it->start - removedLength + insertedLength;
+        it->end = it->end - removedLength + insertedLength;
+    }
+
+    const auto mapOffset = [&](size_t position, size_t insideTo) {
+        if (position < offset) return position;
+        if (position >= removedEnd) return position - removedLength + insertedLength;
+        return insideTo;
+    };
+    if (m_dirty) {
+        m_dirtyStart = std::min(mapOffset(m_dirtyStart, offset), offset);
+        m_dirtyEnd = std::max(mapOffset(m_dirtyEnd, offset + insertedLength), offset + insertedLength);
+    } else {
+        m_dirtyStart = offset;
+        m_dirtyEnd = offset + insertedLength;
+        m_dirty = true;
+    }
+}
+
+const std::vector<FindMatch>& FindEngine::Matches(
+    const TextDocument& document,
+    const std::string& query,
+    const FindOptions& options) {
+    const std::string& text = document.Text();
+
+    // Line-by-line refresh relies on matches (and whole-word context) never spanning
+    // lines; regexes are only ever run on single lines.
+    const bool incremental = m_version != UINT64_MAX && query == m_query && options == m_options &&
+                             (options.regex || query.find('\n') == std::string::npos) &&
+                             (m_dirty || m_version == document.Version());
+    if (!incremental) {
+        if (query != m_query || options != m_options || m_version == UINT64_MAX) {
+            m_query = query;
+            m_options = options;
+            Compile();
+        }
+        m_matches.clear();
+        SearchRange(text, 0, text.size(), m_matches);
+        m_version = document.Version();
+        m_dirty = false;
+        return m_matches;
+    }
+
+    if (m_dirty) {
+        const size_t size = document.Size();
+        const size_t from = document.LineStart(document.LineFromOffset(std::min(m_dirtyStart, size)));
+        const size_t to = document.LineEnd(document.LineFromOffset(std::min(m_dirtyEnd, size)));
+        const auto first = std::lower_bound(m_matches.begin(), m_matches.end(), from, StartsBefore);
+        const auto last = std::lower_bound(first, m_matches.end(), to, StartsBefore);
+        std::vector<FindMatch> found;
+        SearchRange(text, from, to, found);
+        const auto at = m_matches.erase(first, last);
+        m_matches.insert(at, found.begin(), found.end());
+        m_dirty = false;
+    }
+    m_version = document.Version();
+    return m_matches;
+}
+
+void FindEngine::SearchText(
+    std::string_view text,
+    const std::string& query,
+    const FindOptions& options,
+    std::vector<FindMatch>& out,
+    size_t maxRegexLineBytes,
+    size_t* skippedLines) {
+    if (query != m_query || options != m_options) {
+        Reset();
+        m_query = query;
+        m_options = options;
+        Compile();
+    }
+    SearchRange(text, 0, text.size(), out, maxRegexLineBytes, skippedLines);
+}
+
+void FindEngine::LineMatches(const TextDocument& document, size_t line, std::vector<FindMatch>& out) const {
+    if (m_matches.empty() || line >= document.LineCount()) {
+        return;
+    }
+    const size_t lineStart = document.LineStart(line);
+    const size_t lineEnd = document.LineEnd(line);
+    for (auto it = std::lower_bound(m_matches.begin(), m_matches.end(), lineStart, StartsBefore);
+         it != m_matches.end() && it->start < lineEnd;
+         ++it) {
+        out.push_back({it->start - lineStart, std::min(it->end, lineEnd) - lineStart});
+    }
+}
+
+std::string FindEngine::ExpandReplacement(
+    std::string_view text,
+    const FindMatch& match,
+    const std::string& replacement) const {
+    if (!m_options.regex || m_error) {
+        return replacement;
+    }
+    // Re-run the regex anchored at the match, with the line as context for ^ and \b.
+    const size_t newline = match.start == 0 ? std::string_view::npos : text.rfind('\n', match.start - 1);
+    const size_t lineStart = newline == std::string_view::npos ? 0 : newline + 1;
+    const size_t lineEnd = FindByteOf(text, match.start, '\n', '\n');
+    const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+    std::vector<size_t> groups;
+    if (!m_regex.Search(line, match.start - lineStart, true, true, groups)) {
+        return replacement;
+    }
+    return FormatReplacement(line, groups, replacement);
+}
+
+TextChange FindEngine::ReplaceAll(const TextDocument& document, const std::string& replacement) const {
+    TextChange change;
+    if (m_matches.empty()) {
+        return change;
+    }
+    const std::string& text = document.Text();
+    const size_t spanStart = m_matches.front().start;
+    size_t copied = spanStart;
+    for (const FindMatch& match : m_matches) {
+        if (match.start < copied || match.end > text.size()) {
+            continue;
+        }
+        change.insertedText.append(text, copied, match.start - copied);
+        change.insertedText += ExpandReplacement(text, match, replacement);
+        copied = match.end;
+    }
+    change.offset = spanStart;
+    change.removedText = text.substr(spanStart, copied - spanStart);
+    return change;
+}
+
+void FindEngine::SearchRange(
+    std::string_view text,
+    size_t from,
+    size_t to,
+    std::vector<FindMatch>& out,
+    size_t maxRegexLineBytes,
+    size_t* skippedLines) const {
+    if (m_query.empty() || m_error || to <= from) {
+        return;
+    }
+    if (m_options.regex) {
+        SearchRegex(text, from, to, out, maxRegexLineBytes, skippedLines);
+    } else {
+        SearchLiteral(text, from, to, out);
+    }
+}
+
+void FindEngine::SearchLiteral(std::string_view text, size_t from, size_t to, std::vector<FindMatch>& out) const {
+    std::string folded;
+    std::string_view needle = m_query;
+    if (!m_options.caseSensitive) {
+        folded.resize(m_query.size());
+        std::transform(m_query.begin(), m_query.end(), folded.begin(), FoldAscii);
+        needle = folded;
+    }
+    for (size_t pos = FindLiteral(text, from, to, needle); pos < to; pos = FindLiteral(text, pos + 1, to, needle)) {
+        const size_t end = pos + needle.size();
+        if (!m_options.wholeWord || IsWholeWord(text, pos, end)) {
+            out.push_back({pos, end});
+        }
+    }
+}
+
+void FindEngine::SearchRegex(
+    std::string_view text,
+    size_t from,
+    size_t to,
+    std::vector<FindMatch>& out,
+    size_t maxLineBytes,
+    size_t* skippedLines) const {
+    // Lines without the required literal are skipped; the others are matched one at
+    // a time, which keeps ^ and $ at line ends.
+    std::vector<size_t> groups;
+    size_t pos = from;
+    while (pos < to) {
+        size_t lineStart = pos;
+        if (!m_required.empty()) {
+            const size_t hit = FindLiteral(text, pos, to, m_required);
+            if (hit >= to) {
+                return;
+            }
+            const size_t newline = hit == 0 ? std::string_view::npos : text.rfind('\n', hit - 1);
+            lineStart = newline == std::string_view::npos ? 0 : newline + 1;
+            lineStart = std::max(lineStart, pos);
+        }
+        const size_t lineEnd = std::min(FindByteOf(text, lineStart, '\n', '\n'), to);
+        if (lineEnd - lineStart > maxLineBytes) {
+            if (skippedLines != nullptr) {
+                ++*skippedLines;
+            }
+            pos = lineEnd + 1;
+            continue;
+        }
+
+        const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        for (size_t at = 0; at < line.size() && m_regex.Search(line, at, false, true, groups); at = groups[1]) {
+            const size_t start = lineStart + groups[0];
+            const size_t end = lineStart + groups[1];
+            if (!m_options.wholeWord || IsWholeWord(text, start, end)) {
+                out.push_back({start, end});
+            }
+        }
+        pos = lineEnd + 1;
+    }
+}
+
+size_t FindEngine::FindLiteral(std::string_view text, size_t from, size_t to, std::string_view needle) const {
+    if (needle.size() > to - std::min(from, to)) {
+        return to;
+    }
+    const std::string_view bounded = text.substr(0, to);
+    if (m_options.caseSensitive) {
+        const size_t pos = bounded.find(needle, from);
+        return pos == std::string_view::npos ? to : pos;
+    }
+    // `needle` is already folded: scan for either case of its first byte, then compare.
+    const size_t last = to - needle.size();
+    const char lower = needle[0];
+    const char upper = UpperAscii(lower);
+    for (size_t pos = FindByteOf(bounded, from, lower, upper); pos <= last; pos = FindByteOf(bounded, pos + 1, lower, upper)) {
+        if (EqualsFolded(bounded.substr(pos + 1, needle.size() - 1), needle.substr(1))) {
+            return pos;
+        }
+    }
+    return to;
+}
+
+bool FindEngine::IsWholeWord(std::string_view text, size_t start, size_t end) const {
+    const bool leftOpen = start == 0 || !IsIdentifierByte(text[start - 1]) || !IsIdentifierByte(text[start]);
+    const bool rightOpen = end >= text.size() || !IsIdentifierByte(text[end]) || !IsIdentifierByte(text[end - 1]);
+    return leftOpen && rightOpen;
+}
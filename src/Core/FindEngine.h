@@ -0,0 +1,113 @@
+#pragma once
+#include "LinearRegex.h"
+#include "TextDocument.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Longest run of literal characters that every match of the ECMAScript `pattern`
+// must contain, or "" when none can be proven (top-level alternation, only classes).
+std::string RequiredRegexLiteral(std::string_view pattern);
+
+// Byte range [start, end) of one match; document offsets or, from LineMatches,
+// columns within the line.
+struct FindMatch {
+    size_t start = 0;
+    size_t end = 0;
+};
+
+struct FindOptions {
+    bool caseSensitive = true;
+    bool wholeWord = false; // match must not touch identifier bytes on either side
+    bool regex = false;     // LinearRegex (ECMAScript subset), matched within single lines
+
+    bool operator==(const FindOptions& other) const {
+        return caseSensitive == other.caseSensitive && wholeWord == other.wholeWord && regex == other.regex;
+    }
+    bool operator!=(const FindOptions& other) const { return !(*this == other); }
+};
+
+// Match list for one document and query, kept across frames. Edits are reported
+// through OnEdit before they are applied; the next Matches() call then re-searches
+// only the lines they touched. Any other change of document version or query
+// triggers a full search.
+class FindEngine {
+public:
+    void Reset();
+
+    // Same arguments as the TextChange about to be applied.
+    void OnEdit(size_t offset, size_t removedLength, size_t insertedLength);
+
+    // All matches of `query` in `document`, sorted by start. Overlapping literal
+    // matches are all reported; regex matches do not overlap and are never empty.
+    // Case folding is ASCII only.
+    const std::vector<FindMatch>& Matches(
+        const TextDocument& document,
+        const std::string& query,
+        const FindOptions& options = FindOptions());
+
+    // The last regex query did not compile (invalid, or using backreferences or
+    // lookaround, which LinearRegex does not support); Matches() is empty until it
+    // changes.
+    bool HasError() const { return m_error; }
+
+    // All matches in a standalone buffer such as a file on disk, appended to `out` as
+    // buffer offsets. Drops the cached document matches when the query changes. In
+    // regex mode, lines longer than `maxRegexLineBytes` are not searched and counted
+    // in `skippedLines`.
+    void SearchText(
+        std::string_view text,
+        const std::string& query,
+        const FindOptions& options,
+        std::vector<FindMatch>& out,
+        size_t maxRegexLineBytes = SIZE_MAX,
+        size_t* skippedLines = nullptr);
+
+    // Matches on `line` from the last Matches() call, as line columns.
+    void LineMatches(const TextDocument& document, size_t line, std::vector<FindMatch>& out) const;
+
+    // Text that replaces `match`: `replacement` as is, or with $1, $& ... expanded in
+    // regex mode.
+    std::string ExpandReplacement(std::string_view text, const FindMatch& match, const std::string& replacement) const;
+
+    // One edit replacing every match from the last Matches() call (overlapping ones
+    // are skipped), spanning the first to the last match; built in a single pass.
+    // Empty when there is nothing to replace.
+    TextChange ReplaceAll(const TextDocument& document, const std::string& replacement) const;
+
+private:
+    void Compile();
+    void SearchRange(
+        std::string_view text,
+        size_t from,
+        size_t to,
+        std::vector<FindMatch>& out,
+        size_t maxRegexLineBytes = SIZE_MAX,
+        size_t* skippedLines = nullptr) const;
+    void SearchLiteral(std::string_view text, size_t from, size_t to, std::vector<FindMatch>& out) const;
+    void SearchRegex(
+        std::string_view text,
+        size_t from,
+        size_t to,
+        std::vector<FindMatch>& out,
+        size_t maxLineBytes,
+        size_t* skippedLines) const;
+    // First occurrence of `needle` in text[from, to), honouring case folding, or `to`.
+    size_t FindLiteral(std::string_view text, size_t from, size_t to, std::string_view needle) const;
+    bool IsWholeWord(std::string_view text, size_t start, size_t end) const;
+
+    std::string m_query;
+    FindOptions m_options;
+    LinearRegex m_regex;
+    std::string m_required; // literal every regex match contains; the prefilter looks for it
+    bool m_error = false;
+    uint64_t m_version = UINT64_MAX;
+    std::vector<FindMatch> m_matches;
+
+    // Region touched by edits since the last refresh, in current document offsets.
+    bool m_dirty = false;
+    size_t m_dirtyStart = 0;
+    size_t m_dirtyEnd = 0;
+};
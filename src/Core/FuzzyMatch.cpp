@@ -0,0 +1,272 @@
+#include "FuzzyMatch.h"
+#include "CharScan.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr int kScoreMatch = 16;
+constexpr int kBonusBoundary = 8;
+constexpr int kBonusStart = 2;      // on top of the boundary bonus at byte 0
+constexpr int kBonusConsecutive = 5;
+constexpr int kBonusFirstCharFactor = 2; // the first query byte's bonus counts double
+constexpr int kBonusExactCase = 1;
+constexpr int kPenaltyGapStart = 3;
+constexpr int kPenaltyGapExtension = 1;
+
+bool IsUpperByte(char ch) {
+    return ch >= 'A' && ch <= 'Z';
+}
+
+char FoldByte(char ch) {
+    return IsUpperByte(ch) ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+unsigned LowestBit(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned long index = 0;
+    if (_BitScanForward(&index, static_cast<uint32_t>(mask))) return static_cast<unsigned>(index);
+    _BitScanForward(&index, static_cast<uint32_t>(mask >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+unsigned HighestBit(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, mask);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned long index = 0;
+    if (_BitScanReverse(&index, static_cast<uint32_t>(mask >> 32))) return static_cast<unsigned>(index) + 32;
+    _BitScanReverse(&index, static_cast<uint32_t>(mask));
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(mask));
+#endif
+}
+
+// PresentBytes bits from here on are shared by several bytes.
+constexpr unsigned kSharedPresentBits = 37;
+
+// PresentBytes bit of a case-folded byte.
+unsigned PresentBit(char folded) {
+    const unsigned char byte = static_cast<unsigned char>(folded);
+    if (byte >= 'a' && byte <= 'z') return byte - 'a';
+    if (byte >= '0' && byte <= '9') return 26u + (byte - '0');
+    if (byte == '_') return 36u;
+    return kSharedPresentBits + byte % (64u - kSharedPresentBits);
+}
+
+// Bits at and above `bit` (0 when bit == 64).
+uint64_t BitsFrom(unsigned bit) {
+    return bit >= 64 ? 0 : ~uint64_t(0) << bit;
+}
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher(std::string_view query) : m_query(query) {
+    m_folded.reserve(m_query.size());
+    for (const char ch : m_query) {
+        m_folded.push_back(FoldByte(ch));
+        m_present |= uint64_t(1) << PresentBit(m_folded.back());
+    }
+}
+
+uint64_t FuzzyMatcher::PresentBytes(std::string_view candidate) {
+    uint64_t present = 0;
+    const size_t size = std::min(candidate.size(), ShortStringMasks::kMaxBytes);
+    for (size_t i = 0; i < size; ++i) {
+        present |= uint64_t(1) << PresentBit(FoldByte(candidate[i]));
+    }
+    return present;
+}
+
+bool FuzzyMatcher::Align(std::string_view candidate, unsigned* positions, uint64_t& wordStarts) const {
+    const size_t count = m_folded.size();
+    if (count == 0 || count > ShortStringMasks::kMaxBytes || candidate.size() < count) {
+        return false;
+    }
+
+    // Subsequence test: each query byte takes the first matching position after the
+    // previous one.
+    const ShortStringMasks masks(candidate);
+    uint64_t equal[ShortStringMasks::kMaxBytes];
+    unsigned next = 0;
+    for (size_t j = 0; j < count; ++j) {
+        equal[j] = masks.FoldedEqual(m_folded[j]);
+        const uint64_t remaining = equal[j] & BitsFrom(next);
+        if (remaining == 0) {
+            return false;
+        }
+        next = LowestBit(remaining) + 1;
+    }
+
+    // The latest position each query byte can take with the rest still fitting after
+    // it. Between that and the earliest one, a word start is preferred, then
+    // continuing a run, which finds "RenderCompletionPopup" for "rcp" rather than
+    // stopping at the 'p' of "Completion".
+    unsigned latest[ShortStringMasks::kMaxBytes];
+    latest[count - 1] = HighestBit(equal[count - 1]);
+    for (size_t j = count - 1; j-- > 0;) {
+        latest[j] = HighestBit(equal[j] & ((uint64_t(1) << latest[j + 1]) - 1));
+    }
+    wordStarts = masks.WordStarts();
+    next = 0;
+    for (size_t j = 0; j < count; ++j) {
+        const uint64_t window = equal[j] & BitsFrom(next) & ~BitsFrom(latest[j] + 1);
+        const uint64_t atWordStart = window & wordStarts;
+        if (atWordStart != 0) {
+            positions[j] = LowestBit(atWordStart);
+        } else if (j > 0 && ((window >> next) & 1)) {
+            positions[j] = next;
+        } else {
+            positions[j] = LowestBit(window);
+        }
+        next = positions[j] + 1;
+    }
+    return true;
+}
+
+int FuzzyMatcher::Score(std::string_view candidate) const {
+    if (Empty()) {
+        return 0;
+    }
+    unsigned positions[ShortStringMasks::kMaxBytes];
+    uint64_t wordStarts = 0;
+    if (!Align(candidate, positions, wordStarts)) {
+        return kNoMatch;
+    }
+
+    const size_t count = m_folded.size();
+    int score = 0;
+    for (size_t j = 0; j < count; ++j) {
+        const unsigned pos = positions[j];
+        const bool wordStart = ((wordStarts >> pos) & 1) != 0;
+        int bonus = 0;
+        if (wordStart) {
+            bonus = kBonusBoundary + (pos == 0 ? kBonusStart : 0);
+        }
+        if (j == 0) {
+            bonus *= kBonusFirstCharFactor;
+        } else if (pos == positions[j - 1] + 1) {
+            bonus = std::max(bonus, kBonusConsecutive);
+        } else {
+            // Jumping to the next word is what abbreviations do, so its length is free.
+            const int gap = static_cast<int>(pos - positions[j - 1] - 1);
+            score -= kPenaltyGapStart + (wordStart ? 0 : kPenaltyGapExtension * (gap - 1));
+        }
+        score += kScoreMatch + bonus;
+        if (candidate[pos] == m_query[j]) {
+            score += kBonusExactCase;
+        }
+    }
+    return score;
+}
+
+uint64_t FuzzyMatcher::MatchedBytes(std::string_view candidate) const {
+    unsigned positions[ShortStringMasks::kMaxBytes];
+    uint64_t wordStarts = 0;
+    if (!Align(candidate, positions, wordStarts)) {
+        return 0;
+    }
+    uint64_t matched = 0;
+    for (size_t j = 0; j < m_folded.size(); ++j) {
+        matched |= uint64_t(1) << positions[j];
+    }
+    return matched;
+}
+
+void FuzzyMatcher::Filter(const std::vector<std::string_view>& candidates, std::vector<uint32_t>& out) const {
+    if (Empty()) {
+        // The batch test finds nothing in an empty candidate, not even "".
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+        return;
+    }
+    FilterFoldedSubsequences(candidates, m_folded, out);
+}
+
+void FuzzyMatcher::Rank(
+    const std::vector<std::string_view>& candidates,
+    size_t limit,
+    std::vector<uint32_t>& out) const {
+    if (Empty()) {
+        for (size_t i = 0; i < std::min(limit, candidates.size()); ++i) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+        return;
+    }
+
+    // Most candidates fail the subsequence test; Filter rejects them before any scoring.
+    std::vector<uint32_t> matches;
+    Filter(candidates, matches);
+    RankMatches(candidates, matches, limit, out);
+}
+
+void FuzzyMatcher::Rank(
+    const std::vector<std::string_view>& candidates,
+    const std::vector<uint64_t>& present,
+    size_t limit,
+    std::vector<uint32_t>& out) const {
+    if (Empty()) {
+        Rank(candidates, limit, out);
+        return;
+    }
+
+    std::vector<uint32_t> survivors;
+    std::vector<std::string_view> texts;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if ((present[i] & m_present) == m_present) {
+            survivors.push_back(static_cast<uint32_t>(i));
+            texts.push_back(candidates[i]);
+        }
+    }
+    // A single letter, digit or '_' has a bit of its own, so the bits alone decide.
+    if (m_folded.size() == 1 && PresentBit(m_folded[0]) < kSharedPresentBits) {
+        RankMatches(candidates, survivors, limit, out);
+        return;
+    }
+    std::vector<uint32_t> matches;
+    FilterFoldedSubsequences(texts, m_folded, matches);
+    for (uint32_t& index : matches) {
+        index = survivors[index];
+    }
+    RankMatches(candidates, matches, limit, out);
+}
+
+void FuzzyMatcher::RankMatches(
+    const std::vector<std::string_view>& candidates,
+    const std::vector<uint32_t>& matches,
+    size_t limit,
+    std::vector<uint32_t>& out) const {
+    std::vector<std::pair<int, uint32_t>> scored;
+    scored.reserve(matches.size());
+    for (const uint32_t index : matches) {
+        scored.emplace_back(Score(candidates[index]), index);
+    }
+
+    const auto better = [&candidates](const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b) {
+        if (a.first != b.first) return a.first > b.first;
+        const size_t aSize = candidates[a.second].size();
+        const size_t bSize = candidates[b.second].size();
+        if (aSize != bSize) return aSize < bSize;
+        return a.second < b.second;
+    };
+    const size_t count = std::min(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + static_cast<std::ptrdiff_t>(count), scored.end(), better);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(scored[i].second);
+    }
+}
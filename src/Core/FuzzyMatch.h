@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// fzf-style fuzzy matching for completion. A candidate matches when the query is a
+// subsequence of it, ignoring ASCII case. Matches at word starts (the first byte,
+// after '_' or another non-identifier byte, a camelCase hump), runs of consecutive
+// matches and exact case score higher; gaps score lower. Only the first 64 bytes of a
+// candidate are considered.
+class FuzzyMatcher {
+public:
+    static constexpr int kNoMatch = std::numeric_limits<int>::min();
+
+    explicit FuzzyMatcher(std::string_view query);
+
+    const std::string& Query() const { return m_query; }
+    bool Empty() const { return m_query.empty(); }
+    // First query byte in lower case, or 0 for an empty query.
+    char FoldedFirst() const { return m_folded.empty() ? '\0' : m_folded[0]; }
+
+    // kNoMatch, or a score where higher is better; 0 for every candidate when the
+    // query is empty.
+    int Score(std::string_view candidate) const;
+    // The candidate bytes Score aligned the query with, bit i for byte i; 0 when it does
+    // not match or the query is empty. For highlighting.
+    uint64_t MatchedBytes(std::string_view candidate) const;
+
+    // Indices of the candidates the query is a subsequence of, in order; all of them
+    // for an empty query. A vectorized batch test, cheaper than scoring each one.
+    void Filter(const std::vector<std::string_view>& candidates, std::vector<uint32_t>& out) const;
+
+    // Indices of the matching candidates, at most `limit`, best first: by score, then
+    // shorter, then earlier in `candidates`. An empty query keeps the given order.
+    void Rank(const std::vector<std::string_view>& candidates, size_t limit, std::vector<uint32_t>& out) const;
+    // Same, with `present[i]` = PresentBytes(candidates[i]) computed once per list:
+    // candidates lacking a query byte are rejected from that alone, without reading
+    // their text, so re-ranking a long list on every keystroke stays cheap.
+    void Rank(
+        const std::vector<std::string_view>& candidates,
+        const std::vector<uint64_t>& present,
+        size_t limit,
+        std::vector<uint32_t>& out) const;
+
+    // The case-folded bytes in the candidate's first 64, one bit per letter, digit and
+    // '_', other bytes sharing the rest. A candidate can only match when it has every
+    // bit of the query's.
+    static uint64_t PresentBytes(std::string_view candidate);
+
+private:
+    // Fills positions[0, query size) and the candidate's word starts; false when the
+    // query is empty or not a subsequence of the candidate.
+    bool Align(std::string_view candidate, unsigned* positions, uint64_t& wordStarts) const;
+    // Scores `matches` (indices of matching candidates) and keeps the best `limit`.
+    void RankMatches(
+        const std::vector<std::string_view>& candidates,
+        const std::vector<uint32_t>& matches,
+        size_t limit,
+        std::vector<uint32_t>& out) const;
+
+    std::string m_query;
+    std::string m_folded;
+    uint64_t m_present = 0; // PresentBytes of the query
+};
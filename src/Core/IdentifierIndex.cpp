@@ -0,0 +1,140 @@
+#include "IdentifierIndex.h"
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kMinIdentifierLength = 3;
+
+} // namespace
+
+void IdentifierIndex::Reset() {
+    m_entries.clear();
+    m_built = false;
+    m_version = UINT64_MAX;
+    m_editInSync = false;
+    m_emptied.clear();
+}
+
+void IdentifierIndex::BeginEdit(const TextDocument& document, size_t offset, size_t removedLength) {
+    m_editInSync = m_built && m_version == document.Version();
+    if (!m_editInSync) {
+        m_built = false;
+        return;
+    }
+    m_editFirstLine = document.LineFromOffset(offset);
+    CountLines(document, m_editFirstLine, document.LineFromOffset(offset + removedLength), -1, 0, 0);
+}
+
+void IdentifierIndex::EndEdit(const TextDocument& document, size_t offset, size_t insertedLength) {
+    if (!m_editInSync) {
+        return;
+    }
+    m_editInSync = false;
+    ++m_editSerial;
+    // Lines before the edit keep their numbers, so the first touched line is the same.
+    CountLines(
+        document, m_editFirstLine, document.LineFromOffset(offset + insertedLength), 1, offset, offset + insertedLength);
+
+    // Dropped only after the re-count, so identifiers still on the edited lines keep
+    // their entry and recency.
+    for (const std::string& key : m_emptied) {
+        const auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.count == 0) {
+            m_entries.erase(it);
+        }
+    }
+    m_emptied.clear();
+    m_version = document.Version();
+}
+
+void IdentifierIndex::Complete(
+    const TextDocument& document,
+    const FuzzyMatcher& query,
+    size_t limit,
+    std::vector<std::string>& out) {
+    if (!m_built || m_version != document.Version()) {
+        Rebuild(document);
+    }
+
+    // Every identifier is a candidate: a document has thousands, not millions, and
+    // Filter drops the non-matching ones a few nanoseconds each.
+    m_candidates.clear();
+    m_names.clear();
+    for (const auto& entry : m_entries) {
+        m_candidates.push_back(&entry);
+        m_names.push_back(entry.first);
+    }
+    std::vector<uint32_t> hits;
+    query.Filter(m_names, hits);
+
+    using Match = std::pair<int, const std::pair<const std::string, Entry>*>;
+    std::vector<Match> matches;
+    for (const uint32_t index : hits) {
+        if (m_names[index] != query.Query()) {
+            matches.emplace_back(query.Score(m_names[index]), m_candidates[index]);
+        }
+    }
+
+    const auto better = [](const Match& a, const Match& b) {
+        if (a.first != b.first) return a.first > b.first;
+        if (a.second->second.lastEdit != b.second->second.lastEdit) {
+            return a.second->second.lastEdit > b.second->second.lastEdit;
+        }
+        if (a.second->second.count != b.second->second.count) return a.second->second.count > b.second->second.count;
+        return a.second->first < b.second->first;
+    };
+    const size_t count = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(count), matches.end(), better);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(matches[i].second->first);
+    }
+}
+
+void IdentifierIndex::Rebuild(const TextDocument& document) {
+    m_entries.clear();
+    m_emptied.clear();
+    const std::string& text = document.Text();
+    m_runs.clear();
+    CollectIdentifierRuns(text, kMinIdentifierLength, m_runs);
+    for (const ByteRun& run : m_runs) {
+        const std::string_view name(text.data() + run.start, run.end - run.start);
+        auto it = m_entries.find(name);
+        if (it == m_entries.end()) {
+            it = m_entries.emplace(std::string(name), Entry()).first;
+        }
+        ++it->second.count;
+    }
+    m_built = true;
+    m_version = document.Version();
+}
+
+void IdentifierIndex::CountLines(
+    const TextDocument& document,
+    size_t firstLine,
+    size_t lastLine,
+    int delta,
+    size_t touchedStart,
+    size_t touchedEnd) {
+    const size_t start = document.LineStart(firstLine);
+    const std::string text = document.Substr(start, document.LineEnd(lastLine) - start);
+    m_runs.clear();
+    CollectIdentifierRuns(text, kMinIdentifierLength, m_runs);
+    for (const ByteRun& run : m_runs) {
+        const std::string_view name(text.data() + run.start, run.end - run.start);
+        auto it = m_entries.find(name);
+        if (delta < 0) {
+            if (it != m_entries.end() && it->second.count > 0 && --it->second.count == 0) {
+                m_emptied.push_back(it->first);
+            }
+            continue;
+        }
+        if (it == m_entries.end()) {
+            it = m_entries.emplace(std::string(name), Entry()).first;
+        }
+        ++it->second.count;
+        // The identifier being typed (or edited) counts as recent.
+        if (start + run.start <= touchedEnd && start + run.end >= touchedStart) {
+            it->second.lastEdit = m_editSerial;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "CharScan.h"
+#include "FuzzyMatch.h"
+#include "TextDocument.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Identifiers of one document (runs of at least three identifier bytes) with their
+// occurrence counts, for local completion. Built from the whole text on first use,
+// then kept current by re-tokenizing only the lines each edit touches: BeginEdit
+// before the change is applied, EndEdit after it. Any other change of document
+// version triggers a rebuild.
+class IdentifierIndex {
+public:
+    void Reset();
+
+    // Same arguments as the TextChange being applied.
+    void BeginEdit(const TextDocument& document, size_t offset, size_t removedLength);
+    void EndEdit(const TextDocument& document, size_t offset, size_t insertedLength);
+
+    // Appends up to `limit` identifiers matching `query` other than the query itself:
+    // best match first, then most recently typed, most frequent, alphabetical.
+    void Complete(const TextDocument& document, const FuzzyMatcher& query, size_t limit, std::vector<std::string>& out);
+
+    size_t Size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        uint32_t count = 0;
+        uint64_t lastEdit = 0; // serial of the last edit that inserted it; 0 = loaded
+    };
+
+    void Rebuild(const TextDocument& document);
+    // Adds `delta` (+1 or -1) occurrences for every identifier on lines [firstLine,
+    // lastLine]; added ones overlapping [touchedStart, touchedEnd] become the most recent.
+    void CountLines(
+        const TextDocument& document,
+        size_t firstLine,
+        size_t lastLine,
+        int delta,
+        size_t touchedStart,
+        size_t touchedEnd);
+
+    std::map<std::string, Entry, std::less<>> m_entries;
+    bool m_built = false;
+    uint64_t m_version = UINT64_MAX; // document version the entries describe
+    uint64_t m_editSerial = 0;
+    size_t m_editFirstLine = 0;
+    bool m_editInSync = false;
+    std::vector<std::string> m_emptied; // count dropped to 0 in BeginEdit
+    std::vector<ByteRun> m_runs;
+    std::vector<const std::pair<const std::string, Entry>*> m_candidates;
+    std::vector<std::string_view> m_names;
+};
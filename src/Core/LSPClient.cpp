@@ -1,4 +1,6 @@
 #include "LSPClient.h"
+#include "LSPFramer.h"
+#include "LSPMessage.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -8,6 +10,22 @@ using json = nlohmann::json;
 
 namespace {
 
+struct RequestLimits {
+    size_t maxInFlight; // 0: unbounded
+    std::chrono::milliseconds timeout;
+};
+
+// A new completion supersedes the previous one; anything unanswered past its
+// timeout is cancelled and its handler failed.
+RequestLimits limitsForMethod(const std::string& method) {
+    if (method == "textDocument/completion" || method == "textDocument/hover") {
+        return {1, std::chrono::seconds(5)};
+    }
+    return {0, std::chrono::seconds(60)};
+}
+
+constexpr std::chrono::milliseconds kTimeoutSweepInterval(250);
+
 bool isUnreservedUriChar(unsigned char ch) {
     return (std::isalnum(ch) != 0) || ch == '-' || ch == '.' || ch == '_' || ch == '~';
 }
@@ -31,7 +49,8 @@ std::string encodeUriPath(const std::string& path) {
 
 std::string fileUriFromPath(std::string path) {
     std::replace(path.begin(), path.end(), '\\', '/');
-    return "file:///" + encodeUriPath(path);
+    // POSIX paths already start with the root slash.
+    return (!path.empty() && path[0] == '/' ? "file://" : "file:///") + encodeUriPath(path);
 }
 
 } // namespace
@@ -43,39 +62,32 @@ LSPClient::~LSPClient() {
 }
 
 bool LSPClient::Start(const std::string& clangdPath) {
-#ifdef _WIN32
-    SECURITY_ATTRIBUTES saAttr;
-    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
-    saAttr.bInheritHandle = TRUE;
-    saAttr.lpSecurityDescriptor = NULL;
-
-    if (!CreatePipe(&m_hChildStdOutRead, &m_hChildStdOutWrite, &saAttr, 0)) return false;
-    if (!SetHandleInformation(m_hChildStdOutRead, HANDLE_FLAG_INHERIT, 0)) return false;
-
-    if (!CreatePipe(&m_hChildStdInRead, &m_hChildStdInWrite, &saAttr, 0)) return false;
-    if (!SetHandleInformation(m_hChildStdInWrite, HANDLE_FLAG_INHERIT, 0)) return false;
-
-    STARTUPINFOA siStartInfo;
-    ZeroMemory(&siStartInfo, sizeof(STARTUPINFOA));
-    siStartInfo.cb = sizeof(STARTUPINFOA);
-    siStartInfo.hStdError = m_hChildStdOutWrite;
-    siStartInfo.hStdOutput = m_hChildStdOutWrite;
-    siStartInfo.hStdInput = m_hChildStdInRead;
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
-
-    ZeroMemory(&m_pi, sizeof(PROCESS_INFORMATION));
-
-    std::string cmd = "\"" + clangdPath + "\" --log=error --background-index --query-driver=* --header-insertion=never";
-    if (!CreateProcessA(NULL, (LPSTR)cmd.c_str(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &siStartInfo, &m_pi)) {
+    if (m_running) return true;
+
+    m_transport = CreateLSPTransport();
+    if (!m_transport || !m_transport->Start({clangdPath, "--log=error", "--background-index", "--query-driver=*", "--header-insertion=never"})) {
+        m_transport.reset();
         return false;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        m_outbox.clear();
+        m_pendingDidChanges.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_handlersMutex);
+        m_responseHandlers.clear();
+        m_inFlight = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_dispatchQueue.clear();
+    }
     m_running = true;
     m_readThread = std::thread(&LSPClient::ReadLoop, this);
+    m_writeThread = std::thread(&LSPClient::WriteLoop, this);
     return true;
-#else
-    return false; // Implementacja dla innych systemów jeśli potrzebna
-#endif
 }
 
 void LSPClient::Stop() {
@@ -83,59 +95,68 @@ void LSPClient::Stop() {
     if (!m_running.compare_exchange_strong(expected, false)) return; // Already stopped
     
     std::cout << "[LSP] Stopping clangd..." << std::endl;
-    
-#ifdef _WIN32
-    // Terminate the process immediately
-    std::cout << "[LSP] Terminating process..." << std::endl;
-    if (m_pi.hProcess) {
-        TerminateProcess(m_pi.hProcess, 0);
-        std::cout << "[LSP] Process terminated, closing process handles..." << std::endl;
-        CloseHandle(m_pi.hProcess);
-        CloseHandle(m_pi.hThread);
-        m_pi.hProcess = NULL;
-        m_pi.hThread = NULL;
-        std::cout << "[LSP] Process handles closed." << std::endl;
-    }
-    
-    // Close WRITE handles only - this stops communication but allows ReadLoop to finish safely
-    std::cout << "[LSP] Closing write pipe handles..." << std::endl;
-    if (m_hChildStdInWrite) { 
-        CloseHandle(m_hChildStdInWrite); 
-        m_hChildStdInWrite = NULL; 
-    }
-    if (m_hChildStdOutWrite) { 
-        CloseHandle(m_hChildStdOutWrite); 
-        m_hChildStdOutWrite = NULL; 
+    m_outboxCv.notify_all();
+
+    // Terminates the process and wakes both I/O threads, so they can be joined
+    // before the transport (and its pipe handles) is destroyed.
+    m_transport->Stop();
+    if (m_writeThread.joinable()) {
+        m_writeThread.join();
     }
-    std::cout << "[LSP] Write handles closed." << std::endl;
-    
-    // DON'T close read handles here - let ReadLoop exit naturally and clean up in destructor
-    // The read handles will be closed when ReadFile fails due to terminated process
-#endif
-    
-    // Detach the thread - it will exit naturally when ReadFile fails
-    std::cout << "[LSP] Detaching thread..." << std::endl;
     if (m_readThread.joinable()) {
-        m_readThread.detach();
+        m_readThread.join();
+    }
+    m_transport.reset();
+    // Results the reader queued before it stopped belong to the old session; run
+    // by DispatchPending() they would refill state the caller just cleared.
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_dispatchQueue.clear();
     }
-    std::cout << "[LSP] Thread detached." << std::endl;
     
     std::cout << "[LSP] clangd stopped." << std::endl;
 }
 
+void LSPClient::SetChangeCoalesceWindow(std::chrono::milliseconds window) {
+    std::lock_guard<std::mutex> lock(m_outboxMutex);
+    m_changeWindow = std::clamp(window, std::chrono::milliseconds(0), std::chrono::milliseconds(1000));
+}
+
 void LSPClient::Initialize(const std::string& rootPath) {
     std::string path = rootPath;
     std::replace(path.begin(), path.end(), '\\', '/');
     json params = {
-        {"processId", GetCurrentProcessId()},
+        {"processId", CurrentProcessId()},
         {"rootPath", path},
         {"rootUri", fileUriFromPath(path)},
-        {"capabilities", json::object()},
+        {"capabilities", {
+            {"textDocument", {
+                {"synchronization", {{"dynamicRegistration", false}}}
+            }}
+        }},
         {"initializationOptions", {
             {"fallbackFlags", json::array({"-std=c++20", "-xc++"})}
         }}
     };
-    SendRequest("initialize", params);
+    m_incrementalSync = false;
+    ResponseHandler handler;
+    handler.onResponse = [this](const LSPMessage& message, std::string_view body) {
+        const json result = LSPResultDecoder<json>::Decode(message, body);
+        // textDocumentSync is either a TextDocumentSyncKind or TextDocumentSyncOptions.
+        if (!result.is_object() || !result.contains("capabilities")) return;
+        const json& capabilities = result["capabilities"];
+        if (!capabilities.is_object() || !capabilities.contains("textDocumentSync")) return;
+        const json& sync = capabilities["textDocumentSync"];
+        int kind = 0;
+        if (sync.is_number_integer()) {
+            kind = sync.get<int>();
+        } else if (sync.is_object()) {
+            kind = sync.value("change", 0);
+        }
+        m_incrementalSync = (kind == 2);
+        std::cout << "[LSP] Text sync kind: " << kind << std::endl;
+    };
+    SendRequest("initialize", params, std::move(handler));
     SendNotification("initialized", json::object());
 }
 
@@ -144,6 +165,11 @@ void LSPClient::DidOpen(const std::string& uri, const std::string& text) {
     std::replace(path.begin(), path.end(), '\\', '/');
     const std::string documentUri = fileUriFromPath(path);
     std::cout << "[LSP] DidOpen: " << documentUri << " (" << text.length() << " bytes)" << std::endl;
+    {
+        // didOpen carries the whole text, so changes still waiting to be merged are moot.
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        m_pendingDidChanges.erase(path);
+    }
     {
         std::lock_guard<std::mutex> lock(m_documentVersionsMutex);
         m_documentVersions[path] = 1;
@@ -159,32 +185,47 @@ void LSPClient::DidOpen(const std::string& uri, const std::string& text) {
     SendNotification("textDocument/didOpen", params);
 }
 
+int LSPClient::NextDocumentVersion(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_documentVersionsMutex);
+    int& currentVersion = m_documentVersions[path];
+    if (currentVersion <= 0) {
+        currentVersion = 1;
+    }
+    currentVersion += 1;
+    return currentVersion;
+}
+
 void LSPClient::DidChange(const std::string& uri, const std::string& text) {
     std::string path = uri;
     std::replace(path.begin(), path.end(), '\\', '/');
     const std::string documentUri = fileUriFromPath(path);
-    int nextVersion = 2;
-    {
-        std::lock_guard<std::mutex> lock(m_documentVersionsMutex);
-        int& currentVersion = m_documentVersions[path];
-        if (currentVersion <= 0) {
-            currentVersion = 1;
-        }
-        currentVersion += 1;
-        nextVersion = currentVersion;
+    QueueDidChange(path, documentUri, json::array({{{"text", text}}}), true);
+}
+
+void LSPClient::DidChange(const std::string& uri, const std::vector<LSPContentChange>& changes) {
+    if (changes.empty()) return;
+    std::string path = uri;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    const std::string documentUri = fileUriFromPath(path);
+    json contentChanges = json::array();
+    for (const LSPContentChange& change : changes) {
+        contentChanges.push_back({
+            {"range", {
+                {"start", {{"line", change.startLine}, {"character", change.startCharacter}}},
+                {"end", {{"line", change.endLine}, {"character", change.endCharacter}}}
+            }},
+            {"text", change.text}
+        });
     }
-    json params = {
-        {"textDocument", {
-            {"uri", documentUri},
-            {"version", nextVersion}
-        }},
-        {"contentChanges", json::array({{{"text", text}}})}
-    };
-    SendNotification("textDocument/didChange", params);
+    QueueDidChange(path, documentUri, std::move(contentChanges), false);
 }
 
-void LSPClient::RequestCompletion(const std::string& uri, int line, int character, std::function<void(const std::vector<LSPCompletionItem>&)> cb) {
-    int id = m_nextId++;
+void LSPClient::RequestCompletion(
+    const std::string& uri,
+    int line,
+    int character,
+    std::function<void(const LSPCompletionList&)> cb,
+    std::function<void()> onFailed) {
     std::string path = uri;
     std::replace(path.begin(), path.end(), '\\', '/');
     const std::string documentUri = fileUriFromPath(path);
@@ -194,56 +235,109 @@ void LSPClient::RequestCompletion(const std::string& uri, int line, int characte
         {"position", {{"line", line}, {"character", character}}}
     };
 
+    std::cout << "[LSP] Sending completion request at " << line << ":" << character << std::endl;
+    Request<LSPCompletionList>("textDocument/completion", std::move(params), std::move(cb), std::move(onFailed));
+}
+
+void LSPClient::CancelRequests(const std::string& method) {
+    std::vector<int> cancelled;
+    std::vector<ResponseHandler> failed;
     {
         std::lock_guard<std::mutex> lock(m_handlersMutex);
-        m_responseHandlers[id] = [cb](const json& result) {
-            try {
-                std::vector<LSPCompletionItem> items;
-                json list;
-                if (result.is_array()) {
-                    list = result;
-                } else if (result.is_object() && result.contains("items") && result["items"].is_array()) {
-                    list = result["items"];
-                } else {
-                    cb(items);
-                    return;
-                }
+        for (auto it = m_responseHandlers.begin(); it != m_responseHandlers.end();) {
+            if (it->second.method == method) {
+                cancelled.push_back(it->first);
+                failed.push_back(std::move(it->second));
+                it = m_responseHandlers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_inFlight = m_responseHandlers.size();
+    }
+    for (int id : cancelled) {
+        SendCancel(id);
+    }
+    FailRequests(failed);
+}
+
+void LSPClient::SendCancel(int id) {
+    SendNotification("$/cancelRequest", {{"id", id}});
+}
+
+void LSPClient::FailRequests(std::vector<ResponseHandler>& handlers) {
+    for (ResponseHandler& handler : handlers) {
+        if (handler.onFailure) handler.onFailure();
+    }
+    handlers.clear();
+}
+
+void LSPClient::ExpireRequests() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<int> expired;
+    std::vector<ResponseHandler> failed;
+    {
+        std::lock_guard<std::mutex> lock(m_handlersMutex);
+        for (auto it = m_responseHandlers.begin(); it != m_responseHandlers.end();) {
+            if (it->second.deadline <= now) {
+                std::cout << "[LSP] Request " << it->first << " (" << it->second.method << ") timed out" << std::endl;
+                expired.push_back(it->first);
+                failed.push_back(std::move(it->second));
+                it = m_responseHandlers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_inFlight = m_responseHandlers.size();
+    }
+    for (int id : expired) {
+        SendCancel(id);
+    }
+    FailRequests(failed);
+}
 
-                std::cout << "[LSP] Received completion result with " << list.size() << " items" << std::endl;
-                for (auto& i : list) {
-                    LSPCompletionItem item;
-                    item.label = i.value("label", "???");
-                    item.detail = i.value("detail", "");
-                    item.insertText = i.value("insertText", item.label);
-                    items.push_back(item);
+int LSPClient::SendRequest(const std::string& method, json params, ResponseHandler handler) {
+    const RequestLimits limits = limitsForMethod(method);
+    const int id = m_nextId++;
+    std::vector<int> superseded;
+    std::vector<ResponseHandler> failed;
+    {
+        std::lock_guard<std::mutex> lock(m_handlersMutex);
+        if (limits.maxInFlight > 0) {
+            // Map order is id order, so the oldest requests of this method go first.
+            size_t active = 0;
+            for (const auto& entry : m_responseHandlers) {
+                if (entry.second.method == method) ++active;
+            }
+            for (auto it = m_responseHandlers.begin(); it != m_responseHandlers.end() && active >= limits.maxInFlight;) {
+                if (it->second.method == method) {
+                    superseded.push_back(it->first);
+                    failed.push_back(std::move(it->second));
+                    it = m_responseHandlers.erase(it);
+                    --active;
+                } else {
+                    ++it;
                 }
-                cb(items);
-            } catch (const std::exception& e) {
-                std::cerr << "[LSP] Exception in completion handler: " << e.what() << std::endl;
-            } catch (...) {
-                std::cerr << "[LSP] Unknown exception in completion handler" << std::endl;
             }
-        };
+        }
+        handler.method = method;
+        handler.deadline = std::chrono::steady_clock::now() + limits.timeout;
+        m_responseHandlers[id] = std::move(handler);
+        m_inFlight = m_responseHandlers.size();
     }
+    for (int cancelledId : superseded) {
+        SendCancel(cancelledId);
+    }
+    FailRequests(failed);
 
-    std::cout << "[LSP] Sending completion request at " << line << ":" << character << std::endl;
     json req = {
         {"jsonrpc", "2.0"},
         {"id", id},
-        {"method", "textDocument/completion"},
-        {"params", params}
-    };
-    WriteToPipe(req.dump());
-}
-
-void LSPClient::SendRequest(const std::string& method, json params) {
-    json req = {
-        {"jsonrpc", "2.0"},
-        {"id", m_nextId++},
         {"method", method},
         {"params", params}
     };
-    WriteToPipe(req.dump());
+    QueueMessage(req);
+    return id;
 }
 
 void LSPClient::SendNotification(const std::string& method, json params) {
@@ -252,101 +346,178 @@ void LSPClient::SendNotification(const std::string& method, json params) {
         {"method", method},
         {"params", params}
     };
-    WriteToPipe(notif.dump());
+    QueueMessage(notif);
+}
+
+void LSPClient::QueueMessage(const json& message) {
+    const std::string body = message.dump();
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        FlushPendingChangesLocked(false);
+        m_outbox.push_back("Content-Length: " + std::to_string(body.length()) + "\r\n\r\n" + body);
+    }
+    m_outboxCv.notify_one();
+}
+
+void LSPClient::QueueDidChange(const std::string& path, const std::string& documentUri, json contentChanges, bool replacesAll) {
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        auto [it, inserted] = m_pendingDidChanges.try_emplace(path);
+        PendingDidChange& pending = it->second;
+        if (inserted) {
+            pending.documentUri = documentUri;
+            pending.firstQueued = std::chrono::steady_clock::now();
+        }
+        if (replacesAll) {
+            pending.contentChanges = std::move(contentChanges);
+        } else {
+            for (json& change : contentChanges) {
+                pending.contentChanges.push_back(std::move(change));
+            }
+        }
+    }
+    m_outboxCv.notify_one();
+}
+
+void LSPClient::FlushPendingChangesLocked(bool dueOnly) {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_pendingDidChanges.begin(); it != m_pendingDidChanges.end();) {
+        if (dueOnly && now < it->second.firstQueued + m_changeWindow) {
+            ++it;
+            continue;
+        }
+        json notif = {
+            {"jsonrpc", "2.0"},
+            {"method", "textDocument/didChange"},
+            {"params", {
+                {"textDocument", {
+                    {"uri", it->second.documentUri},
+                    {"version", NextDocumentVersion(it->first)}
+                }},
+                {"contentChanges", std::move(it->second.contentChanges)}
+            }}
+        };
+        const std::string body = notif.dump();
+        m_outbox.push_back("Content-Length: " + std::to_string(body.length()) + "\r\n\r\n" + body);
+        it = m_pendingDidChanges.erase(it);
+    }
+}
+
+void LSPClient::WriteLoop() {
+    std::deque<std::string> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_outboxMutex);
+            if (m_running && m_outbox.empty()) {
+                // Wake for the next coalesced didChange, and periodically while requests
+                // are in flight so timed-out ones get cancelled.
+                auto deadline = std::chrono::steady_clock::time_point::max();
+                if (m_inFlight > 0) {
+                    deadline = std::chrono::steady_clock::now() + kTimeoutSweepInterval;
+                }
+                for (const auto& entry : m_pendingDidChanges) {
+                    deadline = std::min(deadline, entry.second.firstQueued + m_changeWindow);
+                }
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    m_outboxCv.wait(lock);
+                } else {
+                    m_outboxCv.wait_until(lock, deadline);
+                }
+            }
+            if (!m_running) break;
+            FlushPendingChangesLocked(true);
+            batch.swap(m_outbox);
+        }
+
+        ExpireRequests();
+        for (const std::string& message : batch) {
+            WriteToPipe(message);
+        }
+        batch.clear();
+    }
 }
 
 void LSPClient::WriteToPipe(const std::string& data) {
-    if (!m_running || !m_hChildStdInWrite) return;
-    std::string header = "Content-Length: " + std::to_string(data.length()) + "\r\n\r\n";
-    std::string full = header + data;
-    DWORD written;
-    if (!WriteFile(m_hChildStdInWrite, full.c_str(), (DWORD)full.length(), &written, NULL)) {
+    if (!m_running) return;
+    if (!m_transport->Write(data.data(), data.size())) {
         // Log error if needed
     }
 }
 
 void LSPClient::ReadLoop() {
-    char buffer[4096];
-    std::string leftover;
+    LSPFramer framer;
     while (m_running) {
-        // Check if handle is still valid
-        if (!m_hChildStdOutRead) break;
-        
-        DWORD read;
-        if (!ReadFile(m_hChildStdOutRead, buffer, sizeof(buffer) - 1, &read, NULL) || read == 0) break;
-        buffer[read] = '\0';
-        leftover += std::string(buffer, read);
-
-        while (true) {
-            size_t pos = leftover.find("Content-Length: ");
-            if (pos == std::string::npos) break;
-            size_t endHeader = leftover.find("\r\n\r\n", pos);
-            if (endHeader == std::string::npos) break;
-
-            int len = 0;
-            try {
-                len = std::stoi(leftover.substr(pos + 16, endHeader - (pos + 16)));
-            } catch (...) {
-                // Uszkodzony nagłówek - usuń i kontynuuj
-                leftover.erase(0, endHeader + 4);
-                continue;
-            }
-            if (len <= 0 || leftover.length() < endHeader + 4 + len) break;
-
-            std::string body = leftover.substr(endHeader + 4, len);
-            leftover.erase(0, endHeader + 4 + len);
-
-            try {
-                json msg = json::parse(body);
-                if (msg.contains("method") && msg["method"] == "textDocument/publishDiagnostics") {
-                    if (msg.contains("params") && msg["params"].is_object()) {
-                        auto params = msg["params"];
-                        if (params.contains("uri") && params["uri"].is_string()) {
-                            std::string uri = params["uri"];
-                            std::vector<LSPDiagnostic> diags;
-                            if (params.contains("diagnostics") && params["diagnostics"].is_array()) {
-                                for (auto& d : params["diagnostics"]) {
-                                    if (d.contains("range") && d["range"].is_object()) {
-                                        LSPDiagnostic ld;
-                                        ld.line = d["range"]["start"]["line"];
-                                        ld.range_start = d["range"]["start"]["character"];
-                                        ld.range_end = d["range"]["end"]["character"];
-                                        ld.message = d.value("message", "");
-                                        ld.severity = d.value("severity", 1);
-                                        diags.push_back(ld);
-                                    }
-                                }
-                            }
-                            if (m_diagCallback) m_diagCallback(uri, diags);
-                        }
-                    }
-                } else if (msg.contains("id") && (msg["id"].is_number() || msg["id"].is_string())) {
-                    // LSP może zwracać ID jako liczbę lub string
-                    int id = -1;
-                    if (msg["id"].is_number()) id = msg["id"];
-                    else if (msg["id"].is_string()) {
-                        try { id = std::stoi(msg["id"].get<std::string>()); } catch(...) {}
-                    }
-                    
-                    if (id != -1) {
-                        std::function<void(const json&)> handler;
-                        {
-                            std::lock_guard<std::mutex> lock(m_handlersMutex);
-                            if (m_responseHandlers.count(id)) {
-                                handler = m_responseHandlers[id];
-                                m_responseHandlers.erase(id);
-                            }
-                        }
-                        if (handler && msg.contains("result")) {
-                            handler(msg["result"]);
-                        }
-                    }
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "[LSP] Error parsing message body: " << e.what() << std::endl;
-            } catch (...) {
-                std::cerr << "[LSP] Unknown error parsing message body" << std::endl;
-            }
+        const size_t readSize = framer.SuggestedReadSize();
+        const long read = m_transport->Read(framer.PrepareWrite(readSize), readSize);
+        if (read <= 0) break;
+        framer.Commit(static_cast<size_t>(read));
+
+        std::string_view body;
+        while (framer.Next(body)) {
+            HandleMessage(body);
+        }
+    }
+}
+
+void LSPClient::HandleMessage(std::string_view body) {
+    // Hot messages (diagnostics, completion) are decoded selectively; only responses
+    // with a generic handler (e.g. initialize) pay for a full DOM parse.
+    LSPMessage msg;
+    if (!DecodeLSPMessage(body, msg)) {
+        std::cerr << "[LSP] Error parsing message body (" << body.size() << " bytes)" << std::endl;
+        return;
+    }
+
+    if (msg.method == "textDocument/publishDiagnostics") {
+        if (!msg.uri.empty() && m_diagCallback) {
+            Post([this, uri = std::move(msg.uri), diagnostics = std::move(msg.diagnostics)]() {
+                if (m_diagCallback) m_diagCallback(uri, diagnostics);
+            });
+        }
+        return;
+    }
+    // LSP może zwracać ID jako liczbę lub string
+    if (!msg.method.empty() || !msg.hasId || msg.id == -1) return;
+
+    ResponseHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_handlersMutex);
+        auto it = m_responseHandlers.find(msg.id);
+        if (it == m_responseHandlers.end()) return;
+        handler = std::move(it->second);
+        m_responseHandlers.erase(it);
+        m_inFlight = m_responseHandlers.size();
+    }
+    if (!msg.hasResult) {
+        if (handler.onFailure) handler.onFailure();
+        return;
+    }
+
+    try {
+        if (handler.onResponse) handler.onResponse(msg, body);
+    } catch (const std::exception& e) {
+        std::cerr << "[LSP] Exception in response handler: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "[LSP] Unknown exception in response handler" << std::endl;
+    }
+}
+
+void LSPClient::Post(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_dispatchMutex);
+    m_dispatchQueue.push_back(std::move(callback));
+}
+
+void LSPClient::DispatchPending() {
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        callbacks.swap(m_dispatchQueue);
+    }
+    for (const auto& callback : callbacks) {
+        try {
+            callback();
+        } catch (const std::exception& e) {
+            std::cerr << "[LSP] Exception in response callback: " << e.what() << std::endl;
         }
     }
 }
@@ -1,29 +1,41 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <queue>
 #include <json.hpp>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
 #include <map>
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-struct LSPDiagnostic {
-    int line;
-    int range_start;
-    int range_end;
-    std::string message;
-    int severity; // 1: Error, 2: Warning
+#include <memory>
+#include "LSPMessage.h"
+#include "LSPTransport.h"
+#include "LSPTypes.h"
+
+// Turns a decoded response into the result type of LSPClient::Request<Result>.
+// Specialize for new result types; nlohmann::json works for any method.
+template <typename Result>
+struct LSPResultDecoder;
+
+template <>
+struct LSPResultDecoder<nlohmann::json> {
+    static nlohmann::json Decode(const LSPMessage&, std::string_view body) {
+        nlohmann::json message = nlohmann::json::parse(body.begin(), body.end());
+        return message.contains("result") ? std::move(message["result"]) : nlohmann::json();
+    }
 };
 
-struct LSPCompletionItem {
-    std::string label;
-    std::string detail;
-    std::string insertText;
+template <>
+struct LSPResultDecoder<LSPCompletionList> {
+    static LSPCompletionList Decode(const LSPMessage& message, std::string_view) {
+        return LSPCompletionList{message.completionItems, message.completionIncomplete};
+    }
 };
 
 class LSPClient {
@@ -32,40 +44,133 @@ public:
     ~LSPClient();
 
     bool Start(const std::string& clangdPath = "clangd");
+    // Also drops callbacks still queued for DispatchPending().
     void Stop();
     bool IsRunning() const { return m_running; }
 
+    // didChange notifications for a document are merged for this long before being
+    // written; any other outgoing message flushes them first to keep ordering.
+    void SetChangeCoalesceWindow(std::chrono::milliseconds window);
+
     void Initialize(const std::string& rootPath);
     void DidOpen(const std::string& uri, const std::string& text);
     void DidChange(const std::string& uri, const std::string& text);
+    void DidChange(const std::string& uri, const std::vector<LSPContentChange>& changes);
+
+    // True once the server has announced TextDocumentSyncKind::Incremental.
+    bool SupportsIncrementalSync() const { return m_incrementalSync; }
+
+    // Sends `method` and delivers the decoded result to `onResult` from DispatchPending()
+    // on the UI thread. Error responses, cancelled, superseded and timed-out requests
+    // run `onFailed` there instead; requests still in flight at Stop() run neither.
+    template <typename Result>
+    int Request(
+        const std::string& method,
+        nlohmann::json params,
+        std::function<void(const Result&)> onResult,
+        std::function<void()> onFailed = nullptr);
+
+    // Same, resolved on the reader thread; the future throws std::future_error
+    // (broken_promise) if the request fails, is cancelled or times out.
+    template <typename Result>
+    std::future<Result> RequestFuture(const std::string& method, nlohmann::json params);
+
+    // Runs queued response and diagnostics callbacks; call once per frame.
+    void DispatchPending();
 
     // Completion
-    void RequestCompletion(const std::string& uri, int line, int character, std::function<void(const std::vector<LSPCompletionItem>&)> cb);
+    void RequestCompletion(
+        const std::string& uri,
+        int line,
+        int character,
+        std::function<void(const LSPCompletionList&)> cb,
+        std::function<void()> onFailed = nullptr);
+
+    // Drops handlers of in-flight requests for `method` and sends $/cancelRequest.
+    void CancelRequests(const std::string& method);
 
-    // Diagnostics callback
+    // Diagnostics callback, run from DispatchPending()
     void SetDiagnosticsCallback(std::function<void(const std::string&, const std::vector<LSPDiagnostic>&)> cb);
 
 private:
-    void SendRequest(const std::string& method, nlohmann::json params);
+    struct ResponseHandler {
+        std::string method;
+        std::chrono::steady_clock::time_point deadline;
+        // Runs on the reader thread, only for responses carrying a result.
+        std::function<void(const LSPMessage&, std::string_view body)> onResponse;
+        // Runs for requests that end without a result, outside m_handlersMutex.
+        std::function<void()> onFailure;
+    };
+
+    int SendRequest(const std::string& method, nlohmann::json params, ResponseHandler handler);
+    void SendCancel(int id);
+    void ExpireRequests();
+    static void FailRequests(std::vector<ResponseHandler>& handlers);
+    int NextDocumentVersion(const std::string& path);
     void SendNotification(const std::string& method, nlohmann::json params);
+    void QueueMessage(const nlohmann::json& message);
+    void QueueDidChange(const std::string& path, const std::string& documentUri, nlohmann::json contentChanges, bool replacesAll);
+    void FlushPendingChangesLocked(bool dueOnly);
     void WriteToPipe(const std::string& data);
+    void WriteLoop();
     void ReadLoop();
+    void HandleMessage(std::string_view body);
+    void Post(std::function<void()> callback);
+
+    struct PendingDidChange {
+        std::string documentUri;
+        nlohmann::json contentChanges = nlohmann::json::array();
+        std::chrono::steady_clock::time_point firstQueued;
+    };
 
     std::atomic<bool> m_running{false};
+    std::atomic<bool> m_incrementalSync{false};
     std::thread m_readThread;
+    std::thread m_writeThread;
+    std::mutex m_outboxMutex;
+    std::condition_variable m_outboxCv;
+    std::deque<std::string> m_outbox;
+    std::map<std::string, PendingDidChange> m_pendingDidChanges;
+    std::chrono::milliseconds m_changeWindow{100};
     std::function<void(const std::string&, const std::vector<LSPDiagnostic>&)> m_diagCallback;
 
-#ifdef _WIN32
-    HANDLE m_hChildStdInRead = NULL;
-    HANDLE m_hChildStdInWrite = NULL;
-    HANDLE m_hChildStdOutRead = NULL;
-    HANDLE m_hChildStdOutWrite = NULL;
-    PROCESS_INFORMATION m_pi;
-#endif
+    std::unique_ptr<LSPTransport> m_transport;
 
-    int m_nextId = 1;
+    std::atomic<int> m_nextId{1};
     std::mutex m_handlersMutex;
-    std::map<int, std::function<void(const nlohmann::json&)>> m_responseHandlers;
+    std::map<int, ResponseHandler> m_responseHandlers;
+    std::atomic<size_t> m_inFlight{0};
     std::mutex m_documentVersionsMutex;
     std::map<std::string, int> m_documentVersions;
+    std::mutex m_dispatchMutex;
+    std::vector<std::function<void()>> m_dispatchQueue;
 };
+
+template <typename Result>
+int LSPClient::Request(
+    const std::string& method,
+    nlohmann::json params,
+    std::function<void(const Result&)> onResult,
+    std::function<void()> onFailed) {
+    ResponseHandler handler;
+    handler.onResponse = [this, onResult = std::move(onResult)](const LSPMessage& message, std::string_view body) {
+        auto result = std::make_shared<Result>(LSPResultDecoder<Result>::Decode(message, body));
+        Post([onResult, result]() { onResult(*result); });
+    };
+    if (onFailed) {
+        handler.onFailure = [this, onFailed = std::move(onFailed)]() { Post(onFailed); };
+    }
+    return SendRequest(method, std::move(params), std::move(handler));
+}
+
+template <typename Result>
+std::future<Result> LSPClient::RequestFuture(const std::string& method, nlohmann::json params) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    ResponseHandler handler;
+    handler.onResponse = [promise](const LSPMessage& message, std::string_view body) {
+        promise->set_value(LSPResultDecoder<Result>::Decode(message, body));
+    };
+    SendRequest(method, std::move(params), std::move(handler));
+    return future;
+}
@@ -0,0 +1,95 @@
+#include "LSPFramer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kMinReadSize = 64 * 1024;
+constexpr size_t kMaxReadSize = 8 * 1024 * 1024;
+constexpr std::string_view kContentLength = "Content-Length:";
+constexpr std::string_view kHeaderEnd = "\r\n\r\n";
+
+} // namespace
+
+size_t LSPFramer::SuggestedReadSize() const {
+    if (!m_haveHeader) return kMinReadSize;
+    const size_t have = m_end - m_bodyStart;
+    const size_t missing = m_bodyLength > have ? m_bodyLength - have : 0;
+    return std::clamp(missing, kMinReadSize, kMaxReadSize);
+}
+
+char* LSPFramer::PrepareWrite(size_t size) {
+    if (m_buffer.size() - m_end < size) {
+        // Slide unconsumed bytes to the front before growing.
+        const size_t live = m_end - m_begin;
+        if (m_begin > 0) {
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, live);
+            m_bodyStart -= m_haveHeader ? m_begin : 0;
+            m_begin = 0;
+            m_end = live;
+        }
+        if (m_buffer.size() - m_end < size) {
+            m_buffer.resize(std::max(m_end + size, m_buffer.size() * 2));
+        }
+    }
+    return m_buffer.data() + m_end;
+}
+
+void LSPFramer::Commit(size_t size) {
+    m_end = std::min(m_end + size, m_buffer.size());
+}
+
+bool LSPFramer::Next(std::string_view& body) {
+    if (!m_haveHeader && !ParseHeader()) return false;
+    if (m_end - m_bodyStart < m_bodyLength) return false;
+
+    body = std::string_view(m_buffer.data() + m_bodyStart, m_bodyLength);
+    m_begin = m_bodyStart + m_bodyLength;
+    m_haveHeader = false;
+    if (m_begin == m_end) {
+        // Buffer drained: the next read lands at the front, the view stays valid.
+        m_begin = m_end = 0;
+    }
+    return true;
+}
+
+bool LSPFramer::ParseHeader() {
+    while (true) {
+        const std::string_view pending(m_buffer.data() + m_begin, m_end - m_begin);
+        const size_t pos = pending.find(kContentLength);
+        if (pos == std::string_view::npos) {
+            // Drop noise (e.g. stderr on the same pipe), keeping a possible partial header.
+            const size_t keep = std::min(pending.size(), kContentLength.size() - 1);
+            m_begin = m_end - keep;
+            return false;
+        }
+        const size_t headerEnd = pending.find(kHeaderEnd, pos);
+        if (headerEnd == std::string_view::npos) {
+            m_begin += pos;
+            return false;
+        }
+
+        size_t length = 0;
+        bool valid = false;
+        for (size_t i = pos + kContentLength.size(); i < headerEnd; ++i) {
+            const char ch = pending[i];
+            if (ch >= '0' && ch <= '9') {
+                length = length * 10 + static_cast<size_t>(ch - '0');
+                valid = true;
+            } else if (ch != ' ' || valid) {
+                break;
+            }
+        }
+
+        const size_t bodyStart = m_begin + headerEnd + kHeaderEnd.size();
+        if (!valid || length == 0) {
+            // Uszkodzony nagłówek - usuń i kontynuuj
+            m_begin = bodyStart;
+            continue;
+        }
+        m_haveHeader = true;
+        m_bodyStart = bodyStart;
+        m_bodyLength = length;
+        return true;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Splits a JSON-RPC byte stream ("Content-Length: N\r\n\r\n" + body) into message
+// bodies. Bytes are read straight into one growable buffer and bodies are returned
+// as views into it, so a large response is never copied or re-scanned per chunk.
+class LSPFramer {
+public:
+    // How much the next read should ask for: a minimum chunk, or the rest of a
+    // large message whose header has already been parsed.
+    size_t SuggestedReadSize() const;
+
+    // Returns space for at least `size` bytes; invalidates views from Next().
+    char* PrepareWrite(size_t size);
+    void Commit(size_t size);
+
+    // Next complete body, valid until the following PrepareWrite().
+    bool Next(std::string_view& body);
+
+private:
+    bool ParseHeader();
+
+    std::vector<char> m_buffer;
+    size_t m_begin = 0;
+    size_t m_end = 0;
+
+    // Set once a header is parsed, so a body arriving in many chunks is not re-parsed.
+    bool m_haveHeader = false;
+    size_t m_bodyStart = 0;
+    size_t m_bodyLength = 0;
+};
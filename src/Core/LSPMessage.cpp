@@ -0,0 +1,158 @@
+#include "LSPMessage.h"
+#include <initializer_list>
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+// SAX consumer for nlohmann::json. Tracks the current key path and only stores
+// values that land on one of the paths LSPMessage cares about.
+class MessageScanner {
+public:
+    explicit MessageScanner(LSPMessage& out) : m_out(out) {}
+
+    bool null() { return true; }
+    bool binary(json::binary_t&) { return true; }
+
+    bool boolean(bool value) {
+        if (At({"result", "isIncomplete"})) m_out.completionIncomplete = value;
+        return true;
+    }
+
+    bool number_integer(json::number_integer_t value) { return Integer(static_cast<long long>(value)); }
+    bool number_unsigned(json::number_unsigned_t value) { return Integer(static_cast<long long>(value)); }
+    bool number_float(json::number_float_t value, const json::string_t&) { return Integer(static_cast<long long>(value)); }
+
+    bool string(json::string_t& value) {
+        if (At({"method"})) {
+            m_out.method = std::move(value);
+        } else if (At({"id"})) {
+            m_out.hasId = true;
+            try { m_out.id = std::stoi(value); } catch (...) { m_out.id = -1; }
+        } else if (At({"params", "uri"})) {
+            m_out.uri = std::move(value);
+        } else if (m_inDiagnostic && At({"params", "diagnostics", "[]", "message"})) {
+            m_out.diagnostics.back().message = std::move(value);
+        } else if (m_inCompletionItem) {
+            const std::string& field = m_frames.back().key;
+            if (m_frames.size() == m_itemDepth) {
+                LSPCompletionItem& item = m_out.completionItems.back();
+                if (field == "label") item.label = std::move(value);
+                else if (field == "detail") item.detail = std::move(value);
+                else if (field == "insertText") item.insertText = std::move(value);
+            }
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (At({"params", "diagnostics", "[]"})) {
+            m_out.diagnostics.push_back(LSPDiagnostic{0, 0, 0, std::string(), 1});
+            m_diagnosticHasRange.push_back(false);
+            m_inDiagnostic = true;
+        } else if (At({"result", "[]"}) || At({"result", "items", "[]"})) {
+            m_out.completionItems.emplace_back();
+            m_inCompletionItem = true;
+            m_itemDepth = m_frames.size() + 1;
+        } else if (m_inDiagnostic && At({"params", "diagnostics", "[]", "range"})) {
+            m_diagnosticHasRange.back() = true;
+        }
+        m_frames.push_back(Frame{false, std::string()});
+        return true;
+    }
+
+    bool end_object() {
+        m_frames.pop_back();
+        if (m_inCompletionItem && m_frames.size() + 1 == m_itemDepth) {
+            LSPCompletionItem& item = m_out.completionItems.back();
+            if (item.label.empty()) item.label = "???";
+            if (item.insertText.empty()) item.insertText = item.label;
+            m_inCompletionItem = false;
+        } else if (m_inDiagnostic && At({"params", "diagnostics", "[]"})) {
+            m_inDiagnostic = false;
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        m_frames.push_back(Frame{true, std::string()});
+        return true;
+    }
+
+    bool end_array() {
+        m_frames.pop_back();
+        return true;
+    }
+
+    bool key(json::string_t& value) {
+        if (m_frames.size() == 1 && value == "result") m_out.hasResult = true;
+        m_frames.back().key = std::move(value);
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+        return false;
+    }
+
+    // Diagnostics published without a range are dropped, as before.
+    void Finish() {
+        size_t kept = 0;
+        for (size_t i = 0; i < m_out.diagnostics.size(); ++i) {
+            if (!m_diagnosticHasRange[i]) continue;
+            if (kept != i) m_out.diagnostics[kept] = std::move(m_out.diagnostics[i]);
+            ++kept;
+        }
+        m_out.diagnostics.resize(kept);
+    }
+
+private:
+    struct Frame {
+        bool array;
+        std::string key;
+    };
+
+    // Matches the key path of the current position; "[]" stands for any array index.
+    bool At(std::initializer_list<std::string_view> path) const {
+        if (m_frames.size() != path.size()) return false;
+        size_t index = 0;
+        for (std::string_view part : path) {
+            const Frame& frame = m_frames[index++];
+            if (frame.array ? part != "[]" : part != frame.key) return false;
+        }
+        return true;
+    }
+
+    bool Integer(long long value) {
+        if (At({"id"})) {
+            m_out.hasId = true;
+            m_out.id = static_cast<int>(value);
+        } else if (m_inDiagnostic) {
+            LSPDiagnostic& diagnostic = m_out.diagnostics.back();
+            const int number = static_cast<int>(value);
+            if (At({"params", "diagnostics", "[]", "severity"})) diagnostic.severity = number;
+            else if (At({"params", "diagnostics", "[]", "range", "start", "line"})) diagnostic.line = number;
+            else if (At({"params", "diagnostics", "[]", "range", "start", "character"})) diagnostic.range_start = number;
+            else if (At({"params", "diagnostics", "[]", "range", "end", "character"})) diagnostic.range_end = number;
+        }
+        return true;
+    }
+
+    LSPMessage& m_out;
+    std::vector<Frame> m_frames;
+    std::vector<bool> m_diagnosticHasRange;
+    bool m_inDiagnostic = false;
+    bool m_inCompletionItem = false;
+    size_t m_itemDepth = 0;
+};
+
+} // namespace
+
+bool DecodeLSPMessage(std::string_view body, LSPMessage& out) {
+    MessageScanner scanner(out);
+    if (!json::sax_parse(body.begin(), body.end(), &scanner)) {
+        return false;
+    }
+    scanner.Finish();
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LSPTypes.h"
+
+// Fields of an incoming JSON-RPC message that Fin acts on, pulled out in one SAX
+// pass without building a DOM. Only the parts used by LSPDiagnostic and
+// LSPCompletionItem are kept; every other value is skipped.
+struct LSPMessage {
+    std::string method;
+    bool hasId = false;
+    int id = -1;
+    bool hasResult = false;
+
+    // textDocument/publishDiagnostics
+    std::string uri;
+    std::vector<LSPDiagnostic> diagnostics;
+
+    // textDocument/completion (CompletionItem[] or CompletionList)
+    std::vector<LSPCompletionItem> completionItems;
+    bool completionIncomplete = false;
+};
+
+// Returns false on malformed JSON.
+bool DecodeLSPMessage(std::string_view body, LSPMessage& out);
@@ -0,0 +1,307 @@
+#include "LSPTransport.h"
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+
+#ifdef _WIN32
+
+std::string QuoteArgument(const std::string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+        return arg;
+    }
+    std::string quoted = "\"";
+    for (char ch : arg) {
+        if (ch == '"') quoted += '\\';
+        quoted += ch;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+class Win32LSPTransport final : public LSPTransport {
+public:
+    ~Win32LSPTransport() override {
+        Stop();
+        CloseIfOpen(m_stdinWrite);
+        CloseIfOpen(m_stdoutRead);
+    }
+
+    bool Start(const std::vector<std::string>& args) override {
+        if (args.empty()) return false;
+
+        SECURITY_ATTRIBUTES saAttr;
+        saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+        saAttr.bInheritHandle = TRUE;
+        saAttr.lpSecurityDescriptor = NULL;
+
+        HANDLE childStdoutWrite = NULL;
+        HANDLE childStdinRead = NULL;
+        if (!CreatePipe(&m_stdoutRead, &childStdoutWrite, &saAttr, 0)) return false;
+        if (!SetHandleInformation(m_stdoutRead, HANDLE_FLAG_INHERIT, 0)) return false;
+        if (!CreatePipe(&childStdinRead, &m_stdinWrite, &saAttr, 0)) return false;
+        if (!SetHandleInformation(m_stdinWrite, HANDLE_FLAG_INHERIT, 0)) return false;
+
+        STARTUPINFOA siStartInfo;
+        ZeroMemory(&siStartInfo, sizeof(STARTUPINFOA));
+        siStartInfo.cb = sizeof(STARTUPINFOA);
+        siStartInfo.hStdError = childStdoutWrite;
+        siStartInfo.hStdOutput = childStdoutWrite;
+        siStartInfo.hStdInput = childStdinRead;
+        siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+
+        ZeroMemory(&m_pi, sizeof(PROCESS_INFORMATION));
+
+        std::string cmd;
+        for (const std::string& arg : args) {
+            if (!cmd.empty()) cmd += ' ';
+            cmd += QuoteArgument(arg);
+        }
+        const BOOL created = CreateProcessA(NULL, (LPSTR)cmd.c_str(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &siStartInfo, &m_pi);
+
+        // The child owns its ends now; dropping ours lets ReadFile see EOF when it exits.
+        CloseHandle(childStdoutWrite);
+        CloseHandle(childStdinRead);
+        return created != FALSE;
+    }
+
+    void Stop() override {
+        if (m_stopped.exchange(true)) return;
+        if (m_pi.hProcess) {
+            TerminateProcess(m_pi.hProcess, 0);
+            WaitForSingleObject(m_pi.hProcess, 1000);
+            CloseHandle(m_pi.hProcess);
+            CloseHandle(m_pi.hThread);
+            m_pi.hProcess = NULL;
+            m_pi.hThread = NULL;
+        }
+        // Unblocks a ReadFile/WriteFile still waiting on the other threads.
+        if (m_stdoutRead) CancelIoEx(m_stdoutRead, NULL);
+        if (m_stdinWrite) CancelIoEx(m_stdinWrite, NULL);
+    }
+
+    bool Write(const char* data, size_t size) override {
+        while (size > 0 && !m_stopped) {
+            DWORD written = 0;
+            if (!WriteFile(m_stdinWrite, data, (DWORD)size, &written, NULL)) return false;
+            data += written;
+            size -= written;
+        }
+        return size == 0;
+    }
+
+    long Read(char* buffer, size_t capacity) override {
+        if (m_stopped) return 0;
+        DWORD read = 0;
+        if (!ReadFile(m_stdoutRead, buffer, (DWORD)capacity, &read, NULL)) return -1;
+        return (long)read;
+    }
+
+private:
+    static void CloseIfOpen(HANDLE& handle) {
+        if (handle) {
+            CloseHandle(handle);
+            handle = NULL;
+        }
+    }
+
+    HANDLE m_stdinWrite = NULL;
+    HANDLE m_stdoutRead = NULL;
+    PROCESS_INFORMATION m_pi{};
+    std::atomic<bool> m_stopped{false};
+};
+
+#elif defined(__linux__)
+
+void CloseIfOpen(int& fd) {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+// Both pipe ends are non-blocking; each side waits in its own epoll set, which also
+// watches an eventfd so Stop() can wake a thread parked on a silent or full pipe.
+class PosixLSPTransport final : public LSPTransport {
+public:
+    ~PosixLSPTransport() override {
+        Stop();
+        CloseIfOpen(m_stdinWrite);
+        CloseIfOpen(m_stdoutRead);
+        CloseIfOpen(m_readEpoll);
+        CloseIfOpen(m_writeEpoll);
+        CloseIfOpen(m_wakeFd);
+    }
+
+    bool Start(const std::vector<std::string>& args) override {
+        if (args.empty()) return false;
+
+        // A server that dies mid-write must surface as EPIPE, not kill the editor.
+        std::signal(SIGPIPE, SIG_IGN);
+
+        int inPipe[2] = {-1, -1};
+        int outPipe[2] = {-1, -1};
+        if (pipe2(inPipe, O_CLOEXEC) != 0) return false;
+        if (pipe2(outPipe, O_CLOEXEC) != 0) {
+            close(inPipe[0]);
+            close(inPipe[1]);
+            return false;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, inPipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+
+        std::vector<char*> argv;
+        argv.reserve(args.size() + 1);
+        for (const std::string& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const int rc = posix_spawnp(&m_pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(inPipe[0]);
+        close(outPipe[1]);
+        m_stdinWrite = inPipe[1];
+        m_stdoutRead = outPipe[0];
+        if (rc != 0) {
+            m_pid = -1;
+            return false;
+        }
+
+        fcntl(m_stdinWrite, F_SETFL, fcntl(m_stdinWrite, F_GETFL) | O_NONBLOCK);
+        fcntl(m_stdoutRead, F_SETFL, fcntl(m_stdoutRead, F_GETFL) | O_NONBLOCK);
+
+        m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        m_readEpoll = epoll_create1(EPOLL_CLOEXEC);
+        m_writeEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (m_wakeFd < 0 || m_readEpoll < 0 || m_writeEpoll < 0) {
+            Stop();
+            return false;
+        }
+        return Watch(m_readEpoll, m_stdoutRead, EPOLLIN) && Watch(m_readEpoll, m_wakeFd, EPOLLIN) &&
+               Watch(m_writeEpoll, m_stdinWrite, EPOLLOUT) && Watch(m_writeEpoll, m_wakeFd, EPOLLIN);
+    }
+
+    void Stop() override {
+        if (m_stopped.exchange(true)) return;
+        if (m_wakeFd >= 0) {
+            const uint64_t one = 1;
+            (void)!write(m_wakeFd, &one, sizeof(one));
+        }
+        if (m_pid <= 0) return;
+
+        // No SIGCHLD handler: a global reaper would also collect children that other
+        // code (popen, the terminal) waits for. Reap our own pid explicitly instead.
+        kill(m_pid, SIGTERM);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+        while (waitpid(m_pid, nullptr, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(m_pid, SIGKILL);
+                waitpid(m_pid, nullptr, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        m_pid = -1;
+    }
+
+    bool Write(const char* data, size_t size) override {
+        while (size > 0) {
+            if (m_stopped) return false;
+            const ssize_t written = write(m_stdinWrite, data, size);
+            if (written > 0) {
+                data += written;
+                size -= static_cast<size_t>(written);
+                continue;
+            }
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0 && errno != EAGAIN) return false;
+            if (!WaitReady(m_writeEpoll)) return false;
+        }
+        return true;
+    }
+
+    long Read(char* buffer, size_t capacity) override {
+        while (!m_stopped) {
+            const ssize_t read = ::read(m_stdoutRead, buffer, capacity);
+            if (read >= 0) return static_cast<long>(read);
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) return -1;
+            if (!WaitReady(m_readEpoll)) return 0;
+        }
+        return 0;
+    }
+
+private:
+    static bool Watch(int epollFd, int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    // False when woken by Stop() rather than by the pipe.
+    bool WaitReady(int epollFd) {
+        epoll_event events[2];
+        while (true) {
+            const int count = epoll_wait(epollFd, events, 2, -1);
+            if (count < 0 && errno == EINTR) continue;
+            if (count < 0) return false;
+            for (int i = 0; i < count; ++i) {
+                if (events[i].data.fd == m_wakeFd) return false;
+            }
+            return true;
+        }
+    }
+
+    pid_t m_pid = -1;
+    int m_stdinWrite = -1;
+    int m_stdoutRead = -1;
+    int m_readEpoll = -1;
+    int m_writeEpoll = -1;
+    int m_wakeFd = -1;
+    std::atomic<bool> m_stopped{false};
+};
+
+#endif
+
+} // namespace
+
+std::unique_ptr<LSPTransport> CreateLSPTransport() {
+#ifdef _WIN32
+    return std::make_unique<Win32LSPTransport>();
+#elif defined(__linux__)
+    return std::make_unique<PosixLSPTransport>();
+#else
+    return nullptr;
+#endif
+}
+
+int CurrentProcessId() {
+#ifdef _WIN32
+    return (int)GetCurrentProcessId();
+#elif defined(__linux__)
+    return (int)getpid();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Byte pipe to a language server child process (its stdin/stdout). Write and Read
+// are called from the LSP writer and reader threads respectively and may block;
+// Stop() terminates the child and wakes both so the threads can be joined.
+class LSPTransport {
+public:
+    virtual ~LSPTransport() = default;
+
+    // args[0] is the executable, looked up on PATH.
+    virtual bool Start(const std::vector<std::string>& args) = 0;
+    virtual void Stop() = 0;
+
+    // Writes everything or returns false once the pipe is closed / stopped.
+    virtual bool Write(const char* data, size_t size) = 0;
+    // Returns the number of bytes read, or <= 0 on EOF, error or Stop().
+    virtual long Read(char* buffer, size_t capacity) = 0;
+};
+
+// Win32 pipes + CreateProcess, or posix_spawn + epoll on Linux. Returns nullptr
+// where no backend is available.
+std::unique_ptr<LSPTransport> CreateLSPTransport();
+
+int CurrentProcessId();
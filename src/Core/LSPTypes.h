@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct LSPDiagnostic {
+    int line;
+    int range_start;
+    int range_end;
+    std::string message;
+    int severity; // 1: Error, 2: Warning
+};
+
+struct LSPCompletionItem {
+    std::string label;
+    std::string detail;
+    std::string insertText;
+};
+
+// textDocument/completion result. An incomplete list may gain items as more is typed,
+// so it has to be requested again rather than only filtered on the client.
+struct LSPCompletionList {
+    std::vector<LSPCompletionItem> items;
+    bool isIncomplete = false;
+};
+
+// One entry of didChange contentChanges; the range is in UTF-16 positions of the
+// document as it was before this change (and after the ones preceding it).
+struct LSPContentChange {
+    int startLine = 0;
+    int startCharacter = 0;
+    int endLine = 0;
+    int endCharacter = 0;
+    std::string text;
+};
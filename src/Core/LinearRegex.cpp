@@ -0,0 +1,777 @@
+#include "LinearRegex.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// "(a{1000}){1000}" and friends are rejected rather than expanded.
+constexpr size_t kMaxInstructions = 20000;
+constexpr int kMaxRepeat = 1000;
+constexpr int kMaxNesting = 128;
+constexpr size_t kMaxGroups = 99;
+
+bool IsWordByte(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+bool IsDigitByte(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+char FoldAscii(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+int HexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+} // namespace
+
+struct LinearRegex::Node {
+    enum class Kind : uint8_t { Empty, Byte, Any, Class, LineStart, LineEnd, WordBoundary, NotWordBoundary, Group, Concat, Alternate, Repeat };
+
+    Kind kind = Kind::Empty;
+    uint8_t byte = 0;
+    uint32_t index = 0; // Class: index into m_classes; Group: capture number
+    int min = 0;
+    int max = 0; // Repeat: -1 for unbounded
+    bool greedy = true;
+    std::vector<Node> children;
+};
+
+// Recursive descent over the pattern; the nesting depth is bounded, so a pattern of
+// ten thousand '(' fails instead of overflowing the stack.
+class LinearRegex::Parser {
+public:
+    Parser(std::string_view pattern, bool caseSensitive, std::vector<ByteSet>& classes)
+        : m_pattern(pattern), m_caseSensitive(caseSensitive), m_classes(classes) {}
+
+    bool Parse(Node& root) {
+        // A ')' without its '(' stops the top level early.
+        return ParseAlternation(root, 0) && m_pos == m_pattern.size();
+    }
+
+    size_t GroupCount() const { return m_groupCount; }
+
+private:
+    bool AtEnd() const { return m_pos >= m_pattern.size(); }
+    char Peek() const { return m_pattern[m_pos]; }
+
+    bool ParseAlternation(Node& out, int depth) {
+        if (depth > kMaxNesting) {
+            return false;
+        }
+        Node branch;
+        if (!ParseConcat(branch, depth)) {
+            return false;
+        }
+        if (AtEnd() || Peek() != '|') {
+            out = std::move(branch);
+            return true;
+        }
+        out.kind = Node::Kind::Alternate;
+        out.children.push_back(std::move(branch));
+        while (!AtEnd() && Peek() == '|') {
+            ++m_pos;
+            Node next;
+            if (!ParseConcat(next, depth)) {
+                return false;
+            }
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool ParseConcat(Node& out, int depth) {
+        out.kind = Node::Kind::Concat;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            Node atom;
+            bool quantifiable = true;
+            if (!ParseAtom(atom, depth, quantifiable)) {
+                return false;
+            }
+            int min = 0;
+            int max = 0;
+            bool found = false;
+            if (!ParseQuantifier(min, max, found)) {
+                return false;
+            }
+            if (found) {
+                if (!quantifiable) {
+                    return false;
+                }
+                Node repeat;
+                repeat.kind = Node::Kind::Repeat;
+                repeat.min = min;
+                repeat.max = max;
+                if (!AtEnd() && Peek() == '?') {
+                    repeat.greedy = false;
+                    ++m_pos;
+                }
+                repeat.children.push_back(std::move(atom));
+                atom = std::move(repeat);
+                // "a**" has nothing to repeat.
+                if (!ParseQuantifier(min, max, found) || found) {
+                    return false;
+                }
+            }
+            out.children.push_back(std::move(atom));
+        }
+        if (out.children.size() == 1) {
+            Node only = std::move(out.children[0]);
+            out = std::move(only);
+        }
+        return true;
+    }
+
+    // `found` stays false, and nothing is consumed, when the next bytes are not a
+    // quantifier; a '{' that does not open "{n}", "{n,}" or "{n,m}" is a literal.
+    bool ParseQuantifier(int& min, int& max, bool& found) {
+        found = false;
+        if (AtEnd()) {
+            return true;
+        }
+        switch (Peek()) {
+        case '*': min = 0; max = -1; break;
+        case '+': min = 1; max = -1; break;
+        case '?': min = 0; max = 1; break;
+        case '{': {
+            size_t pos = m_pos + 1;
+            const auto number = [&](int& value) {
+                const size_t start = pos;
+                value = 0;
+                while (pos < m_pattern.size() && IsDigitByte(m_pattern[pos])) {
+                    value = std::min(value * 10 + (m_pattern[pos] - '0'), kMaxRepeat + 1);
+                    ++pos;
+                }
+                return pos > start;
+            };
+            if (!number(min)) {
+                return true;
+            }
+            max = min;
+            if (pos < m_pattern.size() && m_pattern[pos] == ',') {
+                ++pos;
+                if (!number(max)) {
+                    max = -1;
+                }
+            }
+            if (pos >= m_pattern.size() || m_pattern[pos] != '}') {
+                return true;
+            }
+            m_pos = pos;
+            break;
+        }
+        default:
+            return true;
+        }
+        ++m_pos;
+        found = true;
+        return min <= kMaxRepeat && max <= kMaxRepeat && (max < 0 || min <= max);
+    }
+
+    bool ParseAtom(Node& out, int depth, bool& quantifiable) {
+        const char ch = m_pattern[m_pos++];
+        switch (ch) {
+        case '^':
+            out.kind = Node::Kind::LineStart;
+            quantifiable = false;
+            return true;
+        case '$':
+            out.kind = Node::Kind::LineEnd;
+            quantifiable = false;
+            return true;
+        case '.':
+            out.kind = Node::Kind::Any;
+            return true;
+        case '(':
+            return ParseGroup(out, depth);
+        case '[':
+            return ParseClass(out);
+        case '\\':
+            return ParseEscape(out, quantifiable);
+        case '*':
+        case '+':
+        case '?':
+            return false;
+        case '{': {
+            --m_pos;
+            int min = 0;
+            int max = 0;
+            bool found = false;
+            if (!ParseQuantifier(min, max, found) || found) {
+                return false;
+            }
+            ++m_pos;
+            break;
+        }
+        default:
+            break;
+        }
+        out.kind = Node::Kind::Byte;
+        out.byte = static_cast<uint8_t>(ch);
+        return true;
+    }
+
+    bool ParseGroup(Node& out, int depth) {
+        uint32_t capture = 0;
+        if (!AtEnd() && Peek() == '?') {
+            // Only "(?:"; lookaround and named groups are not supported.
+            if (m_pos + 1 >= m_pattern.size() || m_pattern[m_pos + 1] != ':') {
+                return false;
+            }
+            m_pos += 2;
+        } else {
+            if (m_groupCount >= kMaxGroups) {
+                return false;
+            }
+            capture = static_cast<uint32_t>(++m_groupCount);
+        }
+        Node inner;
+        if (!ParseAlternation(inner, depth + 1) || AtEnd() || Peek() != ')') {
+            return false;
+        }
+        ++m_pos;
+        if (capture == 0) {
+            out = std::move(inner);
+            return true;
+        }
+        out.kind = Node::Kind::Group;
+        out.index = capture;
+        out.children.push_back(std::move(inner));
+        return true;
+    }
+
+    bool ParseEscape(Node& out, bool& quantifiable) {
+        if (AtEnd()) {
+            return false;
+        }
+        const char ch = m_pattern[m_pos++];
+        if (ch == 'b' || ch == 'B') {
+            out.kind = ch == 'b' ? Node::Kind::WordBoundary : Node::Kind::NotWordBoundary;
+            quantifiable = false;
+            return true;
+        }
+        ByteSet set{};
+        if (AddEscapeSet(ch, set)) {
+            out.kind = Node::Kind::Class;
+            out.index = AddClass(set, false);
+            return true;
+        }
+        if (ch >= '1' && ch <= '9') {
+            return false; // backreferences need backtracking
+        }
+        if (ch == 'u') {
+            // One code point, matched as its UTF-8 bytes.
+            uint32_t value = 0;
+            if (!ParseHex(4, value)) {
+                return false;
+            }
+            char bytes[3];
+            size_t count = 0;
+            if (value < 0x80) {
+                bytes[count++] = static_cast<char>(value);
+            } else if (value < 0x800) {
+                bytes[count++] = static_cast<char>(0xC0 | (value >> 6));
+                bytes[count++] = static_cast<char>(0x80 | (value & 0x3F));
+            } else {
+                bytes[count++] = static_cast<char>(0xE0 | (value >> 12));
+                bytes[count++] = static_cast<char>(0x80 | ((value >> 6) & 0x3F));
+                bytes[count++] = static_cast<char>(0x80 | (value & 0x3F));
+            }
+            out.kind = Node::Kind::Concat;
+            for (size_t i = 0; i < count; ++i) {
+                Node byte;
+                byte.kind = Node::Kind::Byte;
+                byte.byte = static_cast<uint8_t>(bytes[i]);
+                out.children.push_back(std::move(byte));
+            }
+            return true;
+        }
+        char byte = 0;
+        if (!EscapedByte(ch, byte)) {
+            return false;
+        }
+        out.kind = Node::Kind::Byte;
+        out.byte = static_cast<uint8_t>(byte);
+        return true;
+    }
+
+    // \d, \w, \s and their negations; ASCII only.
+    bool AddEscapeSet(char ch, ByteSet& set) const {
+        ByteSet own{};
+        const auto add = [&own](int from, int to) {
+            for (int value = from; value <= to; ++value) {
+                own[value >> 6] |= uint64_t(1) << (value & 63);
+            }
+        };
+        switch (ch) {
+        case 'd':
+        case 'D':
+            add('0', '9');
+            break;
+        case 'w':
+        case 'W':
+            add('0', '9');
+            add('A', 'Z');
+            add('a', 'z');
+            add('_', '_');
+            break;
+        case 's':
+        case 'S':
+            add('\t', '\r');
+            add(' ', ' ');
+            break;
+        default:
+            return false;
+        }
+        const bool negate = ch == 'D' || ch == 'W' || ch == 'S';
+        for (size_t i = 0; i < set.size(); ++i) {
+            set[i] |= negate ? ~own[i] : own[i];
+        }
+        return true;
+    }
+
+    // The byte of a single-character escape other than \u; identity escapes such as
+    // \. and \/ stand for themselves.
+    bool EscapedByte(char ch, char& byte) {
+        switch (ch) {
+        case 'n': byte = '\n'; return true;
+        case 'r': byte = '\r'; return true;
+        case 't': byte = '\t'; return true;
+        case 'f': byte = '\f'; return true;
+        case 'v': byte = '\v'; return true;
+        case '0': byte = '\0'; return true;
+        case 'x': {
+            uint32_t value = 0;
+            if (!ParseHex(2, value)) {
+                byte = 'x';
+                return true;
+            }
+            byte = static_cast<char>(value);
+            return true;
+        }
+        case 'c':
+            if (AtEnd() || !((Peek() >= 'a' && Peek() <= 'z') || (Peek() >= 'A' && Peek() <= 'Z'))) {
+                return false;
+            }
+            byte = static_cast<char>(m_pattern[m_pos++] % 32);
+            return true;
+        default:
+            byte = ch;
+            return true;
+        }
+    }
+
+    bool ParseHex(size_t digits, uint32_t& value) {
+        if (m_pos + digits > m_pattern.size()) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < digits; ++i) {
+            const int digit = HexValue(m_pattern[m_pos + i]);
+            if (digit < 0) {
+                return false;
+            }
+            value = value * 16 + static_cast<uint32_t>(digit);
+        }
+        m_pos += digits;
+        return true;
+    }
+
+    // After '['. "[]" matches nothing and "[^]" any byte, as in ECMAScript.
+    bool ParseClass(Node& out) {
+        bool negate = false;
+        if (!AtEnd() && Peek() == '^') {
+            negate = true;
+            ++m_pos;
+        }
+        ByteSet set{};
+        const auto add = [&set](unsigned from, unsigned to) {
+            for (unsigned value = from; value <= to; ++value) {
+                set[value >> 6] |= uint64_t(1) << (value & 63);
+            }
+        };
+        while (true) {
+            if (AtEnd()) {
+                return false;
+            }
+            if (Peek() == ']') {
+                ++m_pos;
+                break;
+            }
+            char low = 0;
+            bool isSet = false;
+            if (!ParseClassAtom(set, low, isSet)) {
+                return false;
+            }
+            if (isSet) {
+                continue;
+            }
+            if (m_pos + 1 < m_pattern.size() && Peek() == '-' && m_pattern[m_pos + 1] != ']') {
+                ++m_pos;
+                char high = 0;
+                if (!ParseClassAtom(set, high, isSet) || isSet) {
+                    return false; // a range needs single bytes at both ends
+                }
+                if (static_cast<unsigned char>(low) > static_cast<unsigned char>(high)) {
+                    return false;
+                }
+                add(static_cast<unsigned char>(low), static_cast<unsigned char>(high));
+            } else {
+                add(static_cast<unsigned char>(low), static_cast<unsigned char>(low));
+            }
+        }
+        out.kind = Node::Kind::Class;
+        out.index = AddClass(set, negate);
+        return true;
+    }
+
+    // One class member: a byte, or an escape set (\d ...) added to `set` directly.
+    bool ParseClassAtom(ByteSet& set, char& byte, bool& isSet) {
+        isSet = false;
+        const char ch = m_pattern[m_pos++];
+        if (ch != '\\') {
+            byte = ch;
+            return true;
+        }
+        if (AtEnd()) {
+            return false;
+        }
+        const char escaped = m_pattern[m_pos++];
+        if (AddEscapeSet(escaped, set)) {
+            isSet = true;
+            return true;
+        }
+        if (escaped == 'b') {
+            byte = '\b';
+            return true;
+        }
+        if (escaped == 'u') {
+            uint32_t value = 0;
+            if (!ParseHex(4, value) || value >= 0x80) {
+                return false; // classes are byte sets
+            }
+            byte = static_cast<char>(value);
+            return true;
+        }
+        return EscapedByte(escaped, byte);
+    }
+
+    uint32_t AddClass(ByteSet set, bool negate) {
+        if (!m_caseSensitive) {
+            for (unsigned value = 'a'; value <= 'z'; ++value) {
+                const unsigned upper = value - 'a' + 'A';
+                const bool either = ((set[value >> 6] >> (value & 63)) & 1) || ((set[upper >> 6] >> (upper & 63)) & 1);
+                if (either) {
+                    set[value >> 6] |= uint64_t(1) << (value & 63);
+                    set[upper >> 6] |= uint64_t(1) << (upper & 63);
+                }
+            }
+        }
+        if (negate) {
+            for (uint64_t& word : set) {
+                word = ~word;
+            }
+        }
+        m_classes.push_back(set);
+        return static_cast<uint32_t>(m_classes.size() - 1);
+    }
+
+    std::string_view m_pattern;
+    bool m_caseSensitive = true;
+    std::vector<ByteSet>& m_classes;
+    size_t m_pos = 0;
+    size_t m_groupCount = 0;
+};
+
+bool LinearRegex::ThreadList::Visit(uint32_t pc) {
+    const uint32_t index = sparse[pc];
+    if (index < visited && dense[index] == pc) {
+        return false;
+    }
+    sparse[pc] = static_cast<uint32_t>(visited);
+    dense[visited++] = pc;
+    return true;
+}
+
+void LinearRegex::ThreadList::Clear() {
+    visited = 0;
+    threads.clear();
+}
+
+bool LinearRegex::Compile(std::string_view pattern, bool caseSensitive) {
+    m_program.clear();
+    m_classes.clear();
+    m_groupCount = 0;
+    m_caseSensitive = caseSensitive;
+
+    Node root;
+    Parser parser(pattern, caseSensitive, m_classes);
+    const bool compiled = parser.Parse(root) &&
+                          EmitInst({Op::Save, 0, 0, 0}) &&
+                          Emit(root) &&
+                          EmitInst({Op::Save, 0, 1, 0}) &&
+                          EmitInst({Op::Match, 0, 0, 0});
+    if (!compiled) {
+        m_program.clear();
+        m_classes.clear();
+        return false;
+    }
+    m_groupCount = parser.GroupCount();
+
+    const size_t slotCount = 2 * (m_groupCount + 1);
+    for (ThreadList* list : {&m_current, &m_next}) {
+        list->sparse.assign(m_program.size(), 0);
+        list->dense.assign(m_program.size(), 0);
+        list->threads.reserve(m_program.size());
+        list->slots.assign(m_program.size() * slotCount, kNoGroup);
+        list->Clear();
+    }
+    m_slots.assign(slotCount, kNoGroup);
+    return true;
+}
+
+bool LinearRegex::EmitInst(const Inst& inst) {
+    if (m_program.size() >= kMaxInstructions) {
+        return false;
+    }
+    m_program.push_back(inst);
+    return true;
+}
+
+bool LinearRegex::Emit(const Node& node) {
+    switch (node.kind) {
+    case Node::Kind::Empty:
+        return true;
+    case Node::Kind::Byte: {
+        const char byte = static_cast<char>(node.byte);
+        return EmitInst({Op::Byte, static_cast<uint8_t>(m_caseSensitive ? byte : FoldAscii(byte)), 0, 0});
+    }
+    case Node::Kind::Any:
+        return EmitInst({Op::Any, 0, 0, 0});
+    case Node::Kind::Class:
+        return EmitInst({Op::Class, 0, node.index, 0});
+    case Node::Kind::LineStart:
+        return EmitInst({Op::LineStart, 0, 0, 0});
+    case Node::Kind::LineEnd:
+        return EmitInst({Op::LineEnd, 0, 0, 0});
+    case Node::Kind::WordBoundary:
+        return EmitInst({Op::WordBoundary, 0, 0, 0});
+    case Node::Kind::NotWordBoundary:
+        return EmitInst({Op::NotWordBoundary, 0, 0, 0});
+    case Node::Kind::Group:
+        return EmitInst({Op::Save, 0, 2 * node.index, 0}) &&
+               Emit(node.children[0]) &&
+               EmitInst({Op::Save, 0, 2 * node.index + 1, 0});
+    case Node::Kind::Concat:
+        for (const Node& child : node.children) {
+            if (!Emit(child)) {
+                return false;
+            }
+        }
+        return true;
+    case Node::Kind::Alternate: {
+        // split L1, next; L1: a; jump end; next: split L2, ...; Ln: z; end:
+        std::vector<size_t> jumps;
+        for (size_t i = 0; i + 1 < node.children.size(); ++i) {
+            const size_t split = m_program.size();
+            if (!EmitInst({Op::Split, 0, static_cast<uint32_t>(split + 1), 0}) || !Emit(node.children[i])) {
+                return false;
+            }
+            jumps.push_back(m_program.size());
+            if (!EmitInst({Op::Jump, 0, 0, 0})) {
+                return false;
+            }
+            m_program[split].y = static_cast<uint32_t>(m_program.size());
+        }
+        if (!Emit(node.children.back())) {
+            return false;
+        }
+        for (const size_t jump : jumps) {
+            m_program[jump].x = static_cast<uint32_t>(m_program.size());
+        }
+        return true;
+    }
+    case Node::Kind::Repeat: {
+        const Node& child = node.children[0];
+        // Preferred and other target of a split between "once more" and "done".
+        const auto setSplit = [&](size_t split, size_t again, size_t done) {
+            m_program[split].x = static_cast<uint32_t>(node.greedy ? again : done);
+            m_program[split].y = static_cast<uint32_t>(node.greedy ? done : again);
+        };
+        if (node.max < 0 && node.min > 0) {
+            // x{n,}: n - 1 copies, then L: x; split L, done.
+            for (int i = 0; i + 1 < node.min; ++i) {
+                if (!Emit(child)) return false;
+            }
+            const size_t loop = m_program.size();
+            if (!Emit(child) || !EmitInst({Op::Split, 0, 0, 0})) {
+                return false;
+            }
+            setSplit(m_program.size() - 1, loop, m_program.size());
+            return true;
+        }
+        for (int i = 0; i < node.min; ++i) {
+            if (!Emit(child)) return false;
+        }
+        if (node.max < 0) {
+            // x*: L: split body, done; body: x; jump L; done:
+            const size_t loop = m_program.size();
+            if (!EmitInst({Op::Split, 0, 0, 0}) || !Emit(child) || !EmitInst({Op::Jump, 0, static_cast<uint32_t>(loop), 0})) {
+                return false;
+            }
+            setSplit(loop, loop + 1, m_program.size());
+            return true;
+        }
+        // x{n,m}: m - n optional copies, each able to skip to the end.
+        std::vector<size_t> splits;
+        for (int i = node.min; i < node.max; ++i) {
+            splits.push_back(m_program.size());
+            if (!EmitInst({Op::Split, 0, 0, 0}) || !Emit(child)) {
+                return false;
+            }
+        }
+        for (const size_t split : splits) {
+            setSplit(split, split + 1, m_program.size());
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+void LinearRegex::AddThread(ThreadList& list, uint32_t pc, std::string_view text, size_t pos) const {
+    // Follows jumps, splits, saves and assertions to the byte-consuming instructions,
+    // preferred branch first. An explicit stack instead of recursion, so long chains
+    // of splits cannot overflow; saves are undone when their branch is exhausted.
+    const size_t slotCount = m_slots.size();
+    m_stack.clear();
+    m_stack.push_back({pc, UINT32_MAX, 0});
+    while (!m_stack.empty()) {
+        const Pending item = m_stack.back();
+        m_stack.pop_back();
+        if (item.restoreSlot != UINT32_MAX) {
+            m_slots[item.restoreSlot] = item.restoreValue;
+            continue;
+        }
+        uint32_t at = item.pc;
+        while (list.Visit(at)) {
+            const Inst& inst = m_program[at];
+            bool follow = true;
+            switch (inst.op) {
+            case Op::Jump:
+                at = inst.x;
+                continue;
+            case Op::Split:
+                m_stack.push_back({inst.y, UINT32_MAX, 0});
+                at = inst.x;
+                continue;
+            case Op::Save:
+                m_stack.push_back({0, inst.x, m_slots[inst.x]});
+                m_slots[inst.x] = pos;
+                break;
+            case Op::LineStart:
+                follow = pos == 0;
+                break;
+            case Op::LineEnd:
+                follow = pos == text.size();
+                break;
+            case Op::WordBoundary:
+            case Op::NotWordBoundary: {
+                const bool before = pos > 0 && IsWordByte(text[pos - 1]);
+                const bool after = pos < text.size() && IsWordByte(text[pos]);
+                follow = (before != after) == (inst.op == Op::WordBoundary);
+                break;
+            }
+            default:
+                list.threads.push_back(at);
+                std::copy(m_slots.begin(), m_slots.end(), list.slots.begin() + static_cast<std::ptrdiff_t>(at * slotCount));
+                follow = false;
+                break;
+            }
+            if (!follow) {
+                break;
+            }
+            ++at;
+        }
+    }
+}
+
+bool LinearRegex::Search(
+    std::string_view text,
+    size_t from,
+    bool anchored,
+    bool nonEmpty,
+    std::vector<size_t>& groups) const {
+    groups.assign(2 * (m_groupCount + 1), kNoGroup);
+    if (!Valid() || from > text.size()) {
+        return false;
+    }
+
+    const size_t slotCount = m_slots.size();
+    bool matched = false;
+    m_current.Clear();
+    m_next.Clear();
+    for (size_t pos = from; pos <= text.size(); ++pos) {
+        if (!matched && (!anchored || pos == from)) {
+            // A new start ranks below every thread that started earlier.
+            std::fill(m_slots.begin(), m_slots.end(), kNoGroup);
+            AddThread(m_current, 0, text, pos);
+        }
+        if (m_current.threads.empty()) {
+            if (matched || anchored) {
+                break;
+            }
+            m_current.Clear();
+            continue;
+        }
+
+        const bool atEnd = pos == text.size();
+        const char ch = atEnd ? '\0' : text[pos];
+        const char folded = m_caseSensitive ? ch : FoldAscii(ch);
+        for (const uint32_t pc : m_current.threads) {
+            const Inst& inst = m_program[pc];
+            const size_t* slots = m_current.slots.data() + pc * slotCount;
+            bool advances = false;
+            if (inst.op == Op::Match) {
+                if (nonEmpty && slots[0] == pos) {
+                    continue; // as if this alternative had failed
+                }
+                // Threads after this one are less preferred; the ones before keep
+                // running and may still replace the match.
+                std::copy(slots, slots + slotCount, groups.begin());
+                matched = true;
+                break;
+            }
+            if (!atEnd) {
+                switch (inst.op) {
+                case Op::Byte:
+                    advances = folded == static_cast<char>(inst.byte);
+                    break;
+                case Op::Any:
+                    advances = ch != '\n' && ch != '\r';
+                    break;
+                case Op::Class: {
+                    const unsigned value = static_cast<unsigned char>(ch);
+                    advances = ((m_classes[inst.x][value >> 6] >> (value & 63)) & 1) != 0;
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+            if (advances) {
+                std::copy(slots, slots + slotCount, m_slots.begin());
+                AddThread(m_next, pc + 1, text, pos + 1);
+            }
+        }
+        std::swap(m_current, m_next);
+        m_next.Clear();
+    }
+    return matched;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Regex matcher for untrusted find patterns: the ECMAScript subset without
+// backreferences and lookaround, compiled to a program run as a Pike VM. Every input
+// byte advances all live threads at once, so a search costs O(text * program) for
+// any pattern, nothing recurses on the input and "(a+)+b" is as cheap as "ab".
+// Matching is leftmost-first with greedy/lazy preference like ECMAScript. Bytes, not
+// code points: '.' and negated classes match one byte, case folding is ASCII only.
+// ^ and $ are the ends of the searched text, which find passes one line at a time.
+//
+// Searching uses scratch space inside the object, so one instance must not be used
+// by several threads at once.
+class LinearRegex {
+public:
+    static constexpr size_t kNoGroup = SIZE_MAX;
+
+    // False for invalid or unsupported patterns (backreferences, lookaround) and for
+    // ones whose program would exceed the size limit, e.g. "(a{1000}){1000}".
+    bool Compile(std::string_view pattern, bool caseSensitive);
+    bool Valid() const { return !m_program.empty(); }
+    // Capturing groups, not counting the whole match.
+    size_t GroupCount() const { return m_groupCount; }
+
+    // Leftmost match starting at or after `from` (exactly at `from` when `anchored`);
+    // with `nonEmpty`, empty matches count as failed alternatives. `groups` gets
+    // 2 * (GroupCount() + 1) offsets into `text`: start and end of the whole match,
+    // then of each group, kNoGroup for groups that did not take part.
+    bool Search(std::string_view text, size_t from, bool anchored, bool nonEmpty, std::vector<size_t>& groups) const;
+
+private:
+    enum class Op : uint8_t { Byte, Any, Class, Split, Jump, Save, LineStart, LineEnd, WordBoundary, NotWordBoundary, Match };
+
+    struct Inst {
+        Op op = Op::Match;
+        uint8_t byte = 0;
+        uint32_t x = 0; // Split/Jump: preferred target; Class: class index; Save: slot
+        uint32_t y = 0; // Split: other target
+    };
+
+    using ByteSet = std::array<uint64_t, 4>;
+
+    // Threads of one input position in priority order, with their capture slots.
+    struct ThreadList {
+        std::vector<uint32_t> sparse; // program counter -> index into dense
+        std::vector<uint32_t> dense;  // every pc reached at this position
+        size_t visited = 0;
+        std::vector<uint32_t> threads; // the byte-consuming and Match pcs, best first
+        std::vector<size_t> slots;     // slotCount per pc
+
+        bool Visit(uint32_t pc);
+        void Clear();
+    };
+
+    struct Pending {
+        uint32_t pc = 0;
+        uint32_t restoreSlot = UINT32_MAX; // set: restore that slot instead of following pc
+        size_t restoreValue = 0;
+    };
+
+    struct Node;
+    class Parser;
+
+    bool Emit(const Node& node);
+    bool EmitInst(const Inst& inst);
+    void AddThread(ThreadList& list, uint32_t pc, std::string_view text, size_t pos) const;
+
+    std::vector<Inst> m_program;
+    std::vector<ByteSet> m_classes;
+    size_t m_groupCount = 0;
+    bool m_caseSensitive = true;
+
+    mutable ThreadList m_current;
+    mutable ThreadList m_next;
+    mutable std::vector<size_t> m_slots; // capture slots of the thread being followed
+    mutable std::vector<Pending> m_stack;
+};
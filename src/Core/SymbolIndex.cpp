@@ -0,0 +1,611 @@
+#include "SymbolIndex.h"
+#include "CharScan.h"
+#include "WorkspaceSearch.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'I', 'N', 'S', 'Y', 'M', '0', '1'};
+// Bigger sources are generated (amalgamations, tables) and would only skew the counts.
+constexpr size_t kMaxSourceBytes = 4u * 1024u * 1024u;
+constexpr size_t kMaxTableBytes = size_t(1) << 31;
+constexpr size_t kBinaryProbeBytes = 8192;
+constexpr size_t kMinSymbolLength = 3;
+constexpr size_t kMaxSymbolLength = 255;
+// How often (in files) a refresh checks for shutdown or a new root.
+constexpr size_t kInterruptCheckFiles = 256;
+
+// Offsets are from the start of the buffer, except names and paths, which are from
+// the start of the pool.
+struct TableHeader {
+    char magic[8];
+    uint32_t fileCount;
+    uint32_t symbolCount;
+    uint64_t refCount;
+    uint64_t rootOffset;
+    uint64_t rootLength;
+    uint64_t filesOffset;
+    uint64_t refsOffset;
+    uint64_t symbolsOffset;
+    uint64_t poolOffset;
+    uint64_t poolSize;
+};
+
+struct FileRecord {
+    uint64_t size;
+    int64_t mtime;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t firstRef;
+    uint32_t refCount;
+};
+
+struct SymbolRecord {
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint8_t kind;
+    uint8_t reserved;
+    uint32_t fileCount;
+};
+
+// The buffer may be a mapped file at any alignment, so records are copied out.
+template <typename T>
+T ReadAt(std::string_view data, uint64_t offset) {
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void Append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+bool FitsIn(uint64_t offset, uint64_t length, uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+bool IsCppSourcePath(const fs::path& path) {
+    static const char* const kExtensions[] = {
+        ".h", ".hh", ".hpp", ".hxx", ".inl", ".ipp", ".tpp", ".c", ".cc", ".cpp", ".cxx", ".ixx", ".cppm"};
+    std::string ext = path.extension().string();
+    for (char& ch : ext) {
+        if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+    }
+    for (const char* source : kExtensions) {
+        if (ext == source) return true;
+    }
+    return false;
+}
+
+// "#  define NAME" -> NAME, otherwise empty.
+std::string_view DefinedMacro(std::string_view directive) {
+    size_t pos = SkipBlanks(directive, 1);
+    constexpr std::string_view kDefine = "define";
+    if (directive.compare(pos, kDefine.size(), kDefine) != 0) {
+        return {};
+    }
+    pos += kDefine.size();
+    const size_t nameStart = SkipBlanks(directive, pos);
+    if (nameStart == pos || nameStart >= directive.size() || !IsIdentifierStartByte(directive[nameStart])) {
+        return {};
+    }
+    return directive.substr(nameStart, SkipIdentifierBytes(directive, nameStart) - nameStart);
+}
+
+} // namespace
+
+std::shared_ptr<const SymbolTable> SymbolTable::Load(const std::string& path) {
+    auto table = std::make_shared<SymbolTable>();
+    table->m_file = std::make_unique<FileContents>(path, table->m_buffer, kMaxTableBytes);
+    table->m_data = table->m_file->View();
+    if (!table->Validate()) {
+        return nullptr;
+    }
+    return table;
+}
+
+std::shared_ptr<const SymbolTable> SymbolTable::FromData(std::string data) {
+    auto table = std::make_shared<SymbolTable>();
+    table->m_buffer = std::move(data);
+    table->m_data = table->m_buffer;
+    if (!table->Validate()) {
+        return nullptr;
+    }
+    return table;
+}
+
+// Checks every offset a lookup follows, so a truncated or foreign file is rejected
+// here instead of being read out of bounds later. File refs are checked by their
+// one reader, SymbolIndex::Reset.
+bool SymbolTable::Validate() {
+    const uint64_t size = m_data.size();
+    if (size < sizeof(TableHeader) || std::memcmp(m_data.data(), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    const TableHeader header = ReadAt<TableHeader>(m_data, 0);
+    if (!FitsIn(header.rootOffset, header.rootLength, size) ||
+        !FitsIn(header.filesOffset, uint64_t(header.fileCount) * sizeof(FileRecord), size) ||
+        header.refCount > size || !FitsIn(header.refsOffset, header.refCount * sizeof(uint32_t), size) ||
+        !FitsIn(header.symbolsOffset, uint64_t(header.symbolCount) * sizeof(SymbolRecord), size) ||
+        !FitsIn(header.poolOffset, header.poolSize, size)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.fileCount; ++i) {
+        const FileRecord file = ReadAt<FileRecord>(m_data, header.filesOffset + uint64_t(i) * sizeof(FileRecord));
+        if (!FitsIn(file.pathOffset, file.pathLength, header.poolSize) ||
+            !FitsIn(file.firstRef, file.refCount, header.refCount)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.symbolCount; ++i) {
+        const SymbolRecord symbol =
+            ReadAt<SymbolRecord>(m_data, header.symbolsOffset + uint64_t(i) * sizeof(SymbolRecord));
+        if (!FitsIn(symbol.nameOffset, symbol.nameLength, header.poolSize) ||
+            symbol.kind > static_cast<uint8_t>(WorkspaceSymbolKind::Macro)) {
+            return false;
+        }
+    }
+    m_fileCount = header.fileCount;
+    m_symbolCount = header.symbolCount;
+    return true;
+}
+
+std::string_view SymbolTable::Root() const {
+    if (m_data.empty()) return {};
+    const TableHeader header = ReadAt<TableHeader>(m_data, 0);
+    return m_data.substr(header.rootOffset, header.rootLength);
+}
+
+SymbolTable::File SymbolTable::FileAt(size_t index) const {
+    const TableHeader header = ReadAt<TableHeader>(m_data, 0);
+    const FileRecord record = ReadAt<FileRecord>(m_data, header.filesOffset + index * sizeof(FileRecord));
+    File file;
+    file.path = m_data.substr(header.poolOffset + record.pathOffset, record.pathLength);
+    file.stamp.size = record.size;
+    file.stamp.mtime = record.mtime;
+    file.refs = m_data.data() + header.refsOffset + uint64_t(record.firstRef) * sizeof(uint32_t);
+    file.refCount = record.refCount;
+    return file;
+}
+
+WorkspaceSymbol SymbolTable::SymbolAt(size_t index) const {
+    const TableHeader header = ReadAt<TableHeader>(m_data, 0);
+    const SymbolRecord record = ReadAt<SymbolRecord>(m_data, header.symbolsOffset + index * sizeof(SymbolRecord));
+    WorkspaceSymbol symbol;
+    symbol.name = m_data.substr(header.poolOffset + record.nameOffset, record.nameLength);
+    symbol.kind = static_cast<WorkspaceSymbolKind>(record.kind);
+    symbol.fileCount = record.fileCount;
+    return symbol;
+}
+
+size_t SymbolTable::LowerBound(std::string_view name) const {
+    size_t low = 0;
+    size_t high = m_symbolCount;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (SymbolAt(middle).name < name) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void SymbolTable::Complete(const FuzzyMatcher& query, size_t limit, std::vector<WorkspaceSymbol>& out) const {
+    if (query.Empty()) {
+        return;
+    }
+
+    const char first = query.FoldedFirst();
+    std::string initials(1, first);
+    if (IsAlphaByte(first)) {
+        initials.push_back(static_cast<char>(first - 'a' + 'A'));
+    }
+    std::vector<WorkspaceSymbol> symbols;
+    std::vector<std::string_view> names;
+    for (const char initial : initials) {
+        for (size_t i = LowerBound(std::string_view(&initial, 1)); i < m_symbolCount; ++i) {
+            const WorkspaceSymbol symbol = SymbolAt(i);
+            if (symbol.name[0] != initial) {
+                break;
+            }
+            symbols.push_back(symbol);
+            names.push_back(symbol.name);
+        }
+    }
+
+    std::vector<uint32_t> hits;
+    query.Filter(names, hits);
+    std::vector<std::pair<int, WorkspaceSymbol>> matches;
+    for (const uint32_t index : hits) {
+        if (names[index] != query.Query()) {
+            matches.emplace_back(query.Score(names[index]), symbols[index]);
+        }
+    }
+
+    const size_t count = std::min(limit, matches.size());
+    std::partial_sort(
+        matches.begin(),
+        matches.begin() + static_cast<std::ptrdiff_t>(count),
+        matches.end(),
+        [](const std::pair<int, WorkspaceSymbol>& a, const std::pair<int, WorkspaceSymbol>& b) {
+            if (a.first != b.first) return a.first > b.first;
+            if (a.second.fileCount != b.second.fileCount) return a.second.fileCount > b.second.fileCount;
+            return a.second.name < b.second.name;
+        });
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(matches[i].second);
+    }
+}
+
+SymbolIndex::SymbolIndex(std::string storagePath)
+    : m_storagePath(std::move(storagePath)),
+      m_table(std::make_shared<SymbolTable>()) {
+    m_thread = std::thread(&SymbolIndex::WorkLoop, this);
+}
+
+SymbolIndex::~SymbolIndex() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void SymbolIndex::Open(const fs::path& root) {
+    const std::string key = WorkspaceRootKey(root);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (key == m_requestedRoot) return;
+        m_requestedRoot = key;
+    }
+    m_cv.notify_all();
+}
+
+void SymbolIndex::OnFileChanged(const fs::path& path) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changed.push_back(path.lexically_normal());
+    }
+    m_cv.notify_all();
+}
+
+std::shared_ptr<const SymbolTable> SymbolIndex::Table() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_table;
+}
+
+void SymbolIndex::WorkLoop() {
+    while (true) {
+        std::string root;
+        std::vector<fs::path> changed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] {
+                return m_stop || m_requestedRoot != m_root || !m_changed.empty();
+            });
+            if (m_stop) break;
+            if (m_requestedRoot != m_root) {
+                root = m_requestedRoot;
+            }
+            changed.swap(m_changed);
+        }
+
+        if (!root.empty()) {
+            if (m_unsaved) {
+                Save(); // the stored table holds one root, which is about to change
+            }
+            std::shared_ptr<const SymbolTable> stored = SymbolTable::Load(m_storagePath);
+            if (stored && stored->Root() != root) {
+                stored.reset();
+            }
+            Reset(root, std::move(stored));
+            const bool complete = Refresh(root);
+            if (m_dirty) {
+                Publish();
+            }
+            if (complete && m_unsaved) {
+                Save();
+            }
+        }
+
+        std::string prefix = m_root;
+        if (!prefix.empty() && prefix.back() != '/') {
+            prefix += '/';
+        }
+        for (const fs::path& path : changed) {
+            const std::string key = WorkspacePathKey(path);
+            if (m_root.empty() || key.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            fs::directory_entry entry;
+            FileStamp stamp;
+            std::error_code ec;
+            entry.assign(path, ec);
+            if (!ec && entry.is_regular_file(ec) && IsCppSourcePath(path) && ReadFileStamp(entry, stamp) &&
+                stamp.size <= kMaxSourceBytes) {
+                IndexFile(key, path, stamp);
+            } else if (m_files.erase(key) > 0) {
+                m_dirty = true;
+            }
+        }
+        if (m_dirty) {
+            Publish();
+        }
+    }
+
+    if (m_unsaved) {
+        Save();
+    }
+}
+
+void SymbolIndex::Reset(const std::string& root, std::shared_ptr<const SymbolTable> stored) {
+    m_root = root;
+    m_dirty = false;
+    m_unsaved = false;
+    m_files.clear();
+    m_nameIds.clear();
+    m_names.clear();
+    m_kinds.clear();
+
+    if (stored) {
+        // Symbols are stored sorted and unique, so interning them in order gives id == index.
+        for (size_t i = 0; i < stored->SymbolCount(); ++i) {
+            const WorkspaceSymbol symbol = stored->SymbolAt(i);
+            Intern(symbol.name, symbol.kind);
+        }
+        for (size_t i = 0; i < stored->FileCount(); ++i) {
+            const SymbolTable::File file = stored->FileAt(i);
+            FileEntry entry;
+            entry.stamp = file.stamp;
+            entry.names.resize(file.refCount);
+            if (file.refCount > 0) {
+                std::memcpy(entry.names.data(), file.refs, file.refCount * sizeof(uint32_t));
+            }
+            entry.names.erase(
+                std::remove_if(
+                    entry.names.begin(),
+                    entry.names.end(),
+                    [&](uint32_t id) { return id >= m_names.size(); }),
+                entry.names.end());
+            m_files.emplace(std::string(file.path), std::move(entry));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_table = stored ? std::move(stored) : std::make_shared<SymbolTable>();
+}
+
+// Returns false when interrupted by shutdown or a new root.
+bool SymbolIndex::Refresh(const std::string& root) {
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(fs::u8path(root), fs::directory_options::skip_permission_denied, ec);
+    const fs::recursive_directory_iterator end;
+    size_t visited = 0;
+    for (; !ec && it != end; it.increment(ec)) {
+        if (++visited % kInterruptCheckFiles == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stop || m_requestedRoot != root) {
+                return false;
+            }
+        }
+        const fs::directory_entry& entry = *it;
+        std::error_code statEc;
+        if (entry.is_directory(statEc)) {
+            if (IsSkippedWorkspaceDirectory(entry.path())) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        FileStamp stamp;
+        if (!IsCppSourcePath(entry.path()) || !entry.is_regular_file(statEc) || !ReadFileStamp(entry, stamp) ||
+            stamp.size > kMaxSourceBytes) {
+            continue;
+        }
+
+        std::string key = WorkspacePathKey(entry.path());
+        const auto found = m_files.find(key);
+        if (found == m_files.end() || found->second.stamp != stamp) {
+            IndexFile(key, entry.path(), stamp);
+        }
+        seen.insert(std::move(key));
+    }
+    if (ec) {
+        return false;
+    }
+
+    for (auto file = m_files.begin(); file != m_files.end();) {
+        if (seen.count(file->first) == 0) {
+            file = m_files.erase(file);
+            m_dirty = true;
+        } else {
+            ++file;
+        }
+    }
+    return true;
+}
+
+void SymbolIndex::IndexFile(const std::string& key, const fs::path& path, const FileStamp& stamp) {
+    FileEntry entry;
+    entry.stamp = stamp;
+
+    const FileContents contents(path.u8string(), m_readBuffer, kMaxSourceBytes);
+    const std::string_view text = contents.View();
+    if (std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbeBytes)) == nullptr) {
+        const auto add = [&](std::string_view name, WorkspaceSymbolKind kind) {
+            if (name.size() >= kMinSymbolLength && name.size() <= kMaxSymbolLength && ClassifyCppWord(name) == 0) {
+                entry.names.push_back(Intern(name, kind));
+            }
+        };
+        CppLexState state;
+        size_t lineStart = 0;
+        while (lineStart <= text.size()) {
+            const size_t lineEnd = FindByteOf(text, lineStart, '\n', '\n');
+            std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            m_tokens.clear();
+            LexCppLine(line, state, m_tokens);
+            for (const CppToken& token : m_tokens) {
+                const std::string_view word =
+                    line.substr(static_cast<size_t>(token.start), static_cast<size_t>(token.end - token.start));
+                if (token.kind == CppTokenKind::Type) {
+                    add(word, WorkspaceSymbolKind::Type);
+                } else if (token.kind == CppTokenKind::Function) {
+                    add(word, WorkspaceSymbolKind::Function);
+                } else if (token.kind == CppTokenKind::Preprocessor && word[0] == '#') {
+                    add(DefinedMacro(word), WorkspaceSymbolKind::Macro);
+                }
+            }
+            lineStart = lineEnd + 1;
+        }
+        std::sort(entry.names.begin(), entry.names.end());
+        entry.names.erase(std::unique(entry.names.begin(), entry.names.end()), entry.names.end());
+    }
+
+    m_files[key] = std::move(entry);
+    m_dirty = true;
+}
+
+uint32_t SymbolIndex::Intern(std::string_view name, WorkspaceSymbolKind kind) {
+    const auto found = m_nameIds.find(name);
+    if (found != m_nameIds.end()) {
+        // A name seen as several kinds keeps the most specific: macro, type, function.
+        m_kinds[found->second] = std::max(m_kinds[found->second], kind);
+        return found->second;
+    }
+    const uint32_t id = static_cast<uint32_t>(m_names.size());
+    m_names.emplace_back(name);
+    m_kinds.push_back(kind);
+    m_nameIds.emplace(m_names.back(), id);
+    return id;
+}
+
+// Encodes the current files into a new table and hands it to Table().
+void SymbolIndex::Publish() {
+    m_dirty = false;
+
+    std::vector<uint32_t> fileCounts(m_names.size(), 0);
+    for (const auto& file : m_files) {
+        for (uint32_t id : file.second.names) {
+            ++fileCounts[id];
+        }
+    }
+    std::vector<uint32_t> live;
+    for (uint32_t id = 0; id < fileCounts.size(); ++id) {
+        if (fileCounts[id] > 0) live.push_back(id);
+    }
+    std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) { return m_names[a] < m_names[b]; });
+    std::vector<uint32_t> symbolIndex(m_names.size(), UINT32_MAX);
+    for (uint32_t i = 0; i < live.size(); ++i) {
+        symbolIndex[live[i]] = i;
+    }
+
+    std::vector<const std::pair<const std::string, FileEntry>*> files;
+    files.reserve(m_files.size());
+    uint64_t refCount = 0;
+    for (const auto& file : m_files) {
+        files.push_back(&file);
+        refCount += file.second.names.size();
+    }
+    std::sort(files.begin(), files.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    std::string pool;
+    std::string fileRecords;
+    std::string refs;
+    std::string symbolRecords;
+    fileRecords.reserve(files.size() * sizeof(FileRecord));
+    refs.reserve(refCount * sizeof(uint32_t));
+    symbolRecords.reserve(live.size() * sizeof(SymbolRecord));
+    for (uint32_t id : live) {
+        SymbolRecord record{};
+        record.nameOffset = static_cast<uint32_t>(pool.size());
+        record.nameLength = static_cast<uint16_t>(m_names[id].size());
+        record.kind = static_cast<uint8_t>(m_kinds[id]);
+        record.fileCount = fileCounts[id];
+        pool += m_names[id];
+        Append(symbolRecords, record);
+    }
+    std::vector<uint32_t> fileRefs;
+    uint32_t firstRef = 0;
+    for (const auto* file : files) {
+        fileRefs.clear();
+        for (uint32_t id : file->second.names) {
+            fileRefs.push_back(symbolIndex[id]);
+        }
+        std::sort(fileRefs.begin(), fileRefs.end());
+        FileRecord record{};
+        record.size = file->second.stamp.size;
+        record.mtime = file->second.stamp.mtime;
+        record.pathOffset = static_cast<uint32_t>(pool.size());
+        record.pathLength = static_cast<uint32_t>(file->first.size());
+        record.firstRef = firstRef;
+        record.refCount = static_cast<uint32_t>(fileRefs.size());
+        pool += file->first;
+        Append(fileRecords, record);
+        refs.append(reinterpret_cast<const char*>(fileRefs.data()), fileRefs.size() * sizeof(uint32_t));
+        firstRef += record.refCount;
+    }
+
+    TableHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.fileCount = static_cast<uint32_t>(files.size());
+    header.symbolCount = static_cast<uint32_t>(live.size());
+    header.refCount = firstRef;
+    header.rootOffset = sizeof(TableHeader);
+    header.rootLength = m_root.size();
+    header.filesOffset = header.rootOffset + header.rootLength;
+    header.refsOffset = header.filesOffset + fileRecords.size();
+    header.symbolsOffset = header.refsOffset + refs.size();
+    header.poolOffset = header.symbolsOffset + symbolRecords.size();
+    header.poolSize = pool.size();
+
+    std::string data;
+    data.reserve(header.poolOffset + pool.size());
+    Append(data, header);
+    data += m_root;
+    data += fileRecords;
+    data += refs;
+    data += symbolRecords;
+    data += pool;
+
+    std::shared_ptr<const SymbolTable> table = SymbolTable::FromData(std::move(data));
+    if (!table) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_table = std::move(table);
+    m_unsaved = true;
+}
+
+void SymbolIndex::Save() {
+    const std::shared_ptr<const SymbolTable> table = Table();
+    const fs::path target = fs::u8path(m_storagePath);
+    fs::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        const std::string_view data = table->Data();
+        if (!file.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, target, ec);
+    if (!ec) {
+        m_unsaved = false;
+    }
+}
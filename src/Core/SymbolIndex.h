@@ -0,0 +1,129 @@
+#pragma once
+#include "CppLexer.h"
+#include "FileContents.h"
+#include "FuzzyMatch.h"
+#include "TrigramIndex.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class WorkspaceSymbolKind : uint8_t { Function, Type, Macro };
+
+struct WorkspaceSymbol {
+    std::string_view name;
+    WorkspaceSymbolKind kind = WorkspaceSymbolKind::Function;
+    uint32_t fileCount = 0; // files mentioning it
+};
+
+// Symbols of a workspace in one flat, read-only buffer: a header, the indexed files
+// (path, stamp and the symbols each one mentions), the symbols sorted by name and a
+// string pool. It is also the layout of the stored index, so a loaded table is used
+// straight from the mapped file without decoding. Integers are host byte order; the
+// file is a local cache, not an exchange format.
+class SymbolTable {
+public:
+    struct File {
+        std::string_view path;
+        FileStamp stamp;
+        const char* refs = nullptr; // refCount uint32 symbol indices
+        uint32_t refCount = 0;
+    };
+
+    SymbolTable() = default;
+    // Null when `path` is missing or not a valid table.
+    static std::shared_ptr<const SymbolTable> Load(const std::string& path);
+    static std::shared_ptr<const SymbolTable> FromData(std::string data);
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    std::string_view Data() const { return m_data; }
+    std::string_view Root() const;
+    size_t FileCount() const { return m_fileCount; }
+    size_t SymbolCount() const { return m_symbolCount; }
+    File FileAt(size_t index) const;
+    WorkspaceSymbol SymbolAt(size_t index) const;
+
+    // Appends up to `limit` symbols matching `query` other than the query itself, best
+    // match first, then the ones mentioned by most files. Only symbols starting with
+    // the query's first byte (in either case) are considered: ranking the whole table
+    // would cost milliseconds per keystroke. Nothing for an empty query.
+    void Complete(const FuzzyMatcher& query, size_t limit, std::vector<WorkspaceSymbol>& out) const;
+
+private:
+    bool Validate();
+    // First symbol not sorting before `name`.
+    size_t LowerBound(std::string_view name) const;
+
+    std::string m_buffer;
+    std::unique_ptr<FileContents> m_file;
+    std::string_view m_data;
+    size_t m_fileCount = 0;
+    size_t m_symbolCount = 0;
+};
+
+// Background indexer of the function, type and macro names in a workspace's C and
+// C++ sources, for local completion while clangd is unavailable or still indexing.
+// Files are tokenized with LexCppLine, not compiled. The table is stored in
+// `storagePath` and served from there on the next start while the worker re-stats the
+// tree; files saved from Fin are re-read through OnFileChanged.
+class SymbolIndex {
+public:
+    explicit SymbolIndex(std::string storagePath);
+    ~SymbolIndex();
+
+    SymbolIndex(const SymbolIndex&) = delete;
+    SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+    // Switches to `root`; no-op for the current one.
+    void Open(const std::filesystem::path& root);
+    void OnFileChanged(const std::filesystem::path& path);
+
+    // Latest published table of the current root (possibly still the stored one);
+    // never null.
+    std::shared_ptr<const SymbolTable> Table() const;
+
+private:
+    struct FileEntry {
+        FileStamp stamp;
+        std::vector<uint32_t> names; // ids into m_names, sorted
+    };
+
+    void WorkLoop();
+    void Reset(const std::string& root, std::shared_ptr<const SymbolTable> stored);
+    bool Refresh(const std::string& root);
+    void IndexFile(const std::string& key, const std::filesystem::path& path, const FileStamp& stamp);
+    uint32_t Intern(std::string_view name, WorkspaceSymbolKind kind);
+    void Publish();
+    void Save();
+
+    const std::string m_storagePath;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::string m_requestedRoot;
+    std::vector<std::filesystem::path> m_changed;
+    bool m_stop = false;
+    std::shared_ptr<const SymbolTable> m_table; // guarded by m_mutex
+    std::thread m_thread;
+
+    // Worker only.
+    std::string m_root;
+    bool m_dirty = false; // files changed since the last Publish
+    bool m_unsaved = false;
+    std::unordered_map<std::string, FileEntry> m_files;
+    std::deque<std::string> m_names; // a deque, so the keys of m_nameIds stay valid
+    std::unordered_map<std::string_view, uint32_t> m_nameIds;
+    std::vector<WorkspaceSymbolKind> m_kinds;
+    std::string m_readBuffer;
+    std::vector<CppToken> m_tokens;
+};
@@ -0,0 +1,341 @@
+#include "TextDocument.h"
+
+#include <cstring>
+
+namespace {
+
+// Past this many pieces lookups and prefix-sum updates start to dominate; the
+// document is then flattened back into a single original buffer.
+constexpr size_t kMaxPieces = 4096;
+
+size_t MatchingPrefixLength(std::string_view lhs, std::string_view rhs) {
+    const size_t count = std::min(lhs.size(), rhs.size());
+    if (std::memcmp(lhs.data(), rhs.data(), count) == 0) {
+        return count;
+    }
+    const auto mismatch = std::mismatch(lhs.begin(), lhs.begin() + count, rhs.begin());
+    return static_cast<size_t>(mismatch.first - lhs.begin());
+}
+
+size_t MatchingSuffixLength(std::string_view lhs, std::string_view rhs) {
+    const size_t count = std::min(lhs.size(), rhs.size());
+    const char* lhsTail = lhs.data() + lhs.size() - count;
+    const char* rhsTail = rhs.data() + rhs.size() - count;
+    if (std::memcmp(lhsTail, rhsTail, count) == 0) {
+        return count;
+    }
+    size_t matched = 0;
+    while (matched < count && lhs[lhs.size() - 1 - matched] == rhs[rhs.size() - 1 - matched]) {
+        ++matched;
+    }
+    return matched;
+}
+
+} // namespace
+
+TextDocument::TextDocument() = default;
+
+TextDocument::TextDocument(std::string text) {
+    SetText(std::move(text));
+}
+
+void TextDocument::SetText(std::string text) {
+    m_original = std::move(text);
+    m_add.clear();
+    m_pieces.clear();
+    m_pieceStarts.clear();
+    m_size = m_original.size();
+    if (m_size > 0) {
+        m_pieces.push_back({PieceSource::Original, 0, m_size});
+        m_pieceStarts.push_back(0);
+    }
+    m_lineStarts.assign(1, 0);
+    for (size_t pos = m_original.find('\n'); pos != std::string::npos; pos = m_original.find('\n', pos + 1)) {
+        m_lineStarts.push_back(pos + 1);
+    }
+    m_flat.clear();
+    m_flatValid = m_size == 0;
+    ++m_version;
+}
+
+void TextDocument::Insert(size_t offset, std::string_view text) {
+    Replace(offset, 0, text);
+}
+
+void TextDocument::Erase(size_t offset, size_t length) {
+    Replace(offset, length, std::string_view());
+}
+
+void TextDocument::Replace(size_t offset, size_t length, std::string_view text) {
+    offset = std::min(offset, m_size);
+    length = std::min(length, m_size - offset);
+    if (length == 0 && text.empty()) {
+        return;
+    }
+
+    UpdateLineStarts(offset, length, text);
+    const size_t first = SplitAt(offset);
+    const size_t last = SplitAt(offset + length);
+    m_pieces.erase(m_pieces.begin() + static_cast<std::ptrdiff_t>(first),
+                   m_pieces.begin() + static_cast<std::ptrdiff_t>(last));
+    m_pieceStarts.erase(m_pieceStarts.begin() + static_cast<std::ptrdiff_t>(first),
+                        m_pieceStarts.begin() + static_cast<std::ptrdiff_t>(last));
+
+    if (!text.empty()) {
+        // Typing appends to the add buffer right after the previous insertion, so the
+        // preceding piece can simply grow instead of adding a piece per keystroke.
+        Piece* previous = first > 0 ? &m_pieces[first - 1] : nullptr;
+        if (previous && previous->source == PieceSource::Add &&
+            previous->start + previous->length == m_add.size()) {
+            previous->length += text.size();
+        } else {
+            m_pieces.insert(m_pieces.begin() + static_cast<std::ptrdiff_t>(first),
+                            Piece{PieceSource::Add, m_add.size(), text.size()});
+            m_pieceStarts.insert(m_pieceStarts.begin() + static_cast<std::ptrdiff_t>(first), offset);
+        }
+        m_add.append(text.data(), text.size());
+    }
+
+    m_size = m_size - length + text.size();
+    RebuildPieceStarts(first > 0 ? first - 1 : 0);
+    m_flatValid = false;
+    ++m_version;
+    CompactIfFragmented();
+}
+
+void TextDocument::Apply(const TextChange& change) {
+    Replace(change.offset, change.removedText.size(), change.insertedText);
+}
+
+uint64_t TextDocument::ContentHash() const {
+    if (m_hashVersion != m_version) {
+        uint64_t hash = 1469598103934665603ull;
+        ForEachChunk(0, m_size, [&hash](std::string_view chunk) {
+            for (const char ch : chunk) {
+                hash ^= static_cast<unsigned char>(ch);
+                hash *= 1099511628211ull;
+            }
+            return true;
+        });
+        m_hash = hash;
+        m_hashVersion = m_version;
+    }
+    return m_hash;
+}
+
+char TextDocument::CharAt(size_t offset) const {
+    if (offset >= m_size) {
+        return '\0';
+    }
+    if (m_flatValid) {
+        return m_flat[offset];
+    }
+    const size_t index = FindPiece(offset);
+    return PieceView(m_pieces[index])[offset - m_pieceStarts[index]];
+}
+
+std::string TextDocument::Substr(size_t offset, size_t length) const {
+    std::string out;
+    if (offset >= m_size) {
+        return out;
+    }
+    length = std::min(length, m_size - offset);
+    if (m_flatValid) {
+        return m_flat.substr(offset, length);
+    }
+    out.reserve(length);
+    ForEachChunk(offset, length, [&](std::string_view chunk) {
+        out.append(chunk.data(), chunk.size());
+        return true;
+    });
+    return out;
+}
+
+const std::string& TextDocument::Text() const {
+    if (!m_flatValid) {
+        m_flat.clear();
+        m_flat.reserve(m_size);
+        for (const Piece& piece : m_pieces) {
+            const std::string_view view = PieceView(piece);
+            m_flat.append(view.data(), view.size());
+        }
+        m_flatValid = true;
+    }
+    return m_flat;
+}
+
+size_t TextDocument::LineStart(size_t line) const {
+    if (line >= m_lineStarts.size()) {
+        return m_size;
+    }
+    return m_lineStarts[line];
+}
+
+size_t TextDocument::LineEnd(size_t line) const {
+    if (line + 1 >= m_lineStarts.size()) {
+        return m_size;
+    }
+    return m_lineStarts[line + 1] - 1;
+}
+
+size_t TextDocument::LineFromOffset(size_t offset) const {
+    const auto it = std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), std::min(offset, m_size));
+    return static_cast<size_t>(std::distance(m_lineStarts.begin(), it)) - 1;
+}
+
+size_t TextDocument::OffsetFromLineColumn(size_t line, size_t column) const {
+    if (line >= m_lineStarts.size()) {
+        return m_size;
+    }
+    const size_t start = m_lineStarts[line];
+    return start + std::min(column, LineEnd(line) - start);
+}
+
+size_t TextDocument::Utf16ColumnFromOffset(size_t offset) const {
+    offset = std::min(offset, m_size);
+    const size_t start = m_lineStarts[LineFromOffset(offset)];
+    size_t units = 0;
+    ForEachChunk(start, offset - start, [&](std::string_view chunk) {
+        for (const char ch : chunk) {
+            const unsigned char uch = static_cast<unsigned char>(ch);
+            if ((uch & 0xC0) == 0x80) {
+                continue;
+            }
+            // 4-byte sequences are outside the BMP and take a surrogate pair.
+            units += (uch >= 0xF0) ? 2 : 1;
+        }
+        return true;
+    });
+    return units;
+}
+
+size_t TextDocument::OffsetFromUtf16Column(size_t line, size_t utf16Column) const {
+    if (line >= m_lineStarts.size()) {
+        return m_size;
+    }
+    const size_t start = m_lineStarts[line];
+    const size_t end = LineEnd(line);
+    size_t offset = start;
+    size_t units = 0;
+    ForEachChunk(start, end - start, [&](std::string_view chunk) {
+        for (const char ch : chunk) {
+            const unsigned char uch = static_cast<unsigned char>(ch);
+            if ((uch & 0xC0) != 0x80) {
+                if (units >= utf16Column) {
+                    return false;
+                }
+                units += (uch >= 0xF0) ? 2 : 1;
+            }
+            ++offset;
+        }
+        return true;
+    });
+    return offset;
+}
+
+TextChange TextDocument::DiffAgainst(std::string_view newText, size_t prefixLimit) const {
+    const size_t maxPrefix = std::min({m_size, newText.size(), prefixLimit});
+    size_t prefix = 0;
+    ForEachChunk(0, maxPrefix, [&](std::string_view chunk) {
+        const size_t matched = MatchingPrefixLength(chunk, newText.substr(prefix, chunk.size()));
+        prefix += matched;
+        return matched == chunk.size();
+    });
+
+    const size_t maxSuffix = std::min(m_size - prefix, newText.size() - prefix);
+    size_t suffix = 0;
+    if (maxSuffix > 0) {
+        const size_t suffixStart = m_size - maxSuffix;
+        for (size_t index = m_pieces.size(); index-- > 0 && suffix < maxSuffix;) {
+            const size_t pieceStart = m_pieceStarts[index];
+            const size_t pieceEnd = pieceStart + m_pieces[index].length;
+            const size_t end = m_size - suffix;
+            if (pieceStart >= end) {
+                continue;
+            }
+            const size_t begin = std::max(pieceStart, suffixStart);
+            const std::string_view chunk =
+                PieceView(m_pieces[index]).substr(begin - pieceStart, std::min(end, pieceEnd) - begin);
+            const std::string_view other = newText.substr(newText.size() - suffix - chunk.size(), chunk.size());
+            const size_t matched = MatchingSuffixLength(chunk, other);
+            suffix += matched;
+            if (matched != chunk.size() || begin == suffixStart) {
+                break;
+            }
+        }
+    }
+
+    TextChange change;
+    change.offset = prefix;
+    change.removedText = Substr(prefix, m_size - prefix - suffix);
+    change.insertedText.assign(newText.substr(prefix, newText.size() - prefix - suffix));
+    return change;
+}
+
+std::string_view TextDocument::PieceView(const Piece& piece) const {
+    const std::string& buffer = piece.source == PieceSource::Original ? m_original : m_add;
+    return std::string_view(buffer).substr(piece.start, piece.length);
+}
+
+size_t TextDocument::FindPiece(size_t offset) const {
+    if (offset >= m_size) {
+        return m_pieces.size();
+    }
+    const auto it = std::upper_bound(m_pieceStarts.begin(), m_pieceStarts.end(), offset);
+    return static_cast<size_t>(std::distance(m_pieceStarts.begin(), it)) - 1;
+}
+
+size_t TextDocument::SplitAt(size_t offset) {
+    const size_t index = FindPiece(offset);
+    if (index >= m_pieces.size() || m_pieceStarts[index] == offset) {
+        return index;
+    }
+
+    const size_t headLength = offset - m_pieceStarts[index];
+    Piece tail = m_pieces[index];
+    tail.start += headLength;
+    tail.length -= headLength;
+    m_pieces[index].length = headLength;
+    m_pieces.insert(m_pieces.begin() + static_cast<std::ptrdiff_t>(index + 1), tail);
+    m_pieceStarts.insert(m_pieceStarts.begin() + static_cast<std::ptrdiff_t>(index + 1), offset);
+    return index + 1;
+}
+
+void TextDocument::RebuildPieceStarts(size_t fromPiece) {
+    m_pieceStarts.resize(m_pieces.size());
+    size_t start = fromPiece > 0 ? m_pieceStarts[fromPiece - 1] + m_pieces[fromPiece - 1].length : 0;
+    for (size_t index = fromPiece; index < m_pieces.size(); ++index) {
+        m_pieceStarts[index] = start;
+        start += m_pieces[index].length;
+    }
+}
+
+void TextDocument::UpdateLineStarts(size_t offset, size_t removedLength, std::string_view inserted) {
+    // Line starts are the offsets just past each '\n'; those produced by removed
+    // newlines fall in (offset, offset + removedLength].
+    const auto firstRemoved = std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset);
+    const auto lastRemoved = std::upper_bound(firstRemoved, m_lineStarts.end(), offset + removedLength);
+    const auto tail = m_lineStarts.erase(firstRemoved, lastRemoved);
+
+    const std::ptrdiff_t delta =
+        static_cast<std::ptrdiff_t>(inserted.size()) - static_cast<std::ptrdiff_t>(removedLength);
+    for (auto it = tail; it != m_lineStarts.end(); ++it) {
+        *it = static_cast<size_t>(static_cast<std::ptrdiff_t>(*it) + delta);
+    }
+
+    std::vector<size_t> insertedStarts;
+    for (size_t pos = inserted.find('\n'); pos != std::string_view::npos; pos = inserted.find('\n', pos + 1)) {
+        insertedStarts.push_back(offset + pos + 1);
+    }
+    m_lineStarts.insert(tail, insertedStarts.begin(), insertedStarts.end());
+}
+
+void TextDocument::CompactIfFragmented() {
+    if (m_pieces.size() <= kMaxPieces) {
+        return;
+    }
+    // Same text, so the version (and any hash cached for it) stays.
+    const uint64_t version = m_version;
+    SetText(std::string(Text()));
+    m_version = version;
+}
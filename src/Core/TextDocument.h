@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A single contiguous edit: `removedText` at `offset` was replaced by `insertedText`.
+struct TextChange {
+    size_t offset = 0;
+    std::string removedText;
+    std::string insertedText;
+};
+
+// Piece-table text storage. The original text is kept immutable, inserted text is
+// appended to an add buffer and the document is described by a list of pieces
+// pointing into both buffers, so edits never move the bulk of the text.
+// A line-start index is maintained alongside and updated from each edit.
+class TextDocument {
+public:
+    TextDocument();
+    explicit TextDocument(std::string text);
+
+    void SetText(std::string text);
+    void Insert(size_t offset, std::string_view text);
+    void Erase(size_t offset, size_t length);
+    void Replace(size_t offset, size_t length, std::string_view text);
+    void Apply(const TextChange& change);
+
+    // Bumped by every change, including SetText; never repeats for one document.
+    uint64_t Version() const { return m_version; }
+    // FNV-1a hash of the whole text, computed at most once per version.
+    uint64_t ContentHash() const;
+
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+    char CharAt(size_t offset) const;
+    std::string Substr(size_t offset, size_t length) const;
+
+    // Contiguous copy of the document, rebuilt lazily after edits.
+    const std::string& Text() const;
+
+    // Calls fn(std::string_view) for each contiguous chunk covering [offset, offset + length).
+    // Iteration stops early when fn returns false.
+    template <typename Fn>
+    void ForEachChunk(size_t offset, size_t length, Fn&& fn) const;
+
+    // Line index: lines are separated by '\n'; columns are byte offsets within a line.
+    size_t LineCount() const { return m_lineStarts.size(); }
+    size_t LineStart(size_t line) const;
+    size_t LineEnd(size_t line) const;
+    size_t LineFromOffset(size_t offset) const;
+    size_t OffsetFromLineColumn(size_t line, size_t column) const;
+
+    // UTF-16 code unit columns, as used by LSP positions.
+    size_t Utf16ColumnFromOffset(size_t offset) const;
+    size_t OffsetFromUtf16Column(size_t line, size_t utf16Column) const;
+
+    // Smallest single edit turning this document into `newText`. The common prefix is
+    // capped at `prefixLimit` so ambiguous runs (e.g. deleting one of two quotes) are
+    // attributed to the caret position.
+    TextChange DiffAgainst(std::string_view newText, size_t prefixLimit) const;
+
+    size_t PieceCount() const { return m_pieces.size(); }
+
+private:
+    enum class PieceSource : uint8_t { Original, Add };
+
+    struct Piece {
+        PieceSource source = PieceSource::Original;
+        size_t start = 0;
+        size_t length = 0;
+    };
+
+    std::string_view PieceView(const Piece& piece) const;
+    size_t FindPiece(size_t offset) const;
+    size_t SplitAt(size_t offset);
+    void RebuildPieceStarts(size_t fromPiece);
+    void CompactIfFragmented();
+    void UpdateLineStarts(size_t offset, size_t removedLength, std::string_view inserted);
+
+    std::string m_original;
+    std::string m_add;
+    std::vector<Piece> m_pieces;
+    std::vector<size_t> m_pieceStarts;
+    size_t m_size = 0;
+    std::vector<size_t> m_lineStarts{0};
+    uint64_t m_version = 0;
+
+    mutable uint64_t m_hash = 0;
+    mutable uint64_t m_hashVersion = UINT64_MAX;
+
+    mutable std::string m_flat;
+    mutable bool m_flatValid = true;
+};
+
+template <typename Fn>
+void TextDocument::ForEachChunk(size_t offset, size_t length, Fn&& fn) const {
+    if (offset >= m_size || length == 0) {
+        return;
+    }
+    size_t remaining = std::min(length, m_size - offset);
+    for (size_t index = FindPiece(offset); index < m_pieces.size() && remaining > 0; ++index) {
+        const std::string_view view = PieceView(m_pieces[index]);
+        const size_t skip = offset > m_pieceStarts[index] ? offset - m_pieceStarts[index] : 0;
+        const size_t take = std::min(remaining, view.size() - skip);
+        if (!fn(view.substr(skip, take))) {
+            return;
+        }
+        remaining -= take;
+    }
+}
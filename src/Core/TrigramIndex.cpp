@@ -0,0 +1,606 @@
+#include "TrigramIndex.h"
+#include "WorkspaceSearch.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'I', 'N', 'T', 'R', 'I', '0', '1'};
+constexpr size_t kTrigramSpace = size_t(1) << 24;
+// Same probe as WorkspaceSearch: such files are skipped there, so they are indexed
+// without trigrams and never become candidates.
+constexpr size_t kBinaryProbeBytes = 8192;
+// Not indexed at all (and therefore always searched); WorkspaceSearch skips them anyway.
+constexpr uint64_t kMaxIndexedFileBytes = 64u * 1024u * 1024u;
+// How often (in files) a refresh checks for shutdown or a new root.
+constexpr size_t kInterruptCheckFiles = 256;
+
+uint32_t FoldByte(char ch) {
+    const unsigned char byte = static_cast<unsigned char>(ch);
+    return (byte >= 'A' && byte <= 'Z') ? byte - 'A' + 'a' : byte;
+}
+
+uint32_t TrigramAt(std::string_view text, size_t i) {
+    return (FoldByte(text[i]) << 16) | (FoldByte(text[i + 1]) << 8) | FoldByte(text[i + 2]);
+}
+
+void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool GetVarint(std::string_view data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends the ids of one encoded posting; `start` is the id its first delta is from.
+void DecodePosting(std::string_view bytes, uint64_t start, std::vector<uint32_t>& ids) {
+    size_t pos = 0;
+    uint64_t id = start;
+    uint64_t delta = 0;
+    while (GetVarint(bytes, pos, delta)) {
+        id += delta;
+        ids.push_back(static_cast<uint32_t>(id));
+    }
+}
+
+// `key` is the workspace key of `root` or of something below it.
+bool IsUnderRoot(const std::string& key, const std::string& root) {
+    if (root.empty() || key.compare(0, root.size(), root) != 0) {
+        return false;
+    }
+    return key.size() == root.size() || root.back() == '/' || key[root.size()] == '/';
+}
+
+} // namespace
+
+std::string WorkspacePathKey(const fs::path& path) {
+    return path.generic_u8string();
+}
+
+std::string WorkspaceRootKey(const fs::path& root) {
+    std::string key = WorkspacePathKey(root.lexically_normal());
+    // "dir" and "dir/" name the same root.
+    if (key.size() > 1 && key.back() == '/' && key[key.size() - 2] != ':') {
+        key.pop_back();
+    }
+    return key;
+}
+
+bool ReadFileStamp(const fs::directory_entry& entry, FileStamp& stamp) {
+#ifdef _WIN32
+    // Both come cached from the directory listing.
+    std::error_code ec;
+    stamp.size = entry.file_size(ec);
+    if (ec) return false;
+    const auto written = entry.last_write_time(ec);
+    if (ec) return false;
+    stamp.mtime = static_cast<int64_t>(written.time_since_epoch().count());
+    return true;
+#else
+    // One stat instead of one per directory_entry query.
+    struct stat info;
+    if (stat(entry.path().c_str(), &info) != 0) return false;
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+#endif
+}
+
+bool TrigramFilter::MustSearch(const fs::path& path, const FileStamp& stamp) const {
+    const auto it = m_table->files.find(WorkspacePathKey(path));
+    if (it == m_table->files.end() || it->second.stamp != stamp) {
+        return true;
+    }
+    return it->second.id < m_candidate.size() && m_candidate[it->second.id];
+}
+
+TrigramIndex::TrigramIndex(std::string storagePath)
+    : m_storagePath(std::move(storagePath)) {
+    m_thread = std::thread(&TrigramIndex::WorkLoop, this);
+}
+
+TrigramIndex::~TrigramIndex() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void TrigramIndex::Open(const fs::path& root) {
+    const std::string key = WorkspaceRootKey(root);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (key == m_requestedRoot) return;
+        m_requestedRoot = key;
+    }
+    m_cv.notify_all();
+}
+
+void TrigramIndex::OnFileChanged(const fs::path& path) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changed.push_back(path.lexically_normal());
+    }
+    m_cv.notify_all();
+}
+
+bool TrigramIndex::IsReady() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready;
+}
+
+size_t TrigramIndex::FileCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_table->files.size();
+}
+
+std::shared_ptr<const TrigramFilter> TrigramIndex::Filter(
+    const fs::path& root,
+    const std::string& query,
+    const FindOptions& options) const {
+    const std::string literal = options.regex ? RequiredRegexLiteral(query) : query;
+    if (literal.size() < 3) {
+        return nullptr;
+    }
+    std::vector<uint32_t> trigrams;
+    for (size_t i = 0; i + 3 <= literal.size(); ++i) {
+        trigrams.push_back(TrigramAt(literal, i));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Paths are keyed from the indexed root, so a search of any folder inside it
+    // can use the same table.
+    if (!m_ready || !IsUnderRoot(WorkspaceRootKey(root), m_root)) {
+        return nullptr;
+    }
+
+    auto filter = std::make_shared<TrigramFilter>();
+    filter->m_table = m_table;
+    filter->m_candidate.assign(m_nextId, false);
+
+    std::vector<std::pair<uint32_t, uint32_t>> byCount; // (count, trigram)
+    for (uint32_t trigram : trigrams) {
+        const BasePosting* base = FindBase(trigram);
+        const auto added = m_postings.find(trigram);
+        const uint32_t count = (base != nullptr ? base->count : 0) + (added != m_postings.end() ? added->second.count : 0);
+        if (count == 0) {
+            return filter; // no file has this trigram
+        }
+        byCount.emplace_back(count, trigram);
+    }
+    // Shortest list first keeps every intermediate result small.
+    std::sort(byCount.begin(), byCount.end());
+
+    std::vector<uint32_t> result;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> merged;
+    DecodeIds(byCount.front().second, result);
+    for (size_t i = 1; i < byCount.size() && !result.empty(); ++i) {
+        DecodeIds(byCount[i].second, next);
+        merged.clear();
+        std::set_intersection(result.begin(), result.end(), next.begin(), next.end(), std::back_inserter(merged));
+        result.swap(merged);
+    }
+    for (uint32_t id : result) {
+        filter->m_candidate[id] = true;
+    }
+    return filter;
+}
+
+const TrigramIndex::BasePosting* TrigramIndex::FindBase(uint32_t trigram) const {
+    const auto it = std::lower_bound(
+        m_basePostings.begin(),
+        m_basePostings.end(),
+        trigram,
+        [](const BasePosting& posting, uint32_t value) { return posting.trigram < value; });
+    return it != m_basePostings.end() && it->trigram == trigram ? &*it : nullptr;
+}
+
+void TrigramIndex::DecodeIds(uint32_t trigram, std::vector<uint32_t>& ids) const {
+    ids.clear();
+    const BasePosting* base = FindBase(trigram);
+    if (base != nullptr) {
+        DecodePosting(std::string_view(m_base).substr(base->offset, base->length), 0, ids);
+    }
+    const auto added = m_postings.find(trigram);
+    if (added != m_postings.end()) {
+        DecodePosting(added->second.bytes, base != nullptr ? base->last : 0, ids);
+    }
+}
+
+void TrigramIndex::WorkLoop() {
+    m_seen.assign(kTrigramSpace / 64, 0);
+    while (true) {
+        std::string root;
+        std::vector<fs::path> changed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] {
+                return m_stop || m_requestedRoot != m_root || !m_changed.empty();
+            });
+            if (m_stop) break;
+            if (m_requestedRoot != m_root) {
+                root = m_requestedRoot;
+            }
+            changed.swap(m_changed);
+        }
+
+        if (!root.empty()) {
+            if (!Load(root)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_root = root;
+                m_ready = false;
+                m_dirty = true;
+                m_table = std::make_shared<TrigramFileTable>();
+                m_base.clear();
+                m_basePostings.clear();
+                m_postings.clear();
+                m_nextId = 0;
+            }
+            Refresh(root);
+            if (m_dirty) {
+                Save();
+            }
+        }
+
+        for (const fs::path& path : changed) {
+            const std::string key = WorkspacePathKey(path);
+            if (key == m_root || !IsUnderRoot(key, m_root)) {
+                continue;
+            }
+            fs::directory_entry entry;
+            FileStamp stamp;
+            std::error_code ec;
+            entry.assign(path, ec);
+            if (!ec && entry.is_regular_file(ec) && !HasBinaryExtension(path) && ReadFileStamp(entry, stamp) &&
+                stamp.size <= kMaxIndexedFileBytes) {
+                IndexFile(key, path, stamp);
+            } else {
+                RemoveFile(key);
+            }
+        }
+    }
+
+    if (m_dirty) {
+        Save();
+    }
+}
+
+void TrigramIndex::Refresh(const std::string& root) {
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(fs::u8path(root), fs::directory_options::skip_permission_denied, ec);
+    const fs::recursive_directory_iterator end;
+    size_t visited = 0;
+    for (; !ec && it != end; it.increment(ec)) {
+        if (++visited % kInterruptCheckFiles == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stop || m_requestedRoot != root) {
+                return; // leaves m_ready unset; a later pass finishes the job
+            }
+        }
+        const fs::directory_entry& entry = *it;
+        std::error_code statEc;
+        if (entry.is_directory(statEc)) {
+            if (IsSkippedWorkspaceDirectory(entry.path())) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        FileStamp stamp;
+        if (!entry.is_regular_file(statEc) || HasBinaryExtension(entry.path()) || !ReadFileStamp(entry, stamp) ||
+            stamp.size > kMaxIndexedFileBytes) {
+            continue;
+        }
+
+        std::string key = WorkspacePathKey(entry.path());
+        bool current = false;
+        {
+            // Only this thread modifies the table, so reading it needs no lock.
+            const auto found = m_table->files.find(key);
+            current = found != m_table->files.end() && found->second.stamp == stamp;
+        }
+        if (!current) {
+            IndexFile(key, entry.path(), stamp);
+        }
+        seen.insert(std::move(key));
+    }
+    if (ec) {
+        return;
+    }
+
+    std::vector<std::string> removed;
+    for (const auto& file : m_table->files) {
+        if (seen.count(file.first) == 0) {
+            removed.push_back(file.first);
+        }
+    }
+    for (const std::string& key : removed) {
+        RemoveFile(key);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready = true;
+}
+
+void TrigramIndex::IndexFile(const std::string& key, const fs::path& path, const FileStamp& stamp) {
+    std::string text;
+    {
+        std::ifstream in(path, std::ios::binary);
+        text.resize(static_cast<size_t>(stamp.size));
+        if (!in || !in.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+            RemoveFile(key);
+            return;
+        }
+    }
+
+    m_trigrams.clear();
+    const bool binary = std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbeBytes)) != nullptr;
+    if (!binary) {
+        for (size_t i = 0; i + 3 <= text.size(); ++i) {
+            const uint32_t trigram = TrigramAt(text, i);
+            uint64_t& word = m_seen[trigram >> 6];
+            const uint64_t bit = uint64_t(1) << (trigram & 63);
+            if ((word & bit) == 0) {
+                word |= bit;
+                m_trigrams.push_back(trigram);
+            }
+        }
+        for (uint32_t trigram : m_trigrams) {
+            m_seen[trigram >> 6] = 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint32_t id = m_nextId++;
+    for (uint32_t trigram : m_trigrams) {
+        auto added = m_postings.find(trigram);
+        if (added == m_postings.end()) {
+            // Continues the stored list, if any: its ids are all smaller.
+            const BasePosting* base = FindBase(trigram);
+            added = m_postings.emplace(trigram, Posting()).first;
+            added->second.last = base != nullptr ? base->last : 0;
+        }
+        Posting& posting = added->second;
+        PutVarint(posting.bytes, id - posting.last);
+        posting.last = id;
+        ++posting.count;
+    }
+    // A replaced file keeps its old id in the postings until the next Compact; no
+    // path maps to it any more, so it is never reported.
+    MutableTable().files[key] = TrigramFileTable::Record{id, stamp};
+    m_dirty = true;
+}
+
+void TrigramIndex::RemoveFile(const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_table->files.count(key) == 0) return;
+    MutableTable().files.erase(key);
+    m_dirty = true;
+}
+
+TrigramFileTable& TrigramIndex::MutableTable() {
+    // Filters handed out keep reading the old table.
+    if (m_table.use_count() > 1) {
+        m_table = std::make_shared<TrigramFileTable>(*m_table);
+    }
+    return *m_table;
+}
+
+// Rebuilds m_base from the stored and added postings, dropping ids of files that
+// were replaced or removed and renumbering the rest densely.
+void TrigramIndex::Compact() {
+    std::vector<uint32_t> remap(m_nextId, UINT32_MAX);
+    for (const auto& file : m_table->files) {
+        remap[file.second.id] = 0;
+    }
+    uint32_t liveCount = 0;
+    for (uint32_t& id : remap) {
+        if (id == 0) id = liveCount++;
+    }
+
+    std::vector<uint32_t> trigrams;
+    trigrams.reserve(m_basePostings.size() + m_postings.size());
+    for (const BasePosting& posting : m_basePostings) {
+        trigrams.push_back(posting.trigram);
+    }
+    for (const auto& posting : m_postings) {
+        if (FindBase(posting.first) == nullptr) {
+            trigrams.push_back(posting.first);
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+
+    // The worker is the only writer, so the heavy part runs without the lock.
+    std::string base;
+    base.reserve(m_base.size());
+    std::vector<BasePosting> basePostings;
+    basePostings.reserve(trigrams.size());
+    std::vector<uint32_t> ids;
+    for (uint32_t trigram : trigrams) {
+        DecodeIds(trigram, ids);
+        BasePosting posting;
+        posting.trigram = trigram;
+        posting.offset = base.size();
+        for (uint32_t id : ids) {
+            const uint32_t mapped = remap[id];
+            if (mapped == UINT32_MAX) continue;
+            PutVarint(base, mapped - posting.last);
+            posting.last = mapped;
+            ++posting.count;
+        }
+        if (posting.count > 0) {
+            posting.length = static_cast<uint32_t>(base.size() - posting.offset);
+            basePostings.push_back(posting);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_base = std::move(base);
+    m_basePostings = std::move(basePostings);
+    m_postings.clear();
+    for (auto& file : MutableTable().files) {
+        file.second.id = remap[file.second.id];
+    }
+    m_nextId = liveCount;
+}
+
+// Layout, all integers as LEB128 varints: magic, root, file count, then per file (in
+// id order) path, size and zigzag mtime; posting count, then per posting (by
+// trigram) the trigram delta, id count, last id and byte length; then the encoded
+// ids of all postings back to back. Loading keeps that last block as is.
+void TrigramIndex::Save() {
+    Compact();
+
+    std::string out(kMagic, sizeof(kMagic));
+    PutVarint(out, m_root.size());
+    out += m_root;
+
+    std::vector<const std::pair<const std::string, TrigramFileTable::Record>*> byId(m_nextId, nullptr);
+    for (const auto& file : m_table->files) {
+        byId[file.second.id] = &file;
+    }
+    PutVarint(out, byId.size());
+    for (const auto* file : byId) {
+        PutVarint(out, file->first.size());
+        out += file->first;
+        PutVarint(out, file->second.stamp.size);
+        const int64_t mtime = file->second.stamp.mtime;
+        PutVarint(out, (static_cast<uint64_t>(mtime) << 1) ^ static_cast<uint64_t>(mtime >> 63));
+    }
+
+    PutVarint(out, m_basePostings.size());
+    uint32_t previous = 0;
+    for (const BasePosting& posting : m_basePostings) {
+        PutVarint(out, posting.trigram - previous);
+        previous = posting.trigram;
+        PutVarint(out, posting.count);
+        PutVarint(out, posting.last);
+        PutVarint(out, posting.length);
+    }
+
+    const fs::path target = fs::u8path(m_storagePath);
+    fs::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), static_cast<std::streamsize>(out.size())) ||
+            !file.write(m_base.data(), static_cast<std::streamsize>(m_base.size()))) {
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, target, ec);
+    if (!ec) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirty = false;
+    }
+}
+
+bool TrigramIndex::Load(const std::string& root) {
+    std::string data;
+    {
+        std::ifstream in(fs::u8path(m_storagePath), std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(data.data(), static_cast<std::streamsize>(data.size()))) return false;
+    }
+    if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+
+    const std::string_view view(data);
+    size_t pos = sizeof(kMagic);
+    uint64_t length = 0;
+    if (!GetVarint(view, pos, length) || length > view.size() - pos || view.substr(pos, length) != root) {
+        return false;
+    }
+    pos += length;
+
+    auto table = std::make_shared<TrigramFileTable>();
+    uint64_t fileCount = 0;
+    if (!GetVarint(view, pos, fileCount) || fileCount > UINT32_MAX) return false;
+    table->files.reserve(fileCount);
+    for (uint64_t id = 0; id < fileCount; ++id) {
+        TrigramFileTable::Record record;
+        record.id = static_cast<uint32_t>(id);
+        uint64_t mtime = 0;
+        if (!GetVarint(view, pos, length) || length > view.size() - pos) return false;
+        std::string path(view.substr(pos, length));
+        pos += length;
+        if (!GetVarint(view, pos, record.stamp.size) || !GetVarint(view, pos, mtime)) return false;
+        record.stamp.mtime = static_cast<int64_t>((mtime >> 1) ^ (~(mtime & 1) + 1));
+        table->files.emplace(std::move(path), record);
+    }
+
+    std::vector<BasePosting> basePostings;
+    uint64_t postingCount = 0;
+    if (!GetVarint(view, pos, postingCount) || postingCount > kTrigramSpace) return false;
+    basePostings.resize(postingCount);
+    uint64_t trigram = 0;
+    uint64_t offset = 0;
+    for (BasePosting& posting : basePostings) {
+        uint64_t delta = 0;
+        uint64_t count = 0;
+        uint64_t last = 0;
+        if (!GetVarint(view, pos, delta) || !GetVarint(view, pos, count) || !GetVarint(view, pos, last) ||
+            !GetVarint(view, pos, length)) {
+            return false;
+        }
+        trigram += delta;
+        posting.trigram = static_cast<uint32_t>(trigram);
+        posting.count = static_cast<uint32_t>(count);
+        posting.last = static_cast<uint32_t>(last);
+        posting.length = static_cast<uint32_t>(length);
+        posting.offset = offset;
+        offset += length;
+    }
+    if (offset != view.size() - pos) {
+        return false;
+    }
+    // The encoded ids stay where they are; only the offsets move to the whole buffer.
+    for (BasePosting& posting : basePostings) {
+        posting.offset += pos;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_root = root;
+    m_ready = false;
+    m_dirty = false;
+    m_table = std::move(table);
+    m_base = std::move(data);
+    m_basePostings = std::move(basePostings);
+    m_postings.clear();
+    m_nextId = static_cast<uint32_t>(fileCount);
+    return true;
+}
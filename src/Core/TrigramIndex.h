@@ -0,0 +1,137 @@
+#pragma once
+#include "FindEngine.h"
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Size and modification time; a file whose stamp still matches its indexed one
+// has the indexed content.
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+
+    bool operator==(const FileStamp& other) const { return size == other.size && mtime == other.mtime; }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+bool ReadFileStamp(const std::filesystem::directory_entry& entry, FileStamp& stamp);
+
+// How workspace indexes name files: the path with '/' separators. Walks start from a
+// normalized root, so walked paths need nothing more.
+std::string WorkspacePathKey(const std::filesystem::path& path);
+// Normalized root key, the same for "dir" and "dir/".
+std::string WorkspaceRootKey(const std::filesystem::path& root);
+
+// Indexed files by path, as of one moment. Immutable once handed out.
+struct TrigramFileTable {
+    struct Record {
+        uint32_t id = 0;
+        FileStamp stamp;
+    };
+    std::unordered_map<std::string, Record> files;
+};
+
+// Which indexed files can contain a match of one query. Files the index does not
+// know, or that changed since they were indexed, must always be searched.
+class TrigramFilter {
+public:
+    // `path` as found by walking the normalized root.
+    bool MustSearch(const std::filesystem::path& path, const FileStamp& stamp) const;
+
+private:
+    friend class TrigramIndex;
+
+    std::shared_ptr<const TrigramFileTable> m_table;
+    std::vector<bool> m_candidate; // by file id
+};
+
+// Optional trigram index of the workspace: for every trigram of (ASCII case folded)
+// file text, the sorted ids of the files containing it. A query's literal then rules
+// out every file missing one of its trigrams before the exact matcher runs.
+//
+// One background thread loads the index from `storagePath`, re-stats the tree to
+// pick up what changed while Fin was closed, and re-indexes files reported through
+// OnFileChanged. A changed file gets a new id; the old one is dropped when the index
+// is compacted on save.
+class TrigramIndex {
+public:
+    explicit TrigramIndex(std::string storagePath);
+    ~TrigramIndex();
+
+    TrigramIndex(const TrigramIndex&) = delete;
+    TrigramIndex& operator=(const TrigramIndex&) = delete;
+
+    // Switches to `root` (loading the stored index if it belongs to it) and brings
+    // the index up to date in the background. No-op for the current root.
+    void Open(const std::filesystem::path& root);
+    void OnFileChanged(const std::filesystem::path& path);
+
+    // The first full pass over the current root has finished.
+    bool IsReady() const;
+    size_t FileCount() const;
+
+    // Null when the index cannot narrow this search: `root` outside the indexed one,
+    // not ready yet, or no literal of at least three bytes in the query. Subfolders of
+    // the indexed root use the same index.
+    std::shared_ptr<const TrigramFilter> Filter(
+        const std::filesystem::path& root,
+        const std::string& query,
+        const FindOptions& options) const;
+
+private:
+    // Posting list of one trigram: file ids as ascending varint deltas. `last` is the
+    // id the next delta is taken from.
+    struct Posting {
+        std::string bytes;
+        uint32_t last = 0;
+        uint32_t count = 0;
+    };
+    // A posting inside m_base, the stored blob the index was loaded or compacted into.
+    struct BasePosting {
+        uint32_t trigram = 0;
+        uint32_t count = 0;
+        uint32_t last = 0;
+        uint32_t length = 0;
+        uint64_t offset = 0;
+    };
+
+    void WorkLoop();
+    void Refresh(const std::string& root);
+    void IndexFile(const std::string& key, const std::filesystem::path& path, const FileStamp& stamp);
+    void RemoveFile(const std::string& key);
+    TrigramFileTable& MutableTable();
+    const BasePosting* FindBase(uint32_t trigram) const;
+    void DecodeIds(uint32_t trigram, std::vector<uint32_t>& ids) const;
+    bool Load(const std::string& root);
+    void Save();
+    void Compact();
+
+    const std::string m_storagePath;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::string m_requestedRoot;
+    std::vector<std::filesystem::path> m_changed;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    // Guarded by m_mutex; only the worker changes them, so it reads them unlocked.
+    std::string m_root;
+    bool m_ready = false;
+    bool m_dirty = false; // differs from what is stored on disk
+    std::shared_ptr<TrigramFileTable> m_table = std::make_shared<TrigramFileTable>();
+    std::string m_base;
+    std::vector<BasePosting> m_basePostings;           // sorted by trigram
+    std::unordered_map<uint32_t, Posting> m_postings;  // ids added since m_base was built
+    uint32_t m_nextId = 0;
+
+    // Worker only: marks trigrams already collected for the current file.
+    std::vector<uint64_t> m_seen;
+    std::vector<uint32_t> m_trigrams;
+};
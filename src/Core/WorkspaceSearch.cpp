@@ -0,0 +1,236 @@
+#include "WorkspaceSearch.h"
+#include "CharScan.h"
+#include "FileContents.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A NUL byte this early means the file is not text.
+constexpr size_t kBinaryProbeBytes = 8192;
+// Larger files are most likely generated data and would stall a worker.
+constexpr size_t kMaxFileBytes = 64u * 1024u * 1024u;
+// The search stops after this many hits; nobody reads further anyway.
+constexpr size_t kMaxHits = 100000;
+constexpr size_t kPreviewContextBytes = 60;
+constexpr size_t kPreviewMaxBytes = 240;
+
+char FoldExtensionByte(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+} // namespace
+
+bool IsSkippedWorkspaceDirectory(const fs::path& path) {
+    // .git, .vs, .cache and friends: tool state, never sources worth searching.
+    const std::string name = path.filename().string();
+    return !name.empty() && name[0] == '.';
+}
+
+bool HasBinaryExtension(const fs::path& path) {
+    static const char* const kBinaryExtensions[] = {
+        ".exe", ".dll", ".lib", ".a", ".obj", ".o", ".so", ".dylib", ".pdb", ".ilk", ".class"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), FoldExtensionByte);
+    for (const char* binary : kBinaryExtensions) {
+        if (ext == binary) return true;
+    }
+    return false;
+}
+
+WorkspaceSearch::~WorkspaceSearch() {
+    Cancel();
+    Join();
+}
+
+void WorkspaceSearch::Start(
+    const fs::path& root,
+    const std::string& query,
+    const FindOptions& options,
+    std::shared_ptr<const TrigramFilter> filter) {
+    Cancel();
+    Join();
+
+    m_paths.clear();
+    m_results.clear();
+    m_walkDone = false;
+    m_cancel = false;
+    m_filesSearched = 0;
+    m_filesSkipped = 0;
+    m_longLinesSkipped = 0;
+    m_hitCount = 0;
+    m_truncated = false;
+    if (query.empty()) {
+        return;
+    }
+
+    const unsigned workerCount = std::max(1u, std::thread::hardware_concurrency());
+    m_activeThreads = static_cast<int>(workerCount) + 1;
+    m_threads.emplace_back(&WorkspaceSearch::Walk, this, root.lexically_normal(), std::move(filter));
+    for (unsigned i = 0; i < workerCount; ++i) {
+        m_threads.emplace_back(&WorkspaceSearch::Work, this, query, options);
+    }
+}
+
+void WorkspaceSearch::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancel = true;
+    }
+    m_cv.notify_all();
+}
+
+void WorkspaceSearch::Join() {
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+}
+
+bool WorkspaceSearch::TakeResults(std::vector<WorkspaceSearchFile>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_results.empty()) {
+        return false;
+    }
+    std::move(m_results.begin(), m_results.end(), std::back_inserter(out));
+    m_results.clear();
+    return true;
+}
+
+void WorkspaceSearch::FinishThread() {
+    m_activeThreads.fetch_sub(1);
+}
+
+void WorkspaceSearch::Walk(fs::path root, std::shared_ptr<const TrigramFilter> filter) {
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    const fs::recursive_directory_iterator end;
+    std::vector<std::string> batch;
+    const auto flush = [&]() {
+        if (batch.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::move(batch.begin(), batch.end(), std::back_inserter(m_paths));
+        }
+        batch.clear();
+        m_cv.notify_all();
+    };
+
+    for (; !ec && it != end && !m_cancel; it.increment(ec)) {
+        const fs::directory_entry& entry = *it;
+        std::error_code statEc;
+        if (entry.is_directory(statEc)) {
+            if (IsSkippedWorkspaceDirectory(entry.path())) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (!entry.is_regular_file(statEc) || HasBinaryExtension(entry.path())) {
+            continue;
+        }
+        FileStamp stamp;
+        if (filter && ReadFileStamp(entry, stamp) && !filter->MustSearch(entry.path(), stamp)) {
+            m_filesSkipped.fetch_add(1);
+            continue;
+        }
+        batch.push_back(entry.path().u8string());
+        if (batch.size() >= 64) {
+            flush();
+        }
+    }
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_walkDone = true;
+    }
+    m_cv.notify_all();
+    FinishThread();
+}
+
+void WorkspaceSearch::Work(std::string query, FindOptions options) {
+    FindEngine engine;
+    std::string buffer;
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_cancel || m_walkDone || !m_paths.empty(); });
+            if (m_cancel || m_paths.empty()) {
+                break;
+            }
+            path = std::move(m_paths.front());
+            m_paths.pop_front();
+        }
+        SearchFile(path, buffer, engine, query, options);
+    }
+    FinishThread();
+}
+
+void WorkspaceSearch::SearchFile(
+    const std::string& path,
+    std::string& buffer,
+    FindEngine& engine,
+    const std::string& query,
+    const FindOptions& options) {
+    const FileContents file(path, buffer, kMaxFileBytes);
+    const std::string_view text = file.View();
+    if (text.empty() || std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbeBytes)) != nullptr) {
+        return;
+    }
+
+    std::vector<FindMatch> matches;
+    size_t longLines = 0;
+    engine.SearchText(text, query, options, matches, kMaxRegexLineBytes, &longLines);
+    m_filesSearched.fetch_add(1);
+    if (longLines > 0) {
+        m_longLinesSkipped.fetch_add(longLines);
+    }
+    if (matches.empty() || m_cancel) {
+        return;
+    }
+
+    WorkspaceSearchFile result;
+    result.path = path;
+    result.hits.reserve(matches.size());
+    // Matches are sorted, so line numbers are counted forward from the previous one.
+    size_t line = 0;
+    size_t lineStart = 0;
+    for (const FindMatch& match : matches) {
+        for (size_t newline = FindByteOf(text, lineStart, '\n', '\n'); newline < match.start;
+             newline = FindByteOf(text, lineStart, '\n', '\n')) {
+            ++line;
+            lineStart = newline + 1;
+        }
+        const size_t lineEnd = FindByteOf(text, lineStart, '\n', '\r');
+        const size_t previewStart = std::max(lineStart, match.start - std::min(match.start, kPreviewContextBytes));
+        const size_t previewEnd = std::min(lineEnd, previewStart + kPreviewMaxBytes);
+
+        WorkspaceSearchHit hit;
+        hit.line = line;
+        hit.column = match.start - lineStart;
+        hit.length = match.end - match.start;
+        hit.preview.assign(text.data() + previewStart, std::max(previewStart, previewEnd) - previewStart);
+        result.hits.push_back(std::move(hit));
+    }
+
+    const size_t total = m_hitCount.fetch_add(result.hits.size()) + result.hits.size();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.push_back(std::move(result));
+        if (total >= kMaxHits) {
+            m_truncated = true;
+            m_cancel = true;
+        }
+    }
+    if (total >= kMaxHits) {
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "FindEngine.h"
+#include "TrigramIndex.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Extensions of build outputs and other binaries that are never opened or searched.
+bool HasBinaryExtension(const std::filesystem::path& path);
+// Directories workspace walks do not descend into (.git, .vs, ...).
+bool IsSkippedWorkspaceDirectory(const std::filesystem::path& path);
+
+// One match in a file on disk; line and column are 0-based, column in bytes.
+struct WorkspaceSearchHit {
+    size_t line = 0;
+    size_t column = 0;
+    size_t length = 0;
+    std::string preview; // the matched line, cut to a sane length
+};
+
+struct WorkspaceSearchFile {
+    std::string path;
+    std::vector<WorkspaceSearchHit> hits;
+};
+
+// Find in Files: one thread walks the directory tree while a pool of workers maps
+// and searches the files it finds. Results are collected per file and handed to the
+// UI thread through TakeResults as they arrive. A new Start or Cancel abandons the
+// running search within one file per worker.
+class WorkspaceSearch {
+public:
+    // Regex mode does not search longer lines (minified sources, logs): each costs
+    // time linear in its length per pattern instruction, on one worker.
+    static constexpr size_t kMaxRegexLineBytes = 64u * 1024u;
+
+    WorkspaceSearch() = default;
+    ~WorkspaceSearch();
+
+    WorkspaceSearch(const WorkspaceSearch&) = delete;
+    WorkspaceSearch& operator=(const WorkspaceSearch&) = delete;
+
+    // `filter` (optional) lets the walk skip files the trigram index rules out.
+    void Start(
+        const std::filesystem::path& root,
+        const std::string& query,
+        const FindOptions& options,
+        std::shared_ptr<const TrigramFilter> filter = nullptr);
+    void Cancel();
+    bool IsRunning() const { return m_activeThreads.load() > 0; }
+
+    // Moves files finished since the last call to the end of `out`. Returns false
+    // when there was nothing new.
+    bool TakeResults(std::vector<WorkspaceSearchFile>& out);
+
+    size_t FilesSearched() const { return m_filesSearched.load(); }
+    size_t FilesSkippedByIndex() const { return m_filesSkipped.load(); }
+    // Lines over kMaxRegexLineBytes left out in regex mode.
+    size_t LongLinesSkipped() const { return m_longLinesSkipped.load(); }
+    // The search stopped early because it reached the hit limit.
+    bool Truncated() const { return m_truncated.load(); }
+
+private:
+    void Walk(std::filesystem::path root, std::shared_ptr<const TrigramFilter> filter);
+    void Work(std::string query, FindOptions options);
+    void SearchFile(const std::string& path, std::string& buffer, FindEngine& engine, const std::string& query, const FindOptions& options);
+    void FinishThread();
+    void Join();
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::string> m_paths; // walked but not yet searched
+    bool m_walkDone = false;
+    std::vector<WorkspaceSearchFile> m_results;
+
+    std::atomic<bool> m_cancel{false};
+    std::atomic<int> m_activeThreads{0};
+    std::atomic<size_t> m_filesSearched{0};
+    std::atomic<size_t> m_filesSkipped{0};
+    std::atomic<size_t> m_longLinesSkipped{0};
+    std::atomic<size_t> m_hitCount{0};
+    std::atomic<bool> m_truncated{false};
+    std::vector<std::thread> m_threads;
+};